@@ -0,0 +1,106 @@
+#ifndef GC_JSON_BENCH_CORPUS_HPP
+#define GC_JSON_BENCH_CORPUS_HPP
+#include "../json_parser.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A named json document of the corpus.
+ */
+struct Document {
+  std::string name;     ///< The name shown in the benchmark
+  std::string content;  ///< The json text
+};
+
+/**
+ * @brief Reads the whole file, returns an empty string if it does not exist.
+ */
+static std::string read_file(const std::string &path) {
+  std::ifstream file(path,std::ios::binary);
+  if (!file)
+    return "";
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+/**
+ * @brief Creates nested objects and arrays of the given depth.
+ */
+static std::string deep_nesting(int depth) {
+  std::string ret;
+  for (int i = 0; i < depth; i++)
+    ret += (i % 2) ? "[" : "{\"key\":";
+  ret += "1";
+  for (int i = depth-1; i >= 0; i--)
+    ret += (i % 2) ? "]" : "}";
+  return ret;
+}
+
+/**
+ * @brief Creates an array of count random doubles and integers.
+ */
+static std::string numeric_array(int count) {
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> real(-1e6,1e6);
+  std::string ret = "[";
+  char buffer[32];
+  for (int i = 0; i < count; i++) {
+    if (i)
+      ret += ",";
+    if (i % 2)
+      ret.append(buffer,json_format_double(real(rng),buffer));
+    else
+      ret.append(buffer,json_format_integer((long long)(rng() % 1000000),buffer));
+  }
+  ret += "]";
+  return ret;
+}
+
+/**
+ * @brief Loads the standard corpus from the directory in JSON_BENCH_CORPUS or
+ * bench/data and adds the synthetic documents.
+ */
+static std::vector<Document> load_corpus() {
+  const char *env = std::getenv("JSON_BENCH_CORPUS");
+  std::string dir = env ? env : "bench/data";
+  std::vector<Document> corpus;
+  for (const char *name : {"twitter.json","canada.json","citm_catalog.json"}) {
+    std::string content = read_file(dir + "/" + name);
+    if (content.empty())
+      std::fprintf(stderr,"Skipping %s, not found in %s\n",name,dir.c_str());
+    else
+      corpus.push_back(Document{name,std::move(content)});
+  }
+  corpus.push_back(Document{"deep_nesting",deep_nesting(1000)});
+  corpus.push_back(Document{"numeric_array",numeric_array(100000)});
+  return corpus;
+}
+
+/**
+ * @brief Loads every file of the fuzzing corpus from the directory in
+ * JSON_FUZZ_CORPUS or fuzz/corpus, sorted by name.
+ */
+static std::vector<Document> load_fuzz_corpus() {
+  const char *env = std::getenv("JSON_FUZZ_CORPUS");
+  std::string dir = env ? env : "fuzz/corpus";
+  std::vector<Document> corpus;
+  std::error_code err;
+  for (const auto &entry : std::filesystem::directory_iterator(dir,err)) {
+    if (entry.is_regular_file())
+      corpus.push_back(Document{entry.path().filename().string(),read_file(entry.path().string())});
+  }
+  if (corpus.empty())
+    std::fprintf(stderr,"Skipping the fuzzing corpus, nothing found in %s\n",dir.c_str());
+  std::sort(corpus.begin(),corpus.end(),[](const Document &a, const Document &b){return a.name < b.name;});
+  return corpus;
+}
+
+#endif
@@ -0,0 +1,617 @@
+#include <benchmark/benchmark.h>
+#include "../json_parser.hpp"
+#include "corpus.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+ * @brief The number of calls to operator new since the start of the program.
+ */
+static std::atomic<std::size_t> allocation_count(0);
+
+/**
+ * @brief Allocates and counts the memory for all replaced operator new
+ * overloads, returns nullptr if there is none left.
+ */
+static void *counted_allocate(std::size_t size) noexcept {
+  allocation_count.fetch_add(1,std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+/**
+ * @brief Releases memory of counted_allocate(...). Not inlined into the
+ * operators so the compiler does not pair malloc/free with new/delete.
+ */
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static void counted_release(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void *operator new(std::size_t size) {
+  if (void *ptr = counted_allocate(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+  if (void *ptr = counted_allocate(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  counted_release(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  counted_release(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  counted_release(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+  counted_release(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  counted_release(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  counted_release(ptr);
+}
+
+/**
+ * @brief Returns the peak resident set size of the process in bytes.
+ */
+static double peak_rss_bytes() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(),&counters,sizeof(counters)))
+    return (double)counters.PeakWorkingSetSize;
+  return 0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+#if defined(__APPLE__)
+  return (double)usage.ru_maxrss;
+#else
+  return (double)usage.ru_maxrss * 1024.0;
+#endif
+#endif
+}
+
+/**
+ * @brief Creates count newline delimited records of a small object each.
+ */
+static std::string ndjson_records(int count) {
+  std::string ret;
+  for (int i = 0; i < count; i++)
+    ret += "{\"id\":" + std::to_string(i) + ",\"name\":\"record\",\"tags\":[\"a\",\"b\"],\"score\":" + std::to_string(i) + ".25}\n";
+  return ret;
+}
+
+/**
+ * @brief Creates an object with count nested attributes field0...fieldN.
+ */
+static std::string wide_object(int count) {
+  std::string ret = "{";
+  for (int i = 0; i < count; i++) {
+    if (i)
+      ret += ",";
+    ret += "\"field" + std::to_string(i) + "\":{\"id\":" + std::to_string(i) + ",\"tags\":[\"x\",\"y\",{\"z\":[1,2,3]}],\"text\":\"some text\"}";
+  }
+  ret += "}";
+  return ret;
+}
+
+/**
+ * @brief Sets the throughput, allocation and memory counters.
+ */
+static void report(benchmark::State &state, const Document &doc, std::size_t allocations) {
+  state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)doc.content.size());
+  state.counters["allocs_per_doc"] = benchmark::Counter((double)allocations,benchmark::Counter::kAvgIterations);
+  state.counters["peak_rss_mb"] = peak_rss_bytes() / (1024.0*1024.0);
+}
+
+/**
+ * @brief Parses the document once per iteration.
+ */
+template<typename JsonType>
+static void bench_parse(benchmark::State &state, const Document *doc, JsonParseOptions options) {
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto js = JsonType::parse(doc->content,[](typename JsonType::JsonParser&){},options);
+    benchmark::DoNotOptimize(js);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Parses every document of the fuzzing corpus once per iteration.
+ */
+template<typename JsonType>
+static void bench_parse_fuzz_corpus(benchmark::State &state, const std::vector<Document> *corpus, JsonParseOptions options) {
+  std::size_t bytes = 0;
+  for (const auto &doc : *corpus)
+    bytes += doc.content.size();
+  for (auto _ : state) {
+    for (const auto &doc : *corpus) {
+      auto js = JsonType::parse(doc.content,[](typename JsonType::JsonParser&){},options);
+      benchmark::DoNotOptimize(js);
+    }
+  }
+  state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)bytes);
+}
+
+/**
+ * @brief Dumps the parsed document once per iteration.
+ */
+template<typename JsonType>
+static void bench_dump(benchmark::State &state, const Document *doc) {
+  auto js = JsonType::parse(doc->content,[](typename JsonType::JsonParser&){});
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    std::string out = js.dump();
+    benchmark::DoNotOptimize(out);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Streams the dump of the document with dump_stream using the given
+ * threads and reports the average time until the first part is written.
+ */
+template<typename JsonType>
+static void bench_dump_stream(benchmark::State &state, const Document *doc, unsigned threads) {
+  auto js = JsonType::parse(doc->content,[](typename JsonType::JsonParser&){});
+  std::size_t allocations = 0;
+  double first_part_us = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    bool first = true;
+    std::size_t written = 0;
+    js.dump_stream([&](std::string_view part){
+      if (first)
+        first_part_us += std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count();
+      first = false;
+      written += part.size();
+    },threads);
+    benchmark::DoNotOptimize(written);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+  state.counters["threads"] = (double)threads;
+  state.counters["first_part_us"] = first_part_us/state.iterations();
+}
+
+/**
+ * @brief Parses every line of the ndjson document on its own.
+ */
+template<typename JsonType>
+static void bench_ndjson_lines(benchmark::State &state, const Document *doc) {
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    std::string_view view(doc->content);
+    std::vector<JsonType> records;
+    while (!view.empty()) {
+      std::size_t end = std::min(view.find('\n'),view.size());
+      records.push_back(JsonType::parse(view.substr(0,end),[](typename JsonType::JsonParser&){}));
+      view.remove_prefix(std::min(end+1,view.size()));
+    }
+    benchmark::DoNotOptimize(records);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Parses the ndjson document with parse_many using the given threads.
+ */
+template<typename JsonType>
+static void bench_ndjson_many(benchmark::State &state, const Document *doc, unsigned threads) {
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto records = JsonType::parse_many(doc->content,JsonParseOptions(),threads);
+    benchmark::DoNotOptimize(records);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+  state.counters["threads"] = (double)threads;
+}
+
+/**
+ * @brief Parses the array document with parse_parallel using the given
+ * threads.
+ */
+template<typename JsonType>
+static void bench_parse_parallel(benchmark::State &state, const Document *doc, unsigned threads) {
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto js = JsonType::parse_parallel(doc->content,[](typename JsonType::JsonParser&){},JsonParseOptions(),threads);
+    benchmark::DoNotOptimize(js);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+  state.counters["threads"] = (double)threads;
+}
+
+/**
+ * @brief Decodes the CBOR encoding of the document once per iteration, the
+ * throughput is reported in bytes of the json text.
+ */
+template<typename JsonType>
+static void bench_parse_cbor(benchmark::State &state, const Document *doc) {
+  std::string cbor = JsonType::parse(doc->content,[](typename JsonType::JsonParser&){}).dump_cbor();
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    auto js = JsonType::parse_cbor(cbor,[](typename JsonType::JsonCborParser&){});
+    benchmark::DoNotOptimize(js);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+  state.counters["cbor_ratio"] = (double)cbor.size() / (double)doc->content.size();
+}
+
+/**
+ * @brief Encodes the parsed document as CBOR once per iteration.
+ */
+template<typename JsonType>
+static void bench_dump_cbor(benchmark::State &state, const Document *doc) {
+  auto js = JsonType::parse(doc->content,[](typename JsonType::JsonParser&){});
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    std::string out = js.dump_cbor();
+    benchmark::DoNotOptimize(out);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Extracts five fields of the document, either from the parsed DOM or
+ * from a lazy view.
+ */
+template<bool lazy, bool indexed>
+static void bench_extract(benchmark::State &state, const Document *doc) {
+  static const char *fields[] = {"field3","field100","field250","field400","field499"};
+  std::size_t allocations = 0;
+  JsonStructuralIndex index;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    int sum = 0;
+    if (lazy) {
+      if (indexed)
+        index.build(doc->content);
+      auto root = Json::parse_lazy(doc->content,indexed ? &index : nullptr);
+      for (const char *field : fields)
+        root.get(field).get("id").map_int([&sum](int x){sum += x;});
+    }
+    else {
+      auto root = Json::parse(doc->content,[](Json::JsonParser&){});
+      for (const char *field : fields)
+        root.get(field).get("id").map_int([&sum](int x){sum += x;});
+    }
+    benchmark::DoNotOptimize(sum);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Extracts the same five fields with precompiled json pointers in one
+ * traversal of a lazy view.
+ */
+static void bench_select(benchmark::State &state, const Document *doc) {
+  std::vector<JsonPath> paths;
+  for (const char *path : {"/field3/id","/field100/id","/field250/id","/field400/id","/field499/id"})
+    paths.emplace_back(path);
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    int sum = 0;
+    Json::parse_lazy(doc->content).select(paths,[&sum](std::size_t, Json::JsonLazy &value){
+      value.map_int([&sum](int x){sum += x;});
+    });
+    benchmark::DoNotOptimize(sum);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Opens a tape snapshot of the document and extracts the same five
+ * fields, nothing is parsed.
+ */
+static void bench_tape(benchmark::State &state, const Document *doc) {
+  static const char *fields[] = {"field3","field100","field250","field400","field499"};
+  std::string tape = Json::parse(doc->content,[](Json::JsonParser&){}).dump_tape();
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    int sum = 0;
+    JsonTapeValue root = JsonTape(tape).root();
+    for (const char *field : fields)
+      root.get(field).get("id").map_int([&sum](int x){sum += x;});
+    benchmark::DoNotOptimize(sum);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Sums all integers of a parsed array through map_array and map_int.
+ */
+static void bench_map_array(benchmark::State &state, const Document *doc) {
+  auto js = Json::parse(doc->content,[](Json::JsonParser&){});
+  for (auto _ : state) {
+    long long sum = 0;
+    js.map_array([&sum](Json &item){ item.map_int([&sum](int x){sum += x;}); });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations() * js.size());
+}
+
+/**
+ * @brief Copies the parsed document and changes one attribute of one record,
+ * the work of a response built from a shared template.
+ */
+template<typename JsonType>
+static void bench_copy_modify(benchmark::State &state, const Document *doc) {
+  auto js = JsonType::parse(doc->content,[](typename JsonType::JsonParser&){});
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    JsonType copy = js;
+    copy.get(42).set("name","changed");
+    benchmark::DoNotOptimize(copy);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Sums all numbers of a parsed array through the packed view.
+ */
+static void bench_packed_sum(benchmark::State &state, const Document *doc) {
+  auto js = Json::parse(doc->content,[](Json::JsonParser&){});
+  JsonSpan<const double> numbers = js.packed_floats();
+  for (auto _ : state) {
+    double sum = 0;
+    for (double x : numbers)
+      sum += x;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations() * numbers.size());
+}
+
+/**
+ * @brief One record of ndjson_records(...) bound to its keys.
+ */
+struct BenchRecord {
+  long long id = 0;
+  std::string name;
+  std::vector<std::string> tags;
+  double score = 0;
+};
+
+GC_JSON_FIELDS(BenchRecord,id,name,tags,score);
+
+/**
+ * @brief Fills the records of the array document either through the DOM or
+ * directly with parse_struct.
+ */
+template<bool direct>
+static void bench_records(benchmark::State &state, const Document *doc) {
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    std::vector<BenchRecord> records;
+    if constexpr (direct)
+      ArenaJson::parse_struct(doc->content,records);
+    else {
+      auto js = ArenaJson::parse(doc->content,[](ArenaJson::JsonParser&){});
+      js.map_array([&records](ArenaJson &item){
+        BenchRecord record;
+        item.get("id").map_int([&record](long long x){record.id = x;});
+        item.get("name").map_string([&record](std::string_view x){record.name = std::string(x);});
+        item.get("tags").map_array([&record](ArenaJson &tag){ tag.map_string([&record](std::string_view x){record.tags.emplace_back(x);}); });
+        // There is no double accessor, leaving out the score only favours
+        // the DOM.
+        records.push_back(std::move(record));
+      });
+    }
+    benchmark::DoNotOptimize(records);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+/**
+ * @brief Reads the id of every record of the parsed array document, with
+ * a JsonCachedKey or by looking up the key string.
+ */
+template<typename JsonType, bool cached>
+static void bench_access(benchmark::State &state, const Document *doc) {
+  auto js = JsonType::parse(doc->content,[](typename JsonType::JsonParser&){});
+  int count = js.size();
+  JsonCachedKey id("id");
+  std::string key("id");
+  for (auto _ : state) {
+    long long sum = 0;
+    for (int i = 0; i < count; i++) {
+      if constexpr (cached)
+        js.get(i).get(id).map_int([&sum](int x){sum += x;});
+      else
+        js.get(i).get(key).map_int([&sum](int x){sum += x;});
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations() * count);
+}
+
+/**
+ * @brief Reads the id of every record of one document shared by all
+ * benchmark threads, through a JsonReader or through get(...) behind a lock.
+ */
+template<bool reader>
+static void bench_concurrent_access(benchmark::State &state, const FlatJson *js) {
+  static std::mutex lock;
+  int count = js->reader().size();
+  for (auto _ : state) {
+    long long sum = 0;
+    for (int i = 0; i < count; i++) {
+      if constexpr (reader)
+        js->reader().get(i).get("id").map_int([&sum](int x){sum += x;});
+      else {
+        std::lock_guard<std::mutex> guard(lock);
+        const_cast<FlatJson*>(js)->get(i).get("id").map_int([&sum](int x){sum += x;});
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed((int64_t)state.iterations() * count);
+}
+
+/**
+ * @brief Writes the records of the array document with dump_struct.
+ */
+static void bench_dump_struct(benchmark::State &state, const Document *doc) {
+  std::vector<BenchRecord> records;
+  Json::parse_struct(doc->content,records);
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    std::size_t before = allocation_count.load(std::memory_order_relaxed);
+    std::string out = Json::dump_struct(records);
+    benchmark::DoNotOptimize(out);
+    allocations += allocation_count.load(std::memory_order_relaxed) - before;
+  }
+  report(state,*doc,allocations);
+}
+
+int main(int argc, char **argv) {
+  static std::vector<Document> corpus = load_corpus();
+
+  JsonParseOptions borrow;
+  borrow.borrow_strings = true;
+
+  for (const auto &doc : corpus) {
+    benchmark::RegisterBenchmark(("parse/Json/" + doc.name).c_str(),bench_parse<Json>,&doc,JsonParseOptions());
+    benchmark::RegisterBenchmark(("parse/Json+borrow/" + doc.name).c_str(),bench_parse<Json>,&doc,borrow);
+    benchmark::RegisterBenchmark(("parse/ArenaJson/" + doc.name).c_str(),bench_parse<ArenaJson>,&doc,JsonParseOptions());
+    benchmark::RegisterBenchmark(("parse/FlatJson/" + doc.name).c_str(),bench_parse<FlatJson>,&doc,JsonParseOptions());
+    benchmark::RegisterBenchmark(("parse/Json+stats/" + doc.name).c_str(),bench_parse<JsonBase<JsonLogLevel::log_stats>>,&doc,JsonParseOptions());
+    benchmark::RegisterBenchmark(("dump/Json/" + doc.name).c_str(),bench_dump<Json>,&doc);
+    benchmark::RegisterBenchmark(("parse_cbor/Json/" + doc.name).c_str(),bench_parse_cbor<Json>,&doc);
+    benchmark::RegisterBenchmark(("parse_cbor/ArenaJson/" + doc.name).c_str(),bench_parse_cbor<ArenaJson>,&doc);
+    benchmark::RegisterBenchmark(("dump_cbor/Json/" + doc.name).c_str(),bench_dump_cbor<Json>,&doc);
+  }
+
+  static std::vector<Document> fuzz_corpus = load_fuzz_corpus();
+  if (!fuzz_corpus.empty()) {
+    benchmark::RegisterBenchmark("parse/Json/fuzz_corpus",bench_parse_fuzz_corpus<Json>,&fuzz_corpus,JsonParseOptions());
+    benchmark::RegisterBenchmark("parse/Json+borrow/fuzz_corpus",bench_parse_fuzz_corpus<Json>,&fuzz_corpus,borrow);
+  }
+
+  static Document million{"numeric_array_1m",numeric_array(1000000)};
+  benchmark::RegisterBenchmark("parse/Json/numeric_array_1m",bench_parse<Json>,&million,JsonParseOptions());
+  benchmark::RegisterBenchmark("map_array/Json/numeric_array_1m",bench_map_array,&million);
+  benchmark::RegisterBenchmark("packed_sum/Json/numeric_array_1m",bench_packed_sum,&million);
+
+  static Document wide{"wide_object",wide_object(500)};
+  benchmark::RegisterBenchmark("extract/Json/dom",bench_extract<false,false>,&wide);
+  benchmark::RegisterBenchmark("extract/Json/lazy",bench_extract<true,false>,&wide);
+  benchmark::RegisterBenchmark("extract/Json/lazy+index",bench_extract<true,true>,&wide);
+  benchmark::RegisterBenchmark("extract/Json/select",bench_select,&wide);
+  benchmark::RegisterBenchmark("extract/JsonTape",bench_tape,&wide);
+
+  static Document ndjson{"ndjson_records",ndjson_records(100000)};
+  benchmark::RegisterBenchmark("parse_many/Json/lines",bench_ndjson_lines<Json>,&ndjson);
+  benchmark::RegisterBenchmark("parse_many/Json/1",bench_ndjson_many<Json>,&ndjson,1u);
+  benchmark::RegisterBenchmark("parse_many/ArenaJson/1",bench_ndjson_many<ArenaJson>,&ndjson,1u);
+  unsigned threads = std::max(1u,std::thread::hardware_concurrency());
+  benchmark::RegisterBenchmark(("parse_many/Json/" + std::to_string(threads)).c_str(),bench_ndjson_many<Json>,&ndjson,threads)->UseRealTime();
+  benchmark::RegisterBenchmark(("parse_many/ArenaJson/" + std::to_string(threads)).c_str(),bench_ndjson_many<ArenaJson>,&ndjson,threads)->UseRealTime();
+
+  static Document records{"record_array","[" + ndjson_records(100000) + "]"};
+  std::replace(records.content.begin(),records.content.end()-2,'\n',',');
+  JsonParseOptions intern;
+  intern.intern_keys = true;
+  benchmark::RegisterBenchmark("parse/Json/record_array",bench_parse<Json>,&records,JsonParseOptions());
+  static JsonKeyInterner interner;
+  JsonParseOptions shared;
+  shared.key_interner = &interner;
+  benchmark::RegisterBenchmark("parse/Json+shared_intern/record_array",bench_parse<Json>,&records,shared);
+  benchmark::RegisterBenchmark("parse/ArenaJson/record_array",bench_parse<ArenaJson>,&records,JsonParseOptions());
+  benchmark::RegisterBenchmark("parse/ArenaJson+intern/record_array",bench_parse<ArenaJson>,&records,intern);
+  benchmark::RegisterBenchmark("parse/FlatJson/record_array",bench_parse<FlatJson>,&records,JsonParseOptions());
+  benchmark::RegisterBenchmark("parse/ShapedJson/record_array",bench_parse<ShapedJson>,&records,JsonParseOptions());
+  // Every object has its own keys, nothing can be shared.
+  static Document unique{"unique_keys",""};
+  unique.content = "[";
+  for (int i = 0; i < 20000; i++)
+    unique.content += std::string(i ? "," : "") + "{\"a" + std::to_string(i) + "\":1,\"b" + std::to_string(i) + "\":\"x\",\"c" + std::to_string(i) + "\":[2],\"d" + std::to_string(i) + "\":true}";
+  unique.content += "]";
+  benchmark::RegisterBenchmark("parse/FlatJson/unique_keys",bench_parse<FlatJson>,&unique,JsonParseOptions());
+  benchmark::RegisterBenchmark("parse/ShapedJson/unique_keys",bench_parse<ShapedJson>,&unique,JsonParseOptions());
+  benchmark::RegisterBenchmark("access/FlatJson/record_array",bench_access<FlatJson,false>,&records);
+  benchmark::RegisterBenchmark("access/ShapedJson/record_array",bench_access<ShapedJson,false>,&records);
+  benchmark::RegisterBenchmark("access/ShapedJson+cached/record_array",bench_access<ShapedJson,true>,&records);
+  static const FlatJson shared_records = FlatJson::parse(records.content,[](FlatJson::JsonParser&){});
+  benchmark::RegisterBenchmark("concurrent_access/FlatJson+lock/record_array",bench_concurrent_access<false>,&shared_records)->Threads(threads)->UseRealTime();
+  benchmark::RegisterBenchmark("concurrent_access/FlatJson+reader/record_array",bench_concurrent_access<true>,&shared_records)->Threads(threads)->UseRealTime();
+  benchmark::RegisterBenchmark("parse_parallel/ArenaJson/1",bench_parse_parallel<ArenaJson>,&records,1u);
+  benchmark::RegisterBenchmark(("parse_parallel/Json/" + std::to_string(threads)).c_str(),bench_parse_parallel<Json>,&records,threads)->UseRealTime();
+  benchmark::RegisterBenchmark(("parse_parallel/ArenaJson/" + std::to_string(threads)).c_str(),bench_parse_parallel<ArenaJson>,&records,threads)->UseRealTime();
+  benchmark::RegisterBenchmark("records/ArenaJson/dom",bench_records<false>,&records);
+  benchmark::RegisterBenchmark("records/ArenaJson/parse_struct",bench_records<true>,&records);
+  benchmark::RegisterBenchmark("dump/Json/record_array",bench_dump<Json>,&records);
+  benchmark::RegisterBenchmark("copy_modify/Json/record_array",bench_copy_modify<Json>,&records);
+  benchmark::RegisterBenchmark("copy_modify/ArenaJson/record_array",bench_copy_modify<ArenaJson>,&records);
+  benchmark::RegisterBenchmark("dump_struct/record_array",bench_dump_struct,&records);
+  benchmark::RegisterBenchmark("dump_stream/Json/1",bench_dump_stream<Json>,&records,1u);
+  benchmark::RegisterBenchmark(("dump_stream/Json/" + std::to_string(threads)).c_str(),bench_dump_stream<Json>,&records,threads)->UseRealTime();
+
+  benchmark::Initialize(&argc,argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
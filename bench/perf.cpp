@@ -0,0 +1,297 @@
+#include "../json_parser.hpp"
+#include "corpus.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Counts hardware events of the calling thread with perf_event_open.
+ * Every counter which can not be opened, on other systems than linux, in
+ * containers or without permission, is reported as unavailable.
+ */
+class PerfCounters {
+  public:
+    static constexpr int count = 4;  ///< cycles, instructions, branch misses, cache misses
+    static constexpr const char *names[count] = {"cycles","instructions","branch_misses","cache_misses"};
+
+    PerfCounters() {
+      for (int i = 0; i < count; i++)
+        fds_[i] = -1;
+#if defined(__linux__)
+      const std::uint64_t events[count] = {PERF_COUNT_HW_CPU_CYCLES,PERF_COUNT_HW_INSTRUCTIONS,PERF_COUNT_HW_BRANCH_MISSES,PERF_COUNT_HW_CACHE_MISSES};
+      for (int i = 0; i < count; i++) {
+        perf_event_attr attr;
+        std::memset(&attr,0,sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds_[i] = (int)syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+      }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    ~PerfCounters() {
+#if defined(__linux__)
+      for (int i = 0; i < count; i++) {
+        if (fds_[i] >= 0)
+          close(fds_[i]);
+      }
+#endif
+    }
+
+    /**
+     * @brief Returns true if the counter with the given number is counted.
+     */
+    bool available(int counter) const {
+      return fds_[counter] >= 0;
+    }
+
+    /**
+     * @brief Resets and starts all available counters.
+     */
+    void start() {
+#if defined(__linux__)
+      for (int i = 0; i < count; i++) {
+        if (fds_[i] >= 0) {
+          ioctl(fds_[i],PERF_EVENT_IOC_RESET,0);
+          ioctl(fds_[i],PERF_EVENT_IOC_ENABLE,0);
+        }
+      }
+#endif
+    }
+
+    /**
+     * @brief Stops the counters and returns the events since start(), 0 for
+     * unavailable counters.
+     */
+    void stop(std::uint64_t (&values)[count]) {
+      for (int i = 0; i < count; i++) {
+        values[i] = 0;
+#if defined(__linux__)
+        if (fds_[i] >= 0) {
+          ioctl(fds_[i],PERF_EVENT_IOC_DISABLE,0);
+          if (read(fds_[i],&values[i],sizeof(values[i])) != sizeof(values[i]))
+            values[i] = 0;
+        }
+#endif
+      }
+    }
+
+  private:
+    int fds_[count];  ///< The file descriptors of the counters or -1
+};
+
+/**
+ * @brief The measurement of one corpus entry.
+ */
+struct PerfResult {
+  std::string name;                         ///< The document or group of documents
+  double mb_per_s = 0;                      ///< The best throughput of all repetitions
+  double per_byte[PerfCounters::count];     ///< The events per parsed byte in the best repetition
+  bool counted[PerfCounters::count];        ///< True if the event was counted
+};
+
+/**
+ * @brief Parses the documents in repetitions of at least 50ms and keeps the
+ * fastest repetition, which is the least disturbed by the rest of the
+ * system.
+ */
+static PerfResult measure(const std::string &name, const std::vector<const Document*> &docs, JsonParseOptions options, int repetitions, PerfCounters &counters) {
+  using clock = std::chrono::steady_clock;
+  std::size_t bytes = 0;
+  for (auto doc : docs)
+    bytes += doc->content.size();
+  auto parse_all = [&](std::size_t iterations) {
+    for (std::size_t i = 0; i < iterations; i++) {
+      for (auto doc : docs)
+        Json::parse(doc->content,[](Json::JsonParser&){},options);
+    }
+  };
+
+  std::size_t iterations = 1;
+  for (;;) {
+    auto begin = clock::now();
+    parse_all(iterations);
+    if (clock::now() - begin >= std::chrono::milliseconds(50))
+      break;
+    iterations *= 2;
+  }
+
+  PerfResult result;
+  result.name = name;
+  for (int i = 0; i < PerfCounters::count; i++) {
+    result.per_byte[i] = 0;
+    result.counted[i] = counters.available(i);
+  }
+  double best = 0;
+  for (int r = 0; r < repetitions; r++) {
+    std::uint64_t values[PerfCounters::count];
+    counters.start();
+    auto begin = clock::now();
+    parse_all(iterations);
+    double seconds = std::chrono::duration<double>(clock::now() - begin).count();
+    counters.stop(values);
+    if (best != 0 && seconds >= best)
+      continue;
+    best = seconds;
+    double total = (double)bytes * (double)iterations;
+    result.mb_per_s = total / seconds / (1024.0*1024.0);
+    for (int i = 0; i < PerfCounters::count; i++)
+      result.per_byte[i] = (double)values[i] / total;
+  }
+  return result;
+}
+
+/**
+ * @brief Reads a number of the baseline, the json has no accessor for
+ * doubles so it is dumped and converted.
+ */
+static bool baseline_value(const Json::JsonReader &entry, const char *key, double &value) {
+  auto number = entry.get(key);
+  if (number.type() != JsonType::floating_point && number.type() != JsonType::integer)
+    return false;
+  value = std::strtod(number.dump().c_str(),nullptr);
+  return true;
+}
+
+/**
+ * @brief Parses the corpus of bench/corpus.hpp and the fuzzing corpus with
+ * copied and with borrowed strings and prints the throughput and the
+ * hardware events per byte.
+ *
+ * --write-baseline <file> stores the results as json, --baseline <file>
+ * compares against such a file and fails if the instructions per byte of
+ * any entry grow by more than --threshold (0.1 by default). Instructions
+ * hardly depend on the load of the machine, the throughput does, so drops
+ * of the throughput are only reported unless --gate-throughput is given.
+ * If nothing could be compared, e.g. without an instruction counter, the
+ * check fails as well. --repetitions <n> sets the repetitions per entry.
+ */
+int main(int argc, char **argv) {
+  std::string baseline_path;
+  std::string write_path;
+  double threshold = 0.1;
+  int repetitions = 5;
+  bool gate_throughput = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--gate-throughput")
+      gate_throughput = true;
+    else if (i+1 < argc && arg == "--baseline")
+      baseline_path = argv[++i];
+    else if (i+1 < argc && arg == "--write-baseline")
+      write_path = argv[++i];
+    else if (i+1 < argc && arg == "--threshold")
+      threshold = std::atof(argv[++i]);
+    else if (i+1 < argc && arg == "--repetitions")
+      repetitions = std::max(1,std::atoi(argv[++i]));
+    else {
+      std::fprintf(stderr,"Usage: %s [--baseline file] [--write-baseline file] [--threshold fraction] [--repetitions n] [--gate-throughput]\n",argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<Document> corpus = load_corpus();
+  std::vector<Document> fuzz_corpus = load_fuzz_corpus();
+  std::vector<std::pair<std::string,std::vector<const Document*>>> entries;
+  for (const auto &doc : corpus)
+    entries.push_back({doc.name,{&doc}});
+  if (!fuzz_corpus.empty()) {
+    entries.push_back({"fuzz_corpus",{}});
+    for (const auto &doc : fuzz_corpus)
+      entries.back().second.push_back(&doc);
+  }
+
+  JsonParseOptions borrow;
+  borrow.borrow_strings = true;
+  PerfCounters counters;
+  std::vector<PerfResult> results;
+  for (const auto &entry : entries) {
+    results.push_back(measure(entry.first,entry.second,JsonParseOptions(),repetitions,counters));
+    results.push_back(measure(entry.first + "+borrow",entry.second,borrow,repetitions,counters));
+  }
+
+  std::printf("%-28s %10s","entry","MB/s");
+  for (int i = 0; i < PerfCounters::count; i++)
+    std::printf(" %15s",(std::string(PerfCounters::names[i]) + "/B").c_str());
+  std::printf("\n");
+  for (const auto &result : results) {
+    std::printf("%-28s %10.1f",result.name.c_str(),result.mb_per_s);
+    for (int i = 0; i < PerfCounters::count; i++) {
+      if (result.counted[i])
+        std::printf(" %15.4f",result.per_byte[i]);
+      else
+        std::printf(" %15s","n/a");
+    }
+    std::printf("\n");
+  }
+
+  if (!write_path.empty()) {
+    // One entry per line in measurement order keeps the baseline diffable.
+    std::ofstream out(write_path);
+    out << "{\n";
+    for (std::size_t r = 0; r < results.size(); r++) {
+      FlatJson entry;
+      entry.set("mb_per_s",results[r].mb_per_s);
+      for (int i = 0; i < PerfCounters::count; i++) {
+        if (results[r].counted[i])
+          entry.set(std::string(PerfCounters::names[i]) + "_per_byte",results[r].per_byte[i]);
+      }
+      out << "  " << FlatJson(std::string(results[r].name)).dump() << ":" << entry.dump() << (r+1 < results.size() ? ",\n" : "\n");
+    }
+    out << "}\n";
+  }
+
+  if (baseline_path.empty())
+    return 0;
+  auto baseline = Json::parse(read_file(baseline_path),[](Json::JsonParser&){});
+  if (baseline.has_error()) {
+    std::fprintf(stderr,"Can not read the baseline %s\n",baseline_path.c_str());
+    return 2;
+  }
+  int regressions = 0;
+  int compared = 0;
+  for (const auto &result : results) {
+    auto entry = baseline.reader().get(result.name);
+    double mb_per_s = 0;
+    double instructions = 0;
+    if (baseline_value(entry,"mb_per_s",mb_per_s)) {
+      if (gate_throughput)
+        compared++;
+      if (result.mb_per_s < mb_per_s*(1-threshold)) {
+        std::printf("%s %s: %.1f MB/s, baseline %.1f MB/s\n",gate_throughput ? "Regression" : "Slower",result.name.c_str(),result.mb_per_s,mb_per_s);
+        if (gate_throughput)
+          regressions++;
+      }
+    }
+    if (!result.counted[1] || !baseline_value(entry,"instructions_per_byte",instructions))
+      continue;
+    compared++;
+    if (result.per_byte[1] > instructions*(1+threshold)) {
+      std::printf("Regression %s: %.2f instructions/B, baseline %.2f instructions/B\n",result.name.c_str(),result.per_byte[1],instructions);
+      regressions++;
+    }
+  }
+  // A check which compares nothing must not pass silently.
+  if (!compared) {
+    std::fprintf(stderr,"Nothing compared, instructions/B are not counted here or missing in %s\n",baseline_path.c_str());
+    return 2;
+  }
+  std::printf("%d regressions against %s with a threshold of %.0f%%\n",regressions,baseline_path.c_str(),threshold*100);
+  return regressions ? 1 : 0;
+}
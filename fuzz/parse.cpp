@@ -0,0 +1,76 @@
+#include "../json_parser.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+/**
+ * @brief Parses the dump of a json again and checks that it reproduces the
+ * dump, flat objects keep duplicate keys and their order comparable.
+ */
+static void check_round_trip(FlatJson &js) {
+  std::string dumped = js.dump();
+  bool failed = false;
+  auto again = FlatJson::parse(dumped,[&failed](FlatJson::JsonParser&){failed = true;});
+  // Borrowed strings are dumped with their original escapes, the second
+  // dump is compared once these are resolved.
+  if (failed || FlatJson::parse(again.dump(),[](FlatJson::JsonParser&){}).dump() != again.dump())
+    std::abort();
+}
+
+/**
+ * @brief Parses the input with Json::parse(...) and with parse_parallel(...),
+ * which consumes a structural index, and borrowed strings. The parser accepts a superset of json, therefore
+ * only the sanitizers and the round trip of every parsed json are checked.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) {
+  std::string_view text(reinterpret_cast<const char*>(data),size);
+  auto js = Json::parse(text,[](Json::JsonParser&){});
+  js.dump();
+
+  bool failed = false;
+  auto flat = FlatJson::parse(text,[&failed](FlatJson::JsonParser&){failed = true;});
+  if (!failed)
+    check_round_trip(flat);
+
+  JsonParseOptions options;
+  options.borrow_strings = true;
+  failed = false;
+  auto indexed = FlatJson::parse_parallel(text,[&failed](FlatJson::JsonParser&){failed = true;},options,1);
+  if (!failed)
+    check_round_trip(indexed);
+  return 0;
+}
+
+#if !defined(GC_JSON_LIBFUZZER)
+/**
+ * @brief Runs every file given, directly or inside a given directory,
+ * through the fuzz target once. Replays a corpus with compilers which have
+ * no libFuzzer.
+ */
+int main(int argc, char **argv) {
+  std::size_t inputs = 0;
+  auto run = [&inputs](const std::filesystem::path &path) {
+    std::ifstream file(path,std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string input = content.str();
+    LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(input.data()),input.size());
+    inputs++;
+  };
+  for (int i = 1; i < argc; i++) {
+    if (std::filesystem::is_directory(argv[i])) {
+      for (const auto &entry : std::filesystem::directory_iterator(argv[i])) {
+        if (entry.is_regular_file())
+          run(entry.path());
+      }
+    }
+    else
+      run(argv[i]);
+  }
+  std::printf("Executed %zu inputs\n",inputs);
+  return 0;
+}
+#endif
@@ -2,8 +2,63 @@
 #define GC_JSON_PARSER_HPP
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <clocale>
+#include <atomic>
+#include <chrono>
+#if !defined(GC_JSON_NO_THREADS)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+#include <cfloat>
+#include <climits>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <array>
+#include <optional>
+#include <tuple>
+#if !defined(GC_JSON_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define GC_JSON_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#if !defined(GC_JSON_NO_SIMD)
+#if defined(__x86_64__) || defined(_M_X64)
+#define GC_JSON_X86
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define GC_JSON_AVX2_DISPATCH
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define GC_JSON_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 /**
  * @author Alexander Leonhardt.
  */
@@ -27,6 +82,7 @@ enum class JsonType {
 enum class JsonLogLevel {
   none = 0,   ///< Log nothing at all
   log_error,  ///< Log only errors to the provided logging functor
+  log_stats,  ///< Log errors and collect JsonParseStats while parsing
   log_trace   ///< Log trace information to the logging functor
 };
 
@@ -72,1520 +128,9633 @@ struct JsonStdoutColoredFunctor {
 };
 
 /**
- * @brief Describes the JsonBase class contains all helper functions to deal
- * with the underlying interface.
- *
- * @tparam log_level The log level at the moment unused TODO: Implement this
- * feature
- * @tparam log_functor The function to log results at the moment unused TODO:
- * Implement this feature
+ * @brief A monotonic memory arena. Hands out memory from a list of large
+ * contiguous blocks and releases all blocks at once on destruction, single
+ * allocations are never freed.
  */
-template<JsonLogLevel log_level=JsonLogLevel::none, typename log_functor=JsonStdoutColoredFunctor>
-class JsonBase {
+class JsonArena {
   public:
     /**
-     * @brief The Basic interface to interact with, can be Object, Array,
-     * String, Integer or Boolean, therefore it provides functions for all of
-     * these implementations
+     * @brief Creates an empty arena, the first block is allocated on the first
+     * call to allocate(...)
+     *
+     * @param block_size The size of the first block, every following block
+     * doubles in size.
      */
-    class JsonInterface {
-      public:
-        /**
-         * @brief Returns the type of the underlying implementation can be
-         * anything of JsonType.
-         *
-         * @return The type of the implementation
-         */
-        virtual JsonType type() = 0;
+    JsonArena(std::size_t block_size = 64*1024) : head_(nullptr), pos_(nullptr), end_(nullptr), next_block_size_(block_size), reserved_(0), kept_(nullptr), next_kept_(nullptr) {
+    }
 
-        /**
-         * @brief Returns the size of the implementation is 1 for all primitive
-         * data types or the container size for more complex types
-         *
-         * @return The size of the underlying container or 1 for a primitive
-         * type.
-         */
-        virtual int size() = 0;
-        
-        /**
-         * @brief Inserts the key into the underlying container, illegal
-         * operation for all primitive data types. The standard definition
-         * states not implemented to reduce the boilerplate amount
-         *
-         * @param key The key must be "" for an array and must be non empty for
-         * an object insertion
-         * @param new_insert The new Json to insert into the container
-         * @param err A reference to the error will fill the error if an error
-         * occured, does not change the err otherwise
-         */
-        virtual void insert(const std::string &key, JsonBase *new_insert, JsonError &err) {
-          err = JsonError::not_implemented;
-        }
+    /**
+     * @brief Delete the copy constructor, the blocks can only have one owner.
+     */
+    JsonArena(const JsonArena &) = delete;
 
-        /**
-         * @brief Returns the JsonBase for the given key, this operation is only
-         * valid for json objects. For unimplemented cases sets the err field to
-         * JsonError::not_implemented and returns an nullptr
-         *
-         * @param key The key to search for in the object
-         * @param err A reference to an error, will fill the error if an error
-         * occurs and does not touch the variable otherwise
-         *
-         * @return The found JsonObject or nullptr if there is no object with
-         * this key name
-         */
-        virtual JsonBase* get(const std::string &key, JsonError &err) {
-          err = JsonError::not_implemented;
-          return nullptr;
-        }
+    /**
+     * @brief Delete the copy assignment, the blocks can only have one owner.
+     */
+    JsonArena &operator=(const JsonArena &) = delete;
 
-        /**
-         * @brief Return the Json at the given base index, the interface does
-         * not require out of bound checking! This function is implemented in
-         * json array types. For unimplemented cases set the err field to
-         * JsonError::not_implemented and return nullptr
-         *
-         * @param index The index to access.
-         * @param err A reference to an error instance, the function will set
-         * the error if one occurs and does not touch the error otherwise
-         *
-         * @return 
-         */
-        virtual JsonBase* get(const int index, JsonError &err) {
-          err = JsonError::not_implemented;
-          return nullptr;
-        }
-        
-        /**
-         * @brief Converts the json into a string. 
-         *
-         * @return The json converted to string format
-         */
-        virtual std::string dump() = 0;
+    /**
+     * @brief Releases all blocks of the arena at once.
+     */
+    ~JsonArena() {
+      while (kept_) {
+        JsonArena *next = kept_->next_kept_;
+        delete kept_;
+        kept_ = next;
+      }
+      while (head_) {
+        Block *next = head_->next;
+        ::operator delete(head_);
+        head_ = next;
+      }
+    }
 
-        /**
-         * @brief Returns the stored string is only implemented for
-         * JsonType::string. For unimplemented cases set the err field to
-         * JsonError::unimplemented and return an empty string
-         *
-         * @param err Fills the error if the underlying type is not of type
-         * JsonType::string 
-         *
-         * @return Returns the contained string if the type fits.
-         */
-        virtual std::string to_string(JsonError &err) {
-          err = JsonError::not_implemented;
-          return "";
-        }
+    /**
+     * @brief Returns size bytes of memory aligned to alignment. The memory
+     * stays valid until the arena is destroyed.
+     *
+     * @param size The number of bytes to allocate.
+     * @param alignment The alignment of the returned memory, must be a power
+     * of two.
+     *
+     * @return A pointer to the allocated memory.
+     */
+    void *allocate(std::size_t size, std::size_t alignment) {
+      char *ptr = align(pos_, alignment);
+      if (!ptr || ptr + size > end_) {
+        grow(size + alignment);
+        ptr = align(pos_, alignment);
+      }
+      pos_ = ptr + size;
+      return ptr;
+    }
 
-        /**
-         * @brief Returns the stored int if the underlying type is integer, for
-         * unimplemented cases set error field to JsonError::not_implemented and
-         * return -1.
-         *
-         * @param err A reference to an error, the error gets filled if the
-         * undelrying type is not JsonType::integer. 
-         *
-         * @return Return the stored integer if there is any
-         */
-        virtual long long to_int(JsonError &err) {
-          err = JsonError::not_implemented;
-          return -1;
-        }
-        
-        /**
-         * @brief Returns the stored boolean if the underlying type is boolean,
-         * for unimplemented cases set the error field to
-         * JsonError::not_implemented and return false.
-         *
-         * @param err A reference to an error instance, it is filled if the
-         * underlying type is not JsonType::boolean
-         *
-         * @return Returns the stored boolean if there is any
-         */
-        virtual bool to_bool(JsonError &err) {
-          err = JsonError::not_implemented;
-          return false;
-        }
+    /**
+     * @brief Takes over all blocks of the other arena, they are released
+     * together with the blocks of this arena. The other arena is empty
+     * afterwards.
+     *
+     * @param other The arena to take the blocks from.
+     */
+    void adopt(JsonArena &other) {
+      if (!other.head_)
+        return;
+      // Keep our current block in front so the bump pointer stays valid and
+      // chain the blocks of the other arena behind it.
+      Block *tail = other.head_;
+      while (tail->next)
+        tail = tail->next;
+      if (head_) {
+        tail->next = head_->next;
+        head_->next = other.head_;
+      }
+      else {
+        head_ = other.head_;
+        pos_ = other.pos_;
+        end_ = other.end_;
+      }
+      reserved_ += other.reserved_;
+      other.head_ = nullptr;
+      other.pos_ = other.end_ = nullptr;
+      other.reserved_ = 0;
+    }
 
-        /**
-         * @brief Returns the stored double value if the underlying type is
-         * boolean, for unimplemented cases set the error field to
-         * JsonError::not_implemented and return 0
-         *
-         * @param err A reference to an error instance, it if filled if the
-         * underlying type is not JsonType::double
-         *
-         * @return  Returns the stored double or 0 if it is not an double
-         */
-        virtual double to_double(JsonError &err) {
-          err = JsonError::not_implemented;
-          return 0;
-        }
+    /**
+     * @brief Takes over the blocks of the other arena and the arena object
+     * itself, which is released together with this arena. Nodes still
+     * allocating from the other arena therefore stay valid.
+     *
+     * @param other The arena created with new to take over.
+     */
+    void keep(JsonArena *other) {
+      adopt(*other);
+      other->next_kept_ = kept_;
+      kept_ = other;
+    }
 
-        /**
-         * @brief Creates an empty destructor to make sure that the inheriting
-         * implementations can call their constructor instead
-         */
-        virtual ~JsonInterface() {};
+    /**
+     * @brief Returns the number of bytes reserved from the system by this
+     * arena.
+     *
+     * @return The summed size of all blocks.
+     */
+    std::size_t bytes_reserved() const {
+      return reserved_;
+    }
+
+  private:
+    /**
+     * @brief The header of every block, the usable memory follows directly
+     * after the header.
+     */
+    struct alignas(std::max_align_t) Block {
+      Block *next;  ///< The next block in the list
     };
 
     /**
-     * @brief The implementation of a json object, implements the necesarry
-     * functions of JsonInterface and feeds an error to the unsupported
-     * functions
+     * @brief Aligns the given pointer to the next multiple of alignment.
      */
-    class JsonImplObject : public JsonInterface {
-      public:
-        /**
-         * @brief Returns the type of the Implementation, is always
-         * JsonType::object for this class
-         *
-         * @return Returns JsonType::object.
-         */
-        JsonType type() override {
-          return JsonType::object;
-        }
+    static char *align(char *ptr, std::size_t alignment) {
+      std::uintptr_t value = reinterpret_cast<std::uintptr_t>(ptr);
+      return reinterpret_cast<char*>((value + alignment - 1) & ~(std::uintptr_t)(alignment - 1));
+    }
 
-        /**
-         * @brief Returns the size of the json container, is always the size of
-         * the container.
-         *
-         * @return Returns the number of stored attributes.
-         */
-        int size() override {
-          return traits_.size();
-        }
+    /**
+     * @brief Allocates a new block with at least min_size usable bytes and
+     * makes it the current block.
+     */
+    void grow(std::size_t min_size) {
+      std::size_t size = next_block_size_;
+      while (size < min_size)
+        size *= 2;
+      next_block_size_ = size*2;
+
+      Block *block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+      block->next = head_;
+      head_ = block;
+      pos_ = reinterpret_cast<char*>(block + 1);
+      end_ = pos_ + size;
+      reserved_ += size;
+    }
 
-        /**
-         * @brief Inserts a new attribute with the given key into the map if the
-         * key exists overwrite the existent key and delete the stored object.
-         *
-         * @param key The key to insert/overrwrite inside the map
-         * @param new_insert The object to include into the map, this function
-         * takes memory ownership. This means the object gets deleted by the
-         * destructor of this class. Make sure there are no multiple ownerships.
-         * @param err A reference to an error instance, this puts
-         * JsonError::empty_attribute_key inside the error if the key is empty
-         */
-        void insert(const std::string &key, JsonBase *new_insert, JsonError &err) override {
-          // Check if key is non empty
-          if (key=="")
-            err = JsonError::empty_attribute_key;
-          else {
-            // Ok key is nonempty swap the key inside the map, if the key does
-            // not exist yet, the map will put nullptr inside new_insert
-            std::swap(traits_[key],new_insert);
-            
-            // If there was an object with that key stored before delete the
-            // object
-            if (new_insert)
-              delete new_insert;
-          }
-        }
+    Block *head_;                  ///< The block which is currently used for allocations
+    char *pos_;                    ///< The next free byte in the current block
+    char *end_;                    ///< One past the last byte of the current block
+    std::size_t next_block_size_;  ///< The size of the next block to allocate
+    std::size_t reserved_;         ///< The number of bytes reserved in all blocks
+    JsonArena *kept_;              ///< The first arena taken over with keep(...)
+    JsonArena *next_kept_;         ///< The next arena kept by the same arena
+};
 
-        /**
-         * @brief Returns the Json associated with the given key, if the key
-         * does not exist returns nullptr
-         *
-         * @param key The key to look for inside the map
-         * @param err The error will get filled when accessing an element that
-         * does not exist with JsonError::does_not_exist
-         *
-         * @return The Json object if found or nullptr otherwise
-         */
-        JsonBase* get(const std::string &key, JsonError &err) override {
-          auto fnd = traits_.find(key);
-          if (fnd == traits_.end()) {
-            err = JsonError::does_not_exist;
-            return nullptr;
-          }
-          return fnd->second;
-        }
+/**
+ * @brief A standard library allocator which allocates from a JsonArena. An
+ * allocator without arena falls back to the heap, this is used for short
+ * lived temporaries like lookup keys.
+ *
+ * @tparam T The type to allocate.
+ */
+template<typename T>
+struct JsonArenaStlAllocator {
+  using value_type = T;
 
-        /**
-         * @brief Converts the json object into a string and returns the string
-         *
-         * @return 
-         */
-        std::string dump() override {
-          // Check if the json object is empty if so return the equivalent of an
-          // empty json
-          if(traits_.size() == 0)
-            return "{}";
-
-          // Ok the json is not empty open the beginning brackets and dump every
-          // attribute inside the json
-          std::string ret = "{";
-          for (const auto &it : traits_) {
-            ret += "\""+it.first+"\":";
-            ret += std::move(it.second->dump());
+  JsonArenaStlAllocator(JsonArena *arena = nullptr) : arena_(arena) {
+  }
 
-            // Always put an , after every attribute it will come in handy in
-            // the end
-            ret += ",";
-          }
-          // Overwrite the last , as the map was not empty we will have at least
-          // one iteration in the loop and always an , at the end of the string.
-          // The size of the string does not change so we can do this operation
-          // without worrying much.
-          ret[ret.length()-1] = '}';
-          return std::move(ret);
-        }
+  template<typename U>
+  JsonArenaStlAllocator(const JsonArenaStlAllocator<U> &other) : arena_(other.arena_) {
+  }
 
-        /**
-         * @brief This is actually a non derived function and executes the
-         * function func on every pair inside the map.
-         *
-         * @param func The function to apply on each element in the json object
-         */
-        void map_for_each(std::function<void(const std::string &, JsonBase&)> &func) {
-          for(const auto &it : traits_) {
-            func(it.first,*it.second);
-          }
-        }
+  T *allocate(std::size_t n) {
+    if (!arena_)
+      return static_cast<T*>(::operator new(n*sizeof(T)));
+    return static_cast<T*>(arena_->allocate(n*sizeof(T), alignof(T)));
+  }
 
-        /**
-         * @brief Cleans up the accquired memory will delete all pointers given
-         * to this class in the method insert(...)
-         */
-        ~JsonImplObject() {
-          for(const auto &it : traits_) 
-            delete it.second;
-        }
-      private:
-        std::unordered_map<std::string, JsonBase*> traits_; ///< Saves the attribute, Value pair of a json object
-    };
+  void deallocate(T *ptr, std::size_t) {
+    // Arena memory is released together with the arena.
+    if (!arena_)
+      ::operator delete(ptr);
+  }
 
-    /**
-     * @brief The basic implementation of a json string
-     */
-    class JsonImplString : public JsonInterface  {
-      public:
-        /**
-         * @brief Initialises the string from a given string
-         *
-         * @param initialise_value The string to initialise the value with
-         */
-        JsonImplString(std::string initialise_value="") : content_(std::move(initialise_value)) {
-        }
+  template<typename U>
+  bool operator==(const JsonArenaStlAllocator<U> &other) const {
+    return arena_ == other.arena_;
+  }
 
-        /**
-         * @brief Returns JsonType::string as type.
-         *
-         * @return Return always JsonType::string
-         */
-        JsonType type() override {
-          return JsonType::string;
-        }
+  template<typename U>
+  bool operator!=(const JsonArenaStlAllocator<U> &other) const {
+    return arena_ != other.arena_;
+  }
 
-        /**
-         * @brief Returns the size of the container, as this is an primitive
-         * type always return 1.
-         *
-         * @return Returns always 1
-         */
-        int size() override {
-          return 1;
-        }
+  JsonArena *arena_;  ///< The arena to allocate from, nullptr means heap
+};
 
-        /**
-         * @brief Converts the underlying string into a json string
-         *
-         * @return Return the string representation of a json string
-         */
-        std::string dump() override {
-          return "\""+content_+"\"";
-        }
+/**
+ * @brief The default allocation policy of JsonBase, every node is allocated
+ * with new and freed with delete.
+ */
+struct JsonHeapAllocator {
+  template<typename T>
+  using stl_allocator = std::allocator<T>;
 
-        /**
-         * @brief Returns a copy to the saved string
-         *
-         * @param err Always leave err untouched
-         *
-         * @return Returns always the saved string 
-         */
-        std::string to_string(JsonError &err) override {
-          return content_;
-        }
+  /**
+   * @brief Returns the standard library allocator for containers inside the
+   * nodes.
+   */
+  template<typename T>
+  stl_allocator<T> stl() {
+    return stl_allocator<T>();
+  }
 
+  /**
+   * @brief Creates a new object of type T on the heap.
+   */
+  template<typename T, typename... Args>
+  T *create(Args&&... args) {
+    return new T(std::forward<Args>(args)...);
+  }
 
-      private:
-        std::string content_; ///< Saves the content of the json string
-    };
+  /**
+   * @brief Deletes an object created with create(...).
+   */
+  template<typename T>
+  void destroy(T *ptr) {
+    delete ptr;
+  }
 
+  /**
+   * @brief Returns the allocator to hand to child nodes.
+   */
+  JsonHeapAllocator child() {
+    return *this;
+  }
 
-    /**
-     * @brief The basic implementation of a json null value.
-     */
-    class JsonImplNull : public JsonInterface  {
-      public:
-        /**
-         * @brief Returns JsonType::string as type.
-         *
-         * @return Return always JsonType::string
-         */
-        JsonType type() override {
-          return JsonType::null;
-        }
+  /**
+   * @brief Nothing to take over, heap nodes own themselves.
+   */
+  void adopt(JsonHeapAllocator &) {
+  }
+};
 
-        /**
-         * @brief Returns the size of the container, as this is an primitive
-         * type always return 1.
-         *
-         * @return Returns always 1
-         */
-        int size() override {
-          return 1;
-        }
+/**
+ * @brief The arena allocation policy of JsonBase. All nodes of one document
+ * live inside one JsonArena, destroying a node does nothing and the whole
+ * document is released at once when the owning root JsonBase dies.
+ */
+class JsonArenaAllocator {
+  public:
+    template<typename T>
+    using stl_allocator = JsonArenaStlAllocator<T>;
 
-        /**
-         * @brief Converts the underlying string into a json string
-         *
-         * @return Return the string representation of a json string
-         */
-        std::string dump() override {
-          return "null";
-        }
-    };
+    /**
+     * @brief Creates an owning allocator, the arena is created lazily on the
+     * first allocation.
+     */
+    JsonArenaAllocator() : arena_(nullptr), owner_(true) {
+    }
 
+    JsonArenaAllocator(const JsonArenaAllocator &) = delete;
+    JsonArenaAllocator &operator=(const JsonArenaAllocator &) = delete;
 
     /**
-     * @brief The basic implementation of a json double value
+     * @brief Moves the arena and the ownership from the other allocator.
      */
-    class JsonImplDouble : public JsonInterface  {
-      public:
-        /**
-         * @brief Initialises the string from a given string
-         *
-         * @param initialise_value The string to initialise the value with
-         */
-        JsonImplDouble(double value) : value_(value) {
-        }
-
-        /**
-         * @brief Returns JsonType::string as type.
-         *
-         * @return Return always JsonType::string
-         */
-        JsonType type() override {
-          return JsonType::floating_point;
-        }
+    JsonArenaAllocator(JsonArenaAllocator &&other) noexcept : arena_(other.arena_), owner_(other.owner_) {
+      other.arena_ = nullptr;
+      other.owner_ = true;
+    }
 
-        /**
-         * @brief Returns the size of the container, as this is an primitive
-         * type always return 1.
-         *
-         * @return Returns always 1
-         */
-        int size() override {
-          return 1;
-        }
+    /**
+     * @brief Releases the arena if this allocator owns it.
+     */
+    ~JsonArenaAllocator() {
+      if (owner_)
+        delete arena_;
+    }
 
-        /**
-         * @brief Converts the underlying string into a json string
-         *
-         * @return Return the string representation of a json string
-         */
-        std::string dump() override {
-          std::string k;
-          k.reserve(50);
-          snprintf(&k[0],k.capacity(),"%f",value_);
-          return std::move(k);
-        }
+    template<typename T>
+    stl_allocator<T> stl() {
+      return stl_allocator<T>(&arena());
+    }
 
-        /**
-         * @brief Returns the double value and never sets the error field.
-         *
-         * @param err Never sets the error field to anything
-         *
-         * @return Returns the saved double
-         */
-        double to_double(JsonError &err) {
-          return value_;
-        }
+    /**
+     * @brief Creates a new object of type T inside the arena.
+     */
+    template<typename T, typename... Args>
+    T *create(Args&&... args) {
+      return new (arena().allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
 
+    /**
+     * @brief Does nothing, the destructor is intentionally skipped as all
+     * memory of the node including its containers lives inside the arena.
+     */
+    template<typename T>
+    void destroy(T *) {
+    }
 
+    /**
+     * @brief Returns a non owning allocator sharing the arena of this one.
+     */
+    JsonArenaAllocator child() {
+      JsonArenaAllocator ret;
+      ret.arena_ = &arena();
+      ret.owner_ = false;
+      return ret;
+    }
 
-      private:
-        double value_; ///< Saves the content of the json string
-    };
+    /**
+     * @brief Takes over the ownership of the arena of other if other owns
+     * one. Used when a document is moved into a node of another document so
+     * both are released together.
+     *
+     * @param other The allocator to take the arena from.
+     */
+    void adopt(JsonArenaAllocator &other) {
+      if (!other.owner_ || !other.arena_)
+        return;
+      if (other.arena_ == arena_) {
+        owner_ = true;
+        other.owner_ = false;
+        return;
+      }
+      if (!arena_) {
+        arena_ = other.arena_;
+        owner_ = true;
+      }
+      else
+        // Children of other may still allocate from its arena.
+        arena_->keep(other.arena_);
+      other.arena_ = nullptr;
+    }
 
     /**
-     * @brief The basic implementation for a Json array, contains a list of
-     * other Json objects
+     * @brief Returns the arena and creates it if there is none yet.
      */
-    class JsonImplArray : public JsonInterface {
-      public:
-        /**
-         * @brief Returns the type JsonType::array.
-         *
-         * @return Always returns the type JsonType::array.
-         */
-        JsonType type() override {
-          return JsonType::array;
-        }
+    JsonArena &arena() {
+      if (!arena_)
+        arena_ = new JsonArena();
+      return *arena_;
+    }
 
-        /**
-         * @brief Returns the size of the Json array which is always equivalent
-         * to the number of items contained.
-         *
-         * @return The size of the Json array
-         */
-        int size() override {
-          return vec_.size();
-        }
+  private:
+    JsonArena *arena_;  ///< The arena all nodes are allocated in
+    bool owner_;        ///< True if this allocator releases the arena
+};
 
-        /**
-         * @brief Inserts a new value inside the Json array, sets error to
-         * JsonError::not_implemented when a key is supplied!
-         *
-         * @param key The key must always be empty as this is not an Json object
-         * @param new_insert The inserted object can be any type
-         * @param err Leaves the error untouched if the key is empty, if there
-         * is a non empty key sets the error to JsonError::not_implemented
-         */
-        void insert(const std::string &key, JsonBase *new_insert, JsonError &err) override {
-          if (key != "") 
-            err = JsonError::not_implemented;
-          else 
-            vec_.push_back(new_insert);
+/**
+ * @brief Appends the escaped json string in to out and resolves all escape
+ * sequences. Unknown escape sequences are replaced by the escaped character.
+ *
+ * @param in The characters between the quotes of a json string.
+ * @param out The string to append the unescaped characters to.
+ */
+template<typename String>
+void json_unescape(std::string_view in, String &out) {
+  out.reserve(out.size()+in.size());
+  for (std::size_t i = 0; i < in.size(); i++) {
+    // Copy everything up to the next escape sequence in one go.
+    const void *next = std::memchr(in.data()+i,'\\',in.size()-i);
+    std::size_t escape = next ? static_cast<const char*>(next)-in.data() : in.size();
+    out.append(in.data()+i,escape-i);
+    i = escape;
+    if (i >= in.size())
+      break;
+    if (i+1 == in.size()) {
+      out += '\\';
+      break;
+    }
+    switch (in[++i]) {
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        // Reads the 4 hex digits following position pos into value.
+        auto read_hex = [&in](std::size_t pos, unsigned &value) {
+          if (pos+4 > in.size())
+            return false;
+          value = 0;
+          for (std::size_t k = pos; k < pos+4; k++) {
+            char c = in[k];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c-'0';
+            else if (c >= 'a' && c <= 'f') value |= c-'a'+10;
+            else if (c >= 'A' && c <= 'F') value |= c-'A'+10;
+            else return false;
+          }
+          return true;
+        };
+
+        unsigned code;
+        if (!read_hex(i+1,code)) {
+          out += 'u';
+          break;
+        }
+        i += 4;
+        // Combine surrogate pairs into one code point.
+        unsigned low;
+        if (code >= 0xD800 && code <= 0xDBFF && i+2 < in.size() && in[i+1] == '\\' && in[i+2] == 'u' && read_hex(i+3,low) && low >= 0xDC00 && low <= 0xDFFF) {
+          code = 0x10000 + ((code-0xD800)<<10) + (low-0xDC00);
+          i += 6;
         }
 
-        /**
-         * @brief Returns the json object at the given index, does not perform
-         * any boundary checking!!
-         *
-         * @param index Accesses the index at the given position.
-         * @param err Never sets the error to any value
-         *
-         * @return Returns the Json object at the given index
-         */
-        JsonBase* get(const int index, JsonError &err) override {
-          return vec_[index];
+        // Encode the code point as utf-8
+        if (code < 0x80)
+          out += (char)code;
+        else if (code < 0x800) {
+          out += (char)(0xC0 | (code>>6));
+          out += (char)(0x80 | (code&0x3F));
+        }
+        else if (code < 0x10000) {
+          out += (char)(0xE0 | (code>>12));
+          out += (char)(0x80 | ((code>>6)&0x3F));
+          out += (char)(0x80 | (code&0x3F));
         }
+        else {
+          out += (char)(0xF0 | (code>>18));
+          out += (char)(0x80 | ((code>>12)&0x3F));
+          out += (char)(0x80 | ((code>>6)&0x3F));
+          out += (char)(0x80 | (code&0x3F));
+        }
+        break;
+      }
+      default: out += in[i]; break;
+    }
+  }
+}
 
-        /**
-         * @brief Returns the array converted to a string, also converts all
-         * objects in the array to a string 
-         *
-         * @return Creates a string out of the given Json array 
-         */
-        std::string dump() override {
-          // Return an empty list if there are no members
-          if(vec_.size() == 0)
-            return "[]";
+/**
+ * @brief Appends in to out and escapes all characters which must not appear
+ * unescaped inside a json string.
+ *
+ * @param in The unescaped string.
+ * @param out The string to append the escaped characters to.
+ */
+template<typename String>
+void json_escape(std::string_view in, String &out) {
+  static const char hex[] = "0123456789abcdef";
+  std::size_t run = 0;
+  for (std::size_t i = 0; i < in.size(); i++) {
+    unsigned char c = in[i];
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+    // Copy the unescaped run in one go before writing the escape sequence.
+    out.append(in.data()+run,i-run);
+    run = i+1;
+    switch (c) {
+      case '"':  out.append("\\\"",2); break;
+      case '\\': out.append("\\\\",2); break;
+      case '\b': out.append("\\b",2); break;
+      case '\f': out.append("\\f",2); break;
+      case '\n': out.append("\\n",2); break;
+      case '\r': out.append("\\r",2); break;
+      case '\t': out.append("\\t",2); break;
+      default: {
+        char seq[6] = {'\\','u','0','0',hex[c>>4],hex[c&0xF]};
+        out.append(seq,6);
+      }
+    }
+  }
+  out.append(in.data()+run,in.size()-run);
+}
 
-          // The list starts with [ so set it.
-          std::string ret = "[";
+/**
+ * @brief Returns the index of the lowest set bit, x must not be 0.
+ */
+inline int json_trailing_zeros(std::uint64_t x) {
+#if defined(_MSC_VER)
+  unsigned long ret;
+  _BitScanForward64(&ret,x);
+  return (int)ret;
+#else
+  return __builtin_ctzll(x);
+#endif
+}
 
-          // Dump every json object inside the list
-          for (auto it : vec_) {
-            ret += std::move(it->dump());
+/**
+ * @brief Searches the first '"' or '\\' in [begin,end), compares 32 bytes at
+ * once with AVX2 builds, 16 bytes with SSE2 or NEON and one byte otherwise.
+ *
+ * @param begin The first character to check.
+ * @param end One past the last character to check.
+ *
+ * @return The position of the found character or end if there is none.
+ */
+inline const char *json_find_quote_or_backslash(const char *begin, const char *end) {
+#if defined(GC_JSON_X86)
+#if defined(__AVX2__)
+  const __m256i quote32 = _mm256_set1_epi8('"');
+  const __m256i backslash32 = _mm256_set1_epi8('\\');
+  for (; end - begin >= 32; begin += 32) {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    std::uint32_t mask = (std::uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(in,quote32),_mm256_cmpeq_epi8(in,backslash32)));
+    if (mask)
+      return begin + json_trailing_zeros(mask);
+  }
+#endif
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  for (; end - begin >= 16; begin += 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(in,quote),_mm_cmpeq_epi8(in,backslash)));
+    if (mask)
+      return begin + json_trailing_zeros(mask);
+  }
+#elif defined(GC_JSON_NEON)
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  for (; end - begin >= 16; begin += 16) {
+    uint8x16_t in = vld1q_u8(reinterpret_cast<const std::uint8_t*>(begin));
+    // Found something, the byte loop below locates it inside this block.
+    if (vmaxvq_u8(vorrq_u8(vceqq_u8(in,quote),vceqq_u8(in,backslash))))
+      break;
+  }
+#endif
+  for (; begin < end; ++begin) {
+    if (*begin == '"' || *begin == '\\')
+      return begin;
+  }
+  return end;
+}
 
-            // Always put a , into the list
-            ret += ",";
-          }
-          // Convert the last , into a closing ]. There always is a , as the
-          // list is never empty
-          ret[ret.length()-1] = ']';
-          // Moves the temporary string back to the callee
-          return std::move(ret);
-        }
+/**
+ * @brief The result of json_parse_number.
+ */
+struct JsonNumber {
+  bool is_float;       ///< True if the number has a fraction, an exponent or does not fit into a long long
+  long long integer;   ///< The value if is_float is false
+  double floating;     ///< The value if is_float is true
+};
 
-        /**
-         * @brief Deletes all items in the array.
-         */
-        ~JsonImplArray() {
-          for(auto it : vec_) 
-            delete it;
-        }
-      private:
-        std::vector<JsonBase*> vec_; ///< Saves all the different jsons inside the list
-    };
+/**
+ * @brief Parses a json number of the form -?[0-9]+(.[0-9]*)?([eE][+-]?[0-9]+)?
+ * and never reads past end. Integers are accumulated directly, doubles with
+ * at most 19 significant digits and a decimal exponent within +-22 are
+ * computed exactly with one multiplication or division. All other doubles
+ * are converted by std::from_chars or by strtod on a terminated copy.
+ *
+ * @param begin The first character of the number.
+ * @param end One past the last character that may be read.
+ * @param number Filled with the parsed number.
+ *
+ * @return One past the last character of the number or begin if there is no
+ * number.
+ */
+inline const char *json_parse_number(const char *begin, const char *end, JsonNumber &number) {
+  static const double powers_of_ten[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+    1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+  const char *it = begin;
+  bool negative = it != end && *it == '-';
+  if (negative)
+    ++it;
+
+  const char *digits = it;
+  std::uint64_t mantissa = 0;
+  int significant = 0;   // Digits accumulated into the mantissa
+  int exponent = 0;      // The decimal exponent of the mantissa
+  for (; it != end && *it >= '0' && *it <= '9'; ++it) {
+    if (significant < 19) {
+      mantissa = mantissa*10 + (*it-'0');
+      if (mantissa)
+        ++significant;
+    }
+    else
+      ++exponent;
+  }
+  if (it == digits)
+    return begin;
+
+  bool is_float = exponent != 0;
+  if (it != end && *it == '.') {
+    is_float = true;
+    for (++it; it != end && *it >= '0' && *it <= '9'; ++it) {
+      if (significant < 19) {
+        mantissa = mantissa*10 + (*it-'0');
+        --exponent;
+        if (mantissa)
+          ++significant;
+      }
+    }
+  }
 
-    /**
-     * @brief Represents a simple json integer.
-     */
-  class JsonImplInteger : public JsonInterface  {
-      public:
-        /**
-         * @brief Initialises the JsonInteger with the given value
-         *
-         * @param value The value to set the json integer to.
-         */
-        JsonImplInteger(long long value) : value_(value) {
-        }
+  if (it != end && (*it == 'e' || *it == 'E')) {
+    const char *exp_it = it+1;
+    bool exp_negative = false;
+    if (exp_it != end && (*exp_it == '+' || *exp_it == '-'))
+      exp_negative = *exp_it++ == '-';
+    if (exp_it != end && *exp_it >= '0' && *exp_it <= '9') {
+      int exp_value = 0;
+      for (; exp_it != end && *exp_it >= '0' && *exp_it <= '9'; ++exp_it) {
+        if (exp_value < 100000)
+          exp_value = exp_value*10 + (*exp_it-'0');
+      }
+      exponent += exp_negative ? -exp_value : exp_value;
+      is_float = true;
+      it = exp_it;
+    }
+  }
 
-        /**
-         * @brief Return the type of integer back to the callee.
-         *
-         * @return Always return JsonType::integer
-         */
-        JsonType type() override {
-          return JsonType::integer;
-        }
+  if (!is_float) {
+    // Fits into a long long, -2^63 needs the special case as 2^63 does not
+    if (mantissa <= (std::uint64_t)9223372036854775807LL) {
+      number.is_float = false;
+      number.integer = negative ? -(long long)mantissa : (long long)mantissa;
+      return it;
+    }
+    if (negative && mantissa == (std::uint64_t)9223372036854775808ULL) {
+      number.is_float = false;
+      number.integer = (-9223372036854775807LL)-1;
+      return it;
+    }
+  }
 
-        /**
-         * @brief As this is an primitive type always return 1.
-         *
-         * @return Always returns 1
-         */
-        int size() override {
-          return 1;
-        }
+  number.is_float = true;
+  // Exact conversion, the mantissa and the power of ten are both exactly
+  // representable so the result is correctly rounded.
+  if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+    double value = (double)mantissa;
+    value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+    number.floating = negative ? -value : value;
+    return it;
+  }
+  if (mantissa == 0) {
+    number.floating = negative ? -0.0 : 0.0;
+    return it;
+  }
 
-        /**
-         * @brief Converts the integer to a string.
-         *
-         * @return Returns the integer as an string.
-         */
-        std::string dump() override {
-          return std::to_string(value_);
-        }
+#if defined(__cpp_lib_to_chars)
+  // from_chars does not accept a trailing '.' therefore fall back to strtod
+  // in that case.
+  double value;
+  auto res = std::from_chars(begin,it,value);
+  if (res.ec == std::errc() && res.ptr == it) {
+    number.floating = value;
+    return it;
+  }
+#endif
+  // strtod needs a terminated string and the decimal point of the locale.
+  char buffer[128];
+  std::string long_buffer;
+  char *copy = buffer;
+  std::size_t length = it - begin;
+  if (length >= sizeof(buffer)) {
+    long_buffer.resize(length+1);
+    copy = &long_buffer[0];
+  }
+  std::memcpy(copy,begin,length);
+  copy[length] = '\0';
+  char *point = static_cast<char*>(std::memchr(copy,'.',length));
+  if (point)
+    *point = *std::localeconv()->decimal_point;
+  number.floating = std::strtod(copy,nullptr);
+  return it;
+}
 
-        /**
-         * @brief Returns the saved integer back to the callee, never sets the
-         * error field in this function.
-         *
-         * @param err Never sets the error.
-         *
-         * @return Returns the saved integer value.
-         */
-        long long to_int(JsonError &err) override {
-          return value_;
-        }
+/**
+ * @brief Writes the decimal representation of the integer, two digits are
+ * produced per step with a lookup table.
+ *
+ * @param value The integer to format.
+ * @param out Receives the characters, must have room for at least 20.
+ *
+ * @return The number of written characters.
+ */
+inline std::size_t json_format_integer(long long value, char *out) {
+  static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+  char buffer[20];
+  char *it = buffer + sizeof(buffer);
+  std::uint64_t rest = value < 0 ? 0ull - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+  while (rest >= 100) {
+    const char *pair = digit_pairs + (rest % 100)*2;
+    rest /= 100;
+    *--it = pair[1];
+    *--it = pair[0];
+  }
+  if (rest >= 10) {
+    *--it = digit_pairs[rest*2+1];
+    *--it = digit_pairs[rest*2];
+  }
+  else
+    *--it = static_cast<char>('0' + rest);
 
-      private:
-        long long value_; ///< The saved integer value
-    };
+  std::size_t length = 0;
+  if (value < 0)
+    out[length++] = '-';
+  std::size_t digits = buffer + sizeof(buffer) - it;
+  std::memcpy(out+length,it,digits);
+  return length + digits;
+}
 
-  /**
-   * @brief The basic implementation of a json boolean.
-   */
-    class JsonImplBoolean : public JsonInterface  {
-      public:
-        /**
-         * @brief Initialises the json boolean to the given value
-         *
-         * @param value The value to set the underlying boolean to.
-         */
-        JsonImplBoolean(bool value) : value_(value) {
-        }
+/**
+ * @brief Returns the number of characters json_format_integer(...) writes.
+ *
+ * @param value The integer to measure.
+ *
+ * @return The number of digits plus one for the sign of negative values.
+ */
+inline std::size_t json_integer_length(long long value) {
+  std::size_t length = value < 0 ? 2 : 1;
+  std::uint64_t rest = value < 0 ? 0ull - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+  while (rest >= 10) {
+    rest /= 10;
+    ++length;
+  }
+  return length;
+}
 
-        /**
-         * @brief Returns the type of the Json Boolean.
-         *
-         * @return Always returns JsonType::boolean.
-         */
-        JsonType type() override {
-          return JsonType::boolean;
-        }
+/**
+ * @brief Writes the shortest representation of the double which parses back
+ * to the same value. Integral values below 2^53 are written as integer with
+ * ".0" appended, everything else uses std::to_chars if the standard library
+ * provides it and the shortest of %.15g, %.16g and %.17g that round trips
+ * otherwise. NaN and infinity have no json representation and become null.
+ *
+ * @param value The double to format.
+ * @param out Receives the characters, must have room for at least 32.
+ *
+ * @return The number of written characters.
+ */
+inline std::size_t json_format_double(double value, char *out) {
+  if (value != value || value - value != 0.0) {
+    std::memcpy(out,"null",4);
+    return 4;
+  }
 
-        /**
-         * @brief As this is an primitive type always return 1.
-         *
-         * @return Always returns 1.
-         */
-        int size() override {
-          return 1;
-        }
+  // Most metrics are whole numbers, those are written without any search.
+  if (value > -9007199254740992.0 && value < 9007199254740992.0 && value == (double)(long long)value) {
+    std::size_t length = 0;
+    if (value == 0.0 && std::signbit(value))
+      out[length++] = '-';
+    length += json_format_integer((long long)value,out+length);
+    out[length++] = '.';
+    out[length++] = '0';
+    return length;
+  }
 
-        /**
-         * @brief Converts the underlying boolean to a string
-         *
-         * @return Returns "true" or "false" depending on the underlying value
-         */
-        std::string dump() override {
-          if(value_)
-            return "true";
-          return "false";
-        }
-        
-        /**
-         * @brief Returns the saved boolean value and never sets the error
-         * field.
-         *
-         * @param err Never sets the error field in this method.
-         *
-         * @return Returns the underlying boolean value
-         */
-        bool to_bool(JsonError &err) override {
-          return value_;
-        }
-      private:
-        bool value_;  ///< Returns the saved bool.
-    };
+  std::size_t length = 0;
+#if defined(__cpp_lib_to_chars)
+  auto res = std::to_chars(out,out+32,value);
+  length = res.ptr - out;
+#else
+  const char decimal_point = *std::localeconv()->decimal_point;
+  for (int precision = 15; precision <= 17; precision++) {
+    length = static_cast<std::size_t>(snprintf(out,32,"%.*g",precision,value));
+    if (decimal_point != '.') {
+      char *point = static_cast<char*>(std::memchr(out,decimal_point,length));
+      if (point)
+        *point = '.';
+    }
+    JsonNumber number;
+    json_parse_number(out,out+length,number);
+    if (number.is_float ? number.floating == value : (double)number.integer == value)
+      break;
+  }
+#endif
+  // Keep the value a floating point number when it is parsed again.
+  for (std::size_t i = 0; i < length; i++) {
+    if (out[i] == '.' || out[i] == 'e' || out[i] == 'E')
+      return length;
+  }
+  out[length++] = '.';
+  out[length++] = '0';
+  return length;
+}
 
+/**
+ * @brief Builds the index of all structural positions of a json in blocks of
+ * 64 bytes. Indexed are the characters {}[]:, outside of strings, the opening
+ * quote of every string and the first character of every other value. The
+ * characters are classified with SSE2 or AVX2 on x86-64, chosen at runtime,
+ * with NEON on aarch64 and with a lookup table everywhere else. Defining
+ * GC_JSON_NO_SIMD forces the lookup table.
+ */
+class JsonStructuralIndex {
+  public:
+    static constexpr std::size_t max_size = 0xffffffffu;  ///< The largest json whose positions fit into 32 bits
 
     /**
-     * @brief Create the default JsonBase, the default json is always an json
-     * object
+     * @brief Classifies the json and replaces the stored positions with the
+     * structural positions of the given json.
+     *
+     * @param json The json to index.
+     *
+     * @return False if the json is larger than max_size, then nothing is
+     * indexed and the parsers scan the json instead.
      */
-    JsonBase() : interface_(new JsonImplObject), last_error_(JsonError::ok) {
+    bool build(std::string_view json) {
+      positions_.clear();
+      built_ = json.size() <= max_size;
+      if (!built_)
+        return false;
+      positions_.reserve(json.size()/4);
+      kernel()(json,positions_);
+      return true;
     }
 
     /**
-     * @brief Delete the copy constructor to prevent sharing of ownership which
-     * causes segmentation fault.
-     *
-     * @param base /
+     * @brief Returns true if the positions of the last built json are
+     * complete.
      */
-    JsonBase(JsonBase &base) = delete;
-    
+    bool built() const {
+      return built_;
+    }
+
     /**
-     * @brief Delete the standard copy assignment operator to prevent sharing of
-     * ownership which sometimes causes segmentation fault.
-     *
-     * @param x /
-     *
-     * @return /
+     * @brief Returns the sorted structural positions.
      */
-    JsonBase &operator=(JsonBase &x) = delete;
+    const std::vector<std::uint32_t> &positions() const {
+      return positions_;
+    }
 
     /**
-     * @brief Implement the move constructor, no ownership problems as the
-     * interface is moved away from the other base. The remaining JsonBase is
-     * dangerous as the interface points to a nullptr any operation on it will
-     * crash the programm.
-     *
-     * @param base The other Json to move the interface from.
+     * @brief Returns the name of the instruction set used to classify the
+     * characters on this machine.
      */
-    JsonBase(JsonBase &&base) {
-      interface_ = base.interface_;
-      last_error_ = base.last_error_;
-      base.interface_ = nullptr;
-      base.last_error_ = JsonError::ok;
+    static const char *instruction_set() {
+      Kernel k = kernel();
+#if defined(GC_JSON_AVX2_DISPATCH)
+      if (k == &build_avx2)
+        return "avx2";
+#endif
+#if defined(GC_JSON_X86)
+      if (k == &build_sse2)
+        return "sse2";
+#endif
+#if defined(GC_JSON_NEON)
+      if (k == &build_neon)
+        return "neon";
+#endif
+      return "scalar";
     }
 
     /**
-     * @brief Create the JsonBase with the given interface, one can provide any
-     * class that is derive from JsonInterface. The basic types to provide this
-     * function with are JsonImplObject, JsonImplBoolean, JsonImplInteger,
-     * JsonImplArray
-     *
-     * @param inter The interface to provide to the json base
+     * @brief The bit masks of one block of 64 characters, bit i describes
+     * character i of the block.
      */
-    JsonBase(JsonInterface *inter) : interface_(inter), last_error_(JsonError::ok) {
-    }
+    struct BlockMasks {
+      std::uint64_t quote;       ///< The character is a '"'
+      std::uint64_t backslash;   ///< The character is a '\\'
+      std::uint64_t op;          ///< The character is one of {}[]:,
+      std::uint64_t whitespace;  ///< The character is a space, tab, newline or carriage return
+    };
 
     /**
-     * @brief Creates the Json from a given string. This does not PARSE the
-     * string but creates a json object of type string. 
-     *
-     * For example:
-     * ```
-     * {"hallo": "This is a Json object of type string"}
-     *           ______________________________________
-     * ```
-     *
-     * @param x The string to create the json from.
+     * @brief The state carried from one block to the next.
      */
-    JsonBase(std::string &&x) : interface_(new JsonImplString(x)), last_error_(JsonError::ok) {
-    }
+    struct ScanState {
+      std::uint64_t escaped = 0;    ///< 1 if the first character of the next block is escaped
+      std::uint64_t in_string = 0;  ///< All ones if the next block starts inside of a string
+      std::uint64_t scalar = 0;     ///< 1 if the last block ended inside of a scalar value
+    };
 
     /**
-     * @brief Creates a new Json object of type integer, this just describes an
-     * integer inside of a json.
-     * For example:
-     * ```
-     * {"attribute_key": 10240}
-     *                   _____  This is an json object of type integer
-     * ```
-     *
-     * @param x Integer to initialise the json with
+     * @brief Converts the masks of one block starting at base into the
+     * structural positions and appends them to out.
      */
-    JsonBase(long long x) : interface_(new JsonImplInteger(x)), last_error_(JsonError::ok) {
-    }
+    static void process_block(BlockMasks m, ScanState &state, std::uint32_t base, std::vector<std::uint32_t> &out) {
+      // Escaped characters: backslash i escapes character i+1, backslashes
+      // are rare therefore this is resolved bit by bit.
+      std::uint64_t escaped = state.escaped;
+      std::uint64_t bs = m.backslash & ~state.escaped;
+      state.escaped = 0;
+      while (bs) {
+        int i = json_trailing_zeros(bs);
+        if (i == 63) {
+          state.escaped = 1;
+          break;
+        }
+        escaped |= 1ULL << (i+1);
+        bs &= ~(3ULL << i);
+      }
 
-    JsonBase(double x) : interface_(new JsonImplDouble(x)), last_error_(JsonError::ok) {
+      // Every unescaped quote toggles between inside and outside a string,
+      // the prefix xor marks the opening quote and the string content.
+      std::uint64_t quotes = m.quote & ~escaped;
+      std::uint64_t in_string = quotes;
+      in_string ^= in_string << 1;
+      in_string ^= in_string << 2;
+      in_string ^= in_string << 4;
+      in_string ^= in_string << 8;
+      in_string ^= in_string << 16;
+      in_string ^= in_string << 32;
+      in_string ^= state.in_string;
+      state.in_string = (std::uint64_t)((std::int64_t)in_string >> 63);
+
+      std::uint64_t scalars = ~(m.op | m.whitespace | quotes | in_string);
+      std::uint64_t scalar_starts = scalars & ~((scalars << 1) | state.scalar);
+      state.scalar = scalars >> 63;
+
+      std::uint64_t structurals = (m.op & ~in_string) | (quotes & in_string) | scalar_starts;
+      while (structurals) {
+        out.push_back(base + json_trailing_zeros(structurals));
+        structurals &= structurals - 1;
+      }
     }
 
+  private:
+    using Kernel = void (*)(std::string_view, std::vector<std::uint32_t>&);
+
     /**
-     * @brief Creates a new Json object of type boolean.
-     * For example:
-     * ```
-     * {"attribute_key": true}
-     *                   ____   This is an json object of type boolean
-     * ```
-     *
-     * @param b The boolean to set the json object to.
+     * @brief Runs the classifier over all blocks of the json, the last
+     * partial block is padded with spaces.
      */
-    JsonBase(bool b) : interface_(new JsonImplBoolean(b)), last_error_(JsonError::ok) {
+    template<typename Classifier>
+    static void build_blocks(std::string_view json, std::vector<std::uint32_t> &out, Classifier classify) {
+      ScanState state;
+      std::size_t pos = 0;
+      for (; pos + 64 <= json.size(); pos += 64)
+        process_block(classify(json.data()+pos),state,(std::uint32_t)pos,out);
+      if (pos < json.size()) {
+        char block[64];
+        std::fill(block,block+64,' ');
+        json.copy(block,json.size()-pos,pos);
+        process_block(classify(block),state,(std::uint32_t)pos,out);
+      }
     }
-    
+
     /**
-     * @brief Destroys the current interface by setting the current interface
-     * to nullptr. The function set_interface(...) cleans up dangling pointers.
+     * @brief Classifies 64 characters with a lookup table.
      */
-    ~JsonBase() {
-      set_interface(nullptr);
+    static BlockMasks classify_scalar(const char *block) {
+      static const struct Table {
+        unsigned char cls[256];
+        Table() : cls() {
+          cls[(unsigned char)'"'] = 1;
+          cls[(unsigned char)'\\'] = 2;
+          for (unsigned char c : {'{','}','[',']',':',','})
+            cls[c] = 4;
+          for (unsigned char c : {' ','\t','\n','\r'})
+            cls[c] = 8;
+        }
+      } table;
+
+      BlockMasks m = {0,0,0,0};
+      for (int i = 0; i < 64; i++) {
+        std::uint64_t cls = table.cls[(unsigned char)block[i]];
+        m.quote |= (cls & 1) << i;
+        m.backslash |= ((cls >> 1) & 1) << i;
+        m.op |= ((cls >> 2) & 1) << i;
+        m.whitespace |= ((cls >> 3) & 1) << i;
+      }
+      return m;
+    }
+
+    static void build_scalar(std::string_view json, std::vector<std::uint32_t> &out) {
+      build_blocks(json,out,&classify_scalar);
     }
 
+#if defined(GC_JSON_X86)
     /**
-     * @brief Sets the Json move assignment operator. This is implemented as the
-     * move operator avoids ownership conflicts.
-     *
-     * @param x The Json to move the interface and the error from.
-     *
-     * @return Returns a reference to itself to enable chain moving.
+     * @brief Classifies 64 characters with SSE2, available on every x86-64.
      */
-    JsonBase &operator=(JsonBase &&x) {
-      // Sets the new interface and destroys the references to the shared
-      // memory.
-      set_interface(x.interface_);
-      last_error_ = x.last_error_;
-      x.interface_ = nullptr;
-      return *this;
+    static BlockMasks classify_sse2(const char *block) {
+      BlockMasks m = {0,0,0,0};
+      for (int i = 0; i < 4; i++) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block+16*i));
+        auto eq = [&in](char c) { return _mm_cmpeq_epi8(in,_mm_set1_epi8(c)); };
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_or_si128(eq('{'),eq('}')),_mm_or_si128(eq('['),eq(']'))),_mm_or_si128(eq(':'),eq(',')));
+        __m128i ws = _mm_or_si128(_mm_or_si128(eq(' '),eq('\t')),_mm_or_si128(eq('\n'),eq('\r')));
+        m.quote |= (std::uint64_t)(unsigned)_mm_movemask_epi8(eq('"')) << (16*i);
+        m.backslash |= (std::uint64_t)(unsigned)_mm_movemask_epi8(eq('\\')) << (16*i);
+        m.op |= (std::uint64_t)(unsigned)_mm_movemask_epi8(op) << (16*i);
+        m.whitespace |= (std::uint64_t)(unsigned)_mm_movemask_epi8(ws) << (16*i);
+      }
+      return m;
     }
-    
+
+    static void build_sse2(std::string_view json, std::vector<std::uint32_t> &out) {
+      build_blocks(json,out,&classify_sse2);
+    }
+#endif
+
+#if defined(GC_JSON_AVX2_DISPATCH)
     /**
-     * @brief Sets a new interface and cleans up dangling pointers.
-     *
-     * @param interface The new interface to set the pointer to.
+     * @brief Classifies 64 characters with AVX2.
      */
-    void set_interface(JsonInterface *interface) {
-      if (interface_) {
-        delete interface_;
+    __attribute__((target("avx2"))) static BlockMasks classify_avx2(const char *block) {
+      BlockMasks m = {0,0,0,0};
+      for (int i = 0; i < 2; i++) {
+        __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block+32*i));
+        // The intrinsics can not be wrapped into a lambda as the lambda would
+        // not be compiled for avx2.
+#define GC_JSON_EQ(c) _mm256_cmpeq_epi8(in,_mm256_set1_epi8(c))
+        __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(GC_JSON_EQ('{'),GC_JSON_EQ('}')),_mm256_or_si256(GC_JSON_EQ('['),GC_JSON_EQ(']'))),_mm256_or_si256(GC_JSON_EQ(':'),GC_JSON_EQ(',')));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(GC_JSON_EQ(' '),GC_JSON_EQ('\t')),_mm256_or_si256(GC_JSON_EQ('\n'),GC_JSON_EQ('\r')));
+        m.quote |= (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(GC_JSON_EQ('"')) << (32*i);
+        m.backslash |= (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(GC_JSON_EQ('\\')) << (32*i);
+#undef GC_JSON_EQ
+        m.op |= (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(op) << (32*i);
+        m.whitespace |= (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(ws) << (32*i);
       }
-      interface_ = interface;
+      return m;
+    }
+
+    __attribute__((target("avx2"))) static void build_avx2(std::string_view json, std::vector<std::uint32_t> &out) {
+      build_blocks(json,out,&classify_avx2);
     }
+#endif
 
+#if defined(GC_JSON_NEON)
     /**
-     * @brief Returns the underlying type of the current interface.
-     *
-     * @return The type of the current interface.
+     * @brief Classifies 64 characters with NEON.
      */
-    JsonType type() {
-      return interface_->type();
+    static BlockMasks classify_neon(const char *block) {
+      uint8x16_t in[4];
+      for (int i = 0; i < 4; i++)
+        in[i] = vld1q_u8(reinterpret_cast<const std::uint8_t*>(block+16*i));
+
+      // Packs the comparison results of all 4 vectors into one 64 bit mask.
+      auto to_mask = [](uint8x16_t c0, uint8x16_t c1, uint8x16_t c2, uint8x16_t c3) {
+        const uint8x16_t bits = {0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80,0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80};
+        uint8x16_t sum0 = vpaddq_u8(vandq_u8(c0,bits),vandq_u8(c1,bits));
+        uint8x16_t sum1 = vpaddq_u8(vandq_u8(c2,bits),vandq_u8(c3,bits));
+        sum0 = vpaddq_u8(sum0,sum1);
+        sum0 = vpaddq_u8(sum0,sum0);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum0),0);
+      };
+      auto eq = [&in](int i, char c) { return vceqq_u8(in[i],vdupq_n_u8((std::uint8_t)c)); };
+      auto op = [&eq](int i) { return vorrq_u8(vorrq_u8(vorrq_u8(eq(i,'{'),eq(i,'}')),vorrq_u8(eq(i,'['),eq(i,']'))),vorrq_u8(eq(i,':'),eq(i,','))); };
+      auto ws = [&eq](int i) { return vorrq_u8(vorrq_u8(eq(i,' '),eq(i,'\t')),vorrq_u8(eq(i,'\n'),eq(i,'\r'))); };
+
+      BlockMasks m;
+      m.quote = to_mask(eq(0,'"'),eq(1,'"'),eq(2,'"'),eq(3,'"'));
+      m.backslash = to_mask(eq(0,'\\'),eq(1,'\\'),eq(2,'\\'),eq(3,'\\'));
+      m.op = to_mask(op(0),op(1),op(2),op(3));
+      m.whitespace = to_mask(ws(0),ws(1),ws(2),ws(3));
+      return m;
+    }
+
+    static void build_neon(std::string_view json, std::vector<std::uint32_t> &out) {
+      build_blocks(json,out,&classify_neon);
     }
+#endif
 
     /**
-     * @brief Returns the error if there is one.
-     *
-     * @return The current eror there is.
+     * @brief Selects the fastest supported kernel once.
      */
-    JsonError error() {
-      return last_error_;
+    static Kernel kernel() {
+      static const Kernel selected = []() -> Kernel {
+#if defined(GC_JSON_AVX2_DISPATCH)
+        if (__builtin_cpu_supports("avx2"))
+          return &build_avx2;
+#endif
+#if defined(GC_JSON_X86)
+        return &build_sse2;
+#elif defined(GC_JSON_NEON)
+        return &build_neon;
+#else
+        return &build_scalar;
+#endif
+      }();
+      return selected;
+    }
+
+    std::vector<std::uint32_t> positions_;  ///< The sorted structural positions
+    bool built_ = false;                    ///< False if the last json was too large to be indexed
+};
+
+/**
+ * @brief The output of the json serializer. Writes go into a buffer without
+ * any virtual call, only when the buffer is full the implementation either
+ * grows it or passes the content on.
+ */
+class JsonSink {
+  public:
+    virtual ~JsonSink() {
     }
 
     /**
-     * @brief Returns the size of the underlying interface.
+     * @brief Appends length characters to the output.
      *
-     * @return Returns the size of the current interface, for json objects, the
-     * number of key:value pairs, for json arrays the number of items in the
-     * array.
+     * @param data The characters to append.
+     * @param length The number of characters to append.
      */
-    int size() {
-      return interface_->size();
+    void append(const char *data, std::size_t length) {
+      while (length > capacity_ - size_) {
+        std::size_t part = capacity_ - size_;
+        std::memcpy(buffer_+size_,data,part);
+        size_ += part;
+        data += part;
+        length -= part;
+        overflow(length);
+      }
+      std::memcpy(buffer_+size_,data,length);
+      size_ += length;
     }
 
     /**
-     * @brief Convertes the json type to a string format. 
-     *
-     * @return Returns the json type as string. For example JsonType::object to
-     * "JsonType::object".
+     * @brief Appends the string to the output.
      */
-    std::string type_as_string() {
-      // Do a direct mapping of type name to string
-      switch(interface_->type()) {
-        case JsonType::object:      return "JsonType::object";
-        case JsonType::array:       return "JsonType::array";
-        case JsonType::integer:     return "JsonType::integer";
-        case JsonType::string:      return "JsonType::string";
-        case JsonType::boolean:     return "JsonType::boolean";
-        default:                    return "JsonType::unknown";
-      }
-      // This should never happen, but some compilers complain without it.
-      return "";
+    void append(std::string_view str) {
+      append(str.data(),str.size());
     }
 
     /**
-     * @brief Creates a dump of the given Json
-     *
-     * @return Returns a string of the underlying json interface.
+     * @brief Appends a single character to the output.
      */
-    std::string dump() {
-      return std::move(interface_->dump());
+    void put(char c) {
+      if (size_ == capacity_)
+        overflow(1);
+      buffer_[size_++] = c;
     }
 
     /**
-     * @brief Executes the given function if the type is JsonType::string
-     *
-     * @param func Call the function with the string inside if the object is of
-     * type string
-     *
-     * @return Returns a reference to itself for function chaining
+     * @brief Returns a pointer to at least length free characters, the
+     * written characters must be committed with commit(...). Length must not
+     * be larger than 64.
      */
-    JsonBase& map_string(std::function<void(std::string&)> func) {
-      std::string tmp = std::move(interface_->to_string(last_error_));
-      if (last_error_ == JsonError::ok)
-        func(tmp);
-      return *this;
+    char *reserve(std::size_t length) {
+      if (length > capacity_ - size_)
+        overflow(length);
+      return buffer_+size_;
     }
 
     /**
-     * @brief Executes the given function if the type is JsonType::int
-     *
-     * @param func The function to execute when the type is int
-     *
-     * @return Returns a reference to itself for function chaining
+     * @brief Commits length characters written after calling reserve(...).
      */
-    JsonBase& map_int(std::function<void(int)> func) {
-      int tmp = interface_->to_int(last_error_);
-      if (last_error_ == JsonError::ok)
-        func(tmp);
-      return *this;
+    void commit(std::size_t length) {
+      size_ += length;
     }
 
     /**
-     * @brief Executes the given function if the type is JsonType::bool
-     *
-     * @param func The function to execute when the type fits
-     *
-     * @return Returns a reference to the instance for function chaining
+     * @brief Passes all buffered characters on to the destination.
      */
-    JsonBase& map_bool(std::function<void(bool)> func) {
-      bool tmp = interface_->to_bool(last_error_);
-      if (last_error_ == JsonError::ok)
-        func(tmp);
-      return *this;
+    virtual void flush() {
     }
 
+  protected:
     /**
-     * @brief Calls the given function for every object in the array if the
-     * instance is an object
-     *
-     * @param func The function to execute on every member of the array
+     * @brief Called when the buffer cannot take needed more characters, must
+     * make room for at least min(needed, 64) characters.
      *
-     * @return Returns a reference to the instance for function chaining
+     * @param needed The number of characters which are about to be written.
      */
-    JsonBase &map_array(std::function<void(JsonBase&)> func) {
-      for (int i = 0; i < interface_->size(); i++) {
-        JsonBase *val = interface_->get(i,last_error_);
-        if(last_error_ == JsonError::ok) {
-          func(*val);
-        }
-        else
-          break;
-      }
-      return *this;
-    }
+    virtual void overflow(std::size_t needed) = 0;
+
+    char *buffer_ = nullptr;    ///< The buffer to write the characters to
+    std::size_t size_ = 0;      ///< The number of used characters in the buffer
+    std::size_t capacity_ = 0;  ///< The size of the buffer
+};
 
 /**
- * @brief Calls the given function on every pair (key,value) in the json object
- *
- * @param func The function to execute on a value pair.
- *
- * @return Returns a reference to itself for easier function chaining
+ * @brief A sink appending to a string, writes directly into the memory of
+ * the string and grows it geometrically. The string has its final size
+ * after flush() or the destruction of the sink.
  */
-JsonBase &map_object(std::function<void(const std::string&,JsonBase)> func) {
-    if (interface_->type() == JsonType::object && last_error_ == JsonError::ok) {
-    auto obj = (JsonImplObject*)interface_;
-    obj->map_for_each(func);
+class JsonStringSink : public JsonSink {
+  public:
+    /**
+     * @brief Appends to the given string, the reserved capacity of the string
+     * is used as initial buffer.
+     *
+     * @param target The string to append the output to.
+     */
+    JsonStringSink(std::string &target) : target_(target), offset_(target.size()) {
+      target_.resize(std::max(target_.capacity(),offset_+64));
+      buffer_ = &target_[offset_];
+      capacity_ = target_.size()-offset_;
     }
-    else
-    last_error_ = JsonError::not_implemented;
-    return *this;
+
+    ~JsonStringSink() {
+      flush();
     }
 
     /**
-     * @brief Call the given function if no error occured while accessing the
-     * array
-     *
-     * @param func The function to execute.
-     *
-     * @return Returns a reference to itself for easier function chaining
+     * @brief Shrinks the string to the written characters.
      */
-    JsonBase &map(std::function<void(void)> func) {
-    if(!has_error())
-    func();
+    void flush() override {
+      target_.resize(offset_+size_);
+      buffer_ = &target_[0] + offset_;
+      capacity_ = size_;
+    }
+
+  protected:
+    void overflow(std::size_t needed) override {
+      target_.resize(std::max(2*(offset_+capacity_),offset_+size_+needed));
+      buffer_ = &target_[offset_];
+      capacity_ = target_.size()-offset_;
     }
 
+  private:
+    std::string &target_;  ///< The string to write into
+    std::size_t offset_;   ///< The size of the string before the sink was created
+};
 
+/**
+ * @brief A sink writing to a std::ostream through a fixed buffer.
+ */
+class JsonOstreamSink : public JsonSink {
+  public:
     /**
-      * @brief Returns the JsonObject at the given index. This function only
-      * works if the underlying type is JsonType::array.
-      *
-      * @param index The index to return the object from.
-      *
-      * @return Returns on success the given json object or an instance of this
-      * class with an error code set.
-    */
-    JsonBase &get(int index) {
-      auto ret = interface_->get(index,last_error_);
-      if (last_error_!=JsonError::ok)
-        return *this;
-      return *ret;
+     * @brief Writes all output to the given stream.
+     *
+     * @param stream The stream to write to.
+     */
+    JsonOstreamSink(std::ostream &stream) : stream_(stream) {
+      buffer_ = storage_;
+      capacity_ = sizeof(storage_);
     }
 
-    /**
-      * @brief Returns the json object associated with the given key, if the
-      * object does not exist or the key does not exist returns this instance
-      * and sets an error code.
-      *
-      * @param x The key to search for in the json object.
-      *
-      * @return Either the found JsonBase or this instance depending on the
-      * operation outcome.
-      */
-    JsonBase &get(const std::string &&x) {
-      return get(x);
+    ~JsonOstreamSink() {
+      flush();
     }
 
     /**
-      * @brief Returns the json object associated with the given key, if the
-      * object does not exist or the key does not exist returns this instance
-      * and sets an error code.
-      *
-      * @param x The key to search for in the json object.
-      *
-      * @return Either the found JsonBase or this instance depending on the
-      * operation outcome.
-      */
-    JsonBase &get(const std::string &x) {
-      auto ret = interface_->get(x,last_error_);
-      if (last_error_==JsonError::ok)
-        return *ret;
-      return *this;
+     * @brief Writes the buffered characters to the stream.
+     */
+    void flush() override {
+      stream_.write(buffer_,size_);
+      size_ = 0;
     }
 
-/**
- * @brief Tries to insert a new (key,value) pair into an json object
- *
- * @tparam T The type of the inserted value
- * @param x The key to insert into the json object.
- * @param t The value to insert into the Json object.
- *
- * @return Returns an instance to itself. Sets an error code in the class if the
- * object is not of type JsonType::object.
- */
-    template<typename T>
-    JsonBase &set(const std::string &&x, T t) {
-      interface_->insert(x,new JsonBase(t),last_error_);
-      return *this;
+  protected:
+    void overflow(std::size_t) override {
+      flush();
     }
 
+  private:
+    std::ostream &stream_;  ///< The stream to write to
+    char storage_[4096];    ///< The buffer of the sink
+};
 
 /**
- * @brief Tries to insert a new (key,const char *) pair. This overload is
- * provided to distinguish between bool and const char* as casting to bool is
- * nearer than casting to const char*
- *
- * @param x The key of the inserted pair
- * @param str The value of the inserted pair, will get inserted as
- * JsonType::string.
- *
- * @return Returns this instance for easier function chaining.
+ * @brief A sink collecting the output in chunks of a fixed size and passing
+ * every full chunk to a callback. The last partial chunk is passed on by
+ * flush() or the destruction of the sink.
  */
-    JsonBase &set(const std::string &&x, const char *str) {
-      interface_->insert(x,new JsonBase(std::string(str)),last_error_);
-      return *this;
+class JsonChunkedSink : public JsonSink {
+  public:
+    /**
+     * @brief Creates the sink with the given chunk size.
+     *
+     * @param chunk_size The size of all chunks except the last one, at least
+     * 64 characters.
+     * @param callback Called with every finished chunk.
+     */
+    JsonChunkedSink(std::size_t chunk_size, std::function<void(std::string_view)> callback) : storage_(std::max<std::size_t>(chunk_size,64)), callback_(std::move(callback)) {
+      buffer_ = storage_.data();
+      capacity_ = storage_.size();
     }
 
+    ~JsonChunkedSink() {
+      flush();
+    }
 
-/**
- * @brief Tries to insert a new (key,JsonBase*) pair into a json object. The
- * function sets an error code when the object is not of type json object.
- *
- * @param x The key to insert into the JsonObject.
- * @param js The Interface to insert into the JsonObject.
- *
- * @return Returns an instance of itself for easier function chaining.
- */
-    JsonBase &set(const std::string &&x, JsonBase *js) {
-      interface_->insert(x,js,last_error_);
-      return *this;
+    /**
+     * @brief Passes the current partial chunk to the callback.
+     */
+    void flush() override {
+      if (size_ > 0)
+        callback_(std::string_view(buffer_,size_));
+      size_ = 0;
     }
 
-/**
- * @brief Tries to insert a new value into the json array. Sets an error code if
- * the JsonBase is not of type JsonType::array
- *
- * @tparam T The type to insert into the json object. Every type is insertable
- * which can be constructed by JsonBase(T);
- * @param t The value to call the constructor with.
- *
- * @return An instance of itself for easier function chaining
- */
-    template<typename T>
-    JsonBase &push_back(T t) {
-      interface_->insert("",new JsonBase(t),last_error_);
-      return *this;
+  protected:
+    void overflow(std::size_t) override {
+      flush();
     }
 
+  private:
+    std::vector<char> storage_;                        ///< The memory of the current chunk
+    std::function<void(std::string_view)> callback_;   ///< Receives the finished chunks
+};
+
 /**
- * @brief Tries to insert a string into the json array. If the JsonBase is not
- * of type JsonType::array then an error code is set.
- *
- * @param str The string to insert into the array.
- *
- * @return Returns an instance to itself for easier function chaining
+ * @brief Writes CBOR (RFC 8949) into a sink. It provides the same calls as an
+ * event handler of JsonBase::parse_events(...), so it converts json text to
+ * CBOR without building a DOM and encodes JsonBase trees through
+ * JsonBase::dump_cbor(...). Containers opened without a size are written
+ * with indefinite length.
  */
-    JsonBase &push_back(const char *str) {
-      interface_->insert("",new JsonBase(std::string(str)),last_error_);
-      return *this;
+class JsonCborWriter {
+  public:
+    static constexpr std::size_t unknown_size = ~std::size_t(0);  ///< Opens an indefinite length container
+
+    /**
+     * @brief Creates the writer, the sink must outlive it.
+     *
+     * @param sink Receives the encoded bytes.
+     */
+    explicit JsonCborWriter(JsonSink &sink) : sink_(sink) {
     }
 
-/**
- * @brief Inserts an interface into the json array. An error code is set if the
- * underlying type is not JsonType::array.
- *
- * @param js The interface to include into the json array.
- *
- * @return Returns an instance to itself for easier function chaining.
- */
-    JsonBase &push_back(JsonBase *js) {
-      interface_->insert("",js,last_error_);
-      return *this;
+    bool null() {
+      sink_.put((char)0xf6);
+      return true;
     }
 
-/**
- * @brief Sets the internal error state to the given error code. If there is
- * already an error code set this function will just silently overwrite it.
- *
- * @param err The error code to set the last_error to.
- */
-    void set_error(JsonError err) {
-      last_error_ = err;
+    bool boolean(bool value) {
+      sink_.put(value ? (char)0xf5 : (char)0xf4);
+      return true;
     }
 
-/**
- * @brief Checks if there was an illegal call or cast using this instance.
- *
- * @return True if there happened an illegal action.
- */
-    bool has_error() {
-      return last_error_ != JsonError::ok;
+    bool integer(long long value) {
+      if (value < 0)
+        head(1,(std::uint64_t)(-(value+1)));
+      else
+        head(0,(std::uint64_t)value);
+      return true;
     }
 
-/**
- * @brief Calls the callback function if there was an illegal operation or an
- * error in this instance.
- *
- * @param func The function to call when there is an error inside.
- */
-    void error(std::function<void(JsonError)> func) {
-      if (last_error_ != JsonError::ok) {
-        func(last_error_);
-        last_error_ = JsonError::ok;
+    /**
+     * @brief Writes the double as single precision float if that is exact.
+     * Only finite doubles within the float range are converted, NaN and the
+     * infinities are exact in single precision.
+     */
+    bool floating(double value) {
+      bool single = true;
+      float small = 0;
+      if (std::isnan(value))
+        small = std::numeric_limits<float>::quiet_NaN();
+      else if (std::isinf(value))
+        small = value > 0 ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+      else if (std::fabs(value) <= FLT_MAX) {
+        small = (float)value;
+        single = (double)small == value;
+      }
+      else
+        single = false;
+      if (single) {
+        std::uint32_t bits;
+        std::memcpy(&bits,&small,4);
+        char *out = sink_.reserve(5);
+        out[0] = (char)0xfa;
+        big_endian(out+1,bits,4);
+        sink_.commit(5);
+      }
+      else {
+        std::uint64_t bits;
+        std::memcpy(&bits,&value,8);
+        char *out = sink_.reserve(9);
+        out[0] = (char)0xfb;
+        big_endian(out+1,bits,8);
+        sink_.commit(9);
       }
+      return true;
     }
 
-/**
- * @brief The JsonParser used to parse large json strings.
- */
-    struct JsonParser {
+    bool string(std::string_view value) {
+      head(3,value.size());
+      sink_.append(value.data(),value.size());
+      return true;
+    }
 
+    bool key(std::string_view key) {
+      return string(key);
+    }
 
-      /**
-       * @brief Possible json parse errors while parsing.
-       */
-      enum class JsonParserError {
-        ok,
-        expected_comma_before_next_attribute,
-        expected_comma_before_next_array_item,
-        expected_attribute_but_got_comma,
-        expected_string_attribute_key,
-        expected_closing_quote_but_got_eos,
-        expected_beginning_of_string_int_object_or_array_null_float,
-        expected_colon_but_got_different_character_instead,
-        expected_int_or_double,
-      };
-      
-      int abs_pos_;   ///< The current absolute position in the underlying_json_ string view.
-      JsonParserError error_;   ///< The current state, everything other than JsonParserError::ok means abort parsing.
-      std::string_view underlying_json_;  ///< The json to parse.
+    bool start_object(std::size_t size=unknown_size) {
+      return open(5,size);
+    }
 
-      
-      /**
-       * @brief Parses the given json starting at startpos
-       *
-       * @param view The string to parse, using a string view to save
-       * ressources.
-       * @param startpos The starting position.
-       */
-      JsonParser(std::string_view view,int startpos=0) {
-        underlying_json_ = view;
-        abs_pos_ = startpos;
-        // No error at the beginning
-        error_ = JsonParserError::ok;
+    bool end_object() {
+      return close();
+    }
+
+    bool start_array(std::size_t size=unknown_size) {
+      return open(4,size);
+    }
+
+    bool end_array() {
+      return close();
+    }
+
+  private:
+    static void big_endian(char *out, std::uint64_t value, int bytes) {
+      for (int i = bytes-1; i >= 0; i--) {
+        out[i] = (char)(value & 0xff);
+        value >>= 8;
       }
+    }
 
-      /**
-       * @brief Checks if there has been a parse error.
-       *
-       * @return True if there has been a parse error false otherwise.
-       */
-      bool parse_error() {
-        return error_ != JsonParserError::ok;
+    /**
+     * @brief Writes the initial byte of an item with the shortest encoding
+     * of the argument.
+     */
+    void head(int major, std::uint64_t argument) {
+      char *out = sink_.reserve(9);
+      char type = (char)(major << 5);
+      if (argument < 24) {
+        out[0] = (char)(type | (char)argument);
+        sink_.commit(1);
+      }
+      else if (argument <= 0xff) {
+        out[0] = (char)(type | 24);
+        big_endian(out+1,argument,1);
+        sink_.commit(2);
+      }
+      else if (argument <= 0xffff) {
+        out[0] = (char)(type | 25);
+        big_endian(out+1,argument,2);
+        sink_.commit(3);
       }
+      else if (argument <= 0xffffffffULL) {
+        out[0] = (char)(type | 26);
+        big_endian(out+1,argument,4);
+        sink_.commit(5);
+      }
+      else {
+        out[0] = (char)(type | 27);
+        big_endian(out+1,argument,8);
+        sink_.commit(9);
+      }
+    }
 
-      /**
-       * @brief Sets the current parse error to the given value.
-       *
-       * @param err Sets the parse error to the given parse error.
-       */
-      void set_error(JsonParserError err) {
-        error_ = err;
+    bool open(int major, std::size_t size) {
+      indefinite_.push_back(size == unknown_size);
+      if (size == unknown_size)
+        sink_.put((char)((major << 5) | 31));
+      else
+        head(major,size);
+      return true;
+    }
+
+    bool close() {
+      if (indefinite_.back())
+        sink_.put((char)0xff);
+      indefinite_.pop_back();
+      return true;
+    }
+
+    JsonSink &sink_;                ///< Receives the encoded bytes
+    std::vector<bool> indefinite_;  ///< For every open container true if it needs a break byte
+};
+
+/**
+ * @brief An attribute key together with its hash, objects use the stored hash
+ * instead of hashing the key again. Two keys returned by the same
+ * JsonKeyInterner are equal exactly if they point to the same characters.
+ */
+struct JsonKey {
+  std::string_view view;  ///< The unescaped key
+  std::size_t hash;       ///< The std::hash of the key
+
+  JsonKey() : hash(0) {
+  }
+
+  /**
+   * @brief Hashes the given key.
+   */
+  explicit JsonKey(std::string_view key) : view(key), hash(std::hash<std::string_view>()(key)) {
+  }
+
+  /**
+   * @brief Takes the key with an already computed hash.
+   */
+  JsonKey(std::string_view key, std::size_t key_hash) : view(key), hash(key_hash) {
+  }
+
+  bool operator==(const JsonKey &other) const {
+    if (hash != other.hash || view.size() != other.view.size())
+      return false;
+    // Interned keys share their characters, only different memory has to be
+    // compared.
+    return view.data() == other.view.data() || view == other.view;
+  }
+};
+
+/**
+ * @brief Returns the hash stored inside the JsonKey.
+ */
+struct JsonKeyHash {
+  std::size_t operator()(const JsonKey &key) const {
+    return key.hash;
+  }
+};
+
+/**
+ * @brief Stores every distinct attribute key once. Objects keep the interned
+ * characters without copying them and compare them by pointer, so repeated
+ * keys of large documents are stored and hashed only once.
+ *
+ * The interner can be shared by many documents, see
+ * JsonParseOptions::key_interner, it must outlive all of them.
+ */
+class JsonKeyInterner {
+  public:
+    /**
+     * @brief Creates an empty interner.
+     *
+     * @param thread_safe Locks every call to intern(...) so documents can be
+     * parsed on several threads with the same interner.
+     * @param arena Stores the keys in the given arena instead of an own one,
+     * the arena must outlive the interner.
+     */
+    explicit JsonKeyInterner(bool thread_safe = false, JsonArena *arena = nullptr) : arena_(arena ? arena : &own_arena_), size_(0), thread_safe_(thread_safe) {
+    }
+
+    JsonKeyInterner(const JsonKeyInterner &) = delete;
+    JsonKeyInterner &operator=(const JsonKeyInterner &) = delete;
+
+    /**
+     * @brief Returns the interned copy of the key, the first call for a key
+     * copies it.
+     *
+     * @param key The unescaped key.
+     *
+     * @return The key referencing the memory of the interner.
+     */
+    JsonKey intern(std::string_view key) {
+      std::size_t hash = std::hash<std::string_view>()(key);
+#if !defined(GC_JSON_NO_THREADS)
+      if (thread_safe_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return insert(key,hash);
       }
+#endif
+      return insert(key,hash);
+    }
 
-      /**
-       * @brief Tries to find the error by taking a substr arround the last
-       * parsed position to show the user the error.
-       *
-       * @param dist The distance in both directions to cut out of the json.
-       *
-       * @return The substr arround the parse error to show the user the error.
-       */
-      std::string get_error_surroundings(int dist) {
-        int start = (abs_pos_-dist<0)?0:abs_pos_-dist;
-        int end = (abs_pos_+dist>=underlying_json_.length())?underlying_json_.length():abs_pos_+dist;
-        return std::string(underlying_json_.substr(start,end-start));
+    /**
+     * @brief Returns the number of distinct keys.
+     */
+    std::size_t size() const {
+      return size_;
+    }
+
+  private:
+    /**
+     * @brief Looks the key up with linear probing and copies it into the
+     * arena if it is new.
+     */
+    JsonKey insert(std::string_view key, std::size_t hash) {
+      if ((size_ + 1) * 2 > slots_.size())
+        rehash(slots_.empty() ? 64 : slots_.size() * 2);
+      std::size_t mask = slots_.size() - 1;
+      std::size_t i = hash & mask;
+      while (slots_[i].view.data()) {
+        if (slots_[i].hash == hash && slots_[i].view == key)
+          return slots_[i];
+        i = (i + 1) & mask;
       }
+      // Allocate at least one byte, empty slots are recognized by nullptr.
+      char *copy = static_cast<char*>(arena_->allocate(key.size() ? key.size() : 1,1));
+      key.copy(copy,key.size());
+      slots_[i] = JsonKey(std::string_view(copy,key.size()),hash);
+      ++size_;
+      return slots_[i];
+    }
 
-      /**
-       * @brief Converts the given parse error into a string
-       *
-       * @return The string version of the error code.
-       */
-      std::string get_error_string() {
-        switch(error_) {
-          case JsonParserError::ok:
-            return "No error.";
-          case JsonParserError::expected_comma_before_next_attribute:
-            return "Expected ',' before the next attribute in Json::object.";
-          case JsonParserError::expected_comma_before_next_array_item:
-            return "Expected ',' before next item in the Json::array";
-          case JsonParserError::expected_attribute_but_got_comma:
-            return "Expected next attribute but got ',' instead.";
-          case JsonParserError::expected_string_attribute_key:
-            return "Expected string attribute key but could not find string or the string was empty.";
-          case JsonParserError::expected_closing_quote_but_got_eos:
-            return "Expected closing quotes but got end of string instead.";
-          case JsonParserError::expected_beginning_of_string_int_object_or_array_null_float:
-            return "Expected beginning of new json type either, string, int, bool, array, null, float or object, but got something else.";
-          case JsonParserError::expected_colon_but_got_different_character_instead:
-            return "Expected colon after Json::object attribute key but got different character instead.";
-          case JsonParserError::expected_int_or_double:
-            return "Expected double or integer but got different character.";
-        }
-        return "Unknown error.";
+    /**
+     * @brief Moves all keys into a table of the given power of two size.
+     */
+    void rehash(std::size_t count) {
+      std::vector<JsonKey> slots(count);
+      for (const JsonKey &key : slots_) {
+        if (!key.view.data())
+          continue;
+        std::size_t i = key.hash & (count - 1);
+        while (slots[i].view.data())
+          i = (i + 1) & (count - 1);
+        slots[i] = key;
       }
+      slots_.swap(slots);
+    }
 
-      /**
-       * @brief Parses an json object therefore exepects a specific type
-       *
-       * @return Returns the created json object
-       */
-      JsonBase *parse_object() {
-        //Skip the first character which we know is {
-        ++abs_pos_;
+    JsonArena own_arena_;          ///< Holds the keys if no arena was given
+    JsonArena *arena_;             ///< The arena holding the keys
+    std::vector<JsonKey> slots_;   ///< The open addressing table, empty slots have no data
+    std::size_t size_;             ///< The number of distinct keys
+    bool thread_safe_;             ///< True if intern(...) locks the mutex
+#if !defined(GC_JSON_NO_THREADS)
+    std::mutex mutex_;             ///< Serializes intern(...) if thread_safe_
+#endif
+};
 
-        std::string key;
-        // We always return a valid object!
-        JsonBase *object = new JsonBase();
+/**
+ * @brief Detects allocation policies with an arena(), keys interned for a
+ * single document are stored in that arena.
+ */
+template<typename Allocator, typename = void>
+struct json_has_arena : std::false_type {
+};
 
-        //No comma expected yet first we need a key.
-        bool expect_comma = false;
+template<typename Allocator>
+struct json_has_arena<Allocator, std::void_t<decltype(std::declval<Allocator&>().arena())>> : std::true_type {
+};
 
-        for (;abs_pos_ < underlying_json_.length(); abs_pos_++) {
-          //Skip all trailing characters as we are not in a string this can be
-          //skipped safely
-          if (underlying_json_[abs_pos_] == ' ' || underlying_json_[abs_pos_] == '\t' || underlying_json_[abs_pos_] == '\n')
-            continue;
-          // Check the finish tag if we find this the object is finished.
-          else if (underlying_json_[abs_pos_] == '}')
-            break;
+/**
+ * @brief Object storage policy keeping the attributes of json objects in an
+ * unordered_map, the iteration order is unspecified.
+ */
+struct JsonHashObjectStorage {
+};
 
-          // Check the comma, if there is one the next (key,value) pair can
-          // start.
-          else if (underlying_json_[abs_pos_] == ',') {
-            // Ok we did not have (key,value) pair before , set error and exit
-            if (!expect_comma) {
-              set_error(JsonParserError::expected_attribute_but_got_comma);
-              break;
-            }
-            //Ok we just got a comma, we dont expect another one yet.
-            expect_comma = false;
-          }
-          // No key yet? Expect JsonString then.
-          else if (key.length() == 0) {
+/**
+ * @brief Object storage policy keeping the attributes of json objects in a
+ * vector in insertion order, dump() and map_object(...) keep that order.
+ */
+struct JsonFlatObjectStorage {
+  static constexpr std::size_t index_threshold = 8;  ///< Objects with more attributes get a hash index instead of a linear search
+};
 
-            // If we expect a comma now there is a missing comma between
-            // (key,value) and (key1,value1)
-            if (expect_comma) {
-              set_error(JsonParserError::expected_comma_before_next_attribute);
-              break;
-            }
+/**
+ * @brief Object storage policy sharing the keys of objects with the same key
+ * sequence. Objects store their keys like JsonFlatObjectStorage until the
+ * parser finds two consecutive objects of an array with the same keys in the
+ * same order. These and the following objects with these keys only store
+ * their values and a JsonShape, which maps the keys to the positions of the
+ * values. Objects keep their insertion order, a shared object which gets a
+ * new key and objects with more than max_shape_keys attributes store their
+ * keys again. The shapes live outside the document and are released by the
+ * object destructors, which an arena allocator never runs, so this storage
+ * can not be combined with JsonArenaAllocator.
+ */
+struct JsonShapedObjectStorage {
+  static constexpr std::size_t max_shape_keys = 64;  ///< Objects with more attributes never share their keys
+};
 
-            //Parse the next json should be a string.
-            JsonBase *json_key = parse();
+/**
+ * @brief The key sequence shared by objects with JsonShapedObjectStorage,
+ * also called hidden class. Shapes form a tree starting at the empty root(),
+ * every child extends the key sequence of its parent by one key. The shape of
+ * a key sequence is created once and reused by every object with the same
+ * keys in the same order. Shapes are reference counted and released with the
+ * last object.
+ */
+class JsonShape {
+  public:
+    JsonShape(const JsonShape &) = delete;
+    JsonShape &operator=(const JsonShape &) = delete;
 
-            // Write the string into key by moving it.
-            json_key->map_string([&key](std::string x){key = std::move(x);});
-            // Delete the json_key we dont need it no more.
-            delete json_key;
-            // Empty keys are invalid in the Json standard.
-            if (key == "")
-              set_error(JsonParserError::expected_string_attribute_key);
-          }
-          else {
-            // Ok we have a key already expect a double colon now. The first if
-            // should filter all filling characters therefore the next one needs
-            // to be a double colon.
-            if (underlying_json_[abs_pos_++]!=':') {
-              set_error(JsonParserError::expected_colon_but_got_different_character_instead);
-              break;
-            }
+    /**
+     * @brief Returns the shape without keys every object starts with, it is
+     * never released.
+     */
+    static JsonShape *root() {
+      // Leaked on purpose, objects in static storage may outlive it otherwise.
+      static JsonShape *shape = new JsonShape(nullptr,JsonKey());
+      return shape;
+    }
 
-            // Parse the value either string, null ....
-            JsonBase *json_item = parse();
-            // Set the object in the objects.
-            object->set(std::move(key),json_item);
+    /**
+     * @brief Returns the shape with the given keys in this order and takes a
+     * reference of it for the caller. Only the returned shape stores all
+     * keys, the shapes on the way to it only store their last key.
+     *
+     * @param count The number of keys, at least one.
+     * @param key_at Returns the key at the given position, the keys must be
+     * distinct.
+     *
+     * @return The shape, release it with release().
+     */
+    template<typename KeyAt>
+    static JsonShape *intern(std::size_t count, KeyAt &&key_at) {
+      JsonShape *shape = root();
+      for (std::size_t i = 0; i < count; i++) {
+        JsonShape *next = shape->child(JsonKey(key_at(i)));
+        shape->release();
+        shape = next;
+      }
+      shape->parent_->lock();
+      shape->complete();
+      shape->parent_->unlock();
+      return shape;
+    }
 
-            //Reset keys and expect comma next.
-            key = "";
-            expect_comma = true;
-          }
+    /**
+     * @brief Returns the position of the key or size() if the shape does not
+     * contain the key.
+     */
+    std::size_t find(const JsonKey &key) const {
+      if (index_) {
+        auto fnd = index_->find(key);
+        return fnd == index_->end() ? keys_.size() : fnd->second;
+      }
+      for (std::size_t i = 0; i < keys_.size(); i++) {
+        if (keys_[i] == key)
+          return i;
+      }
+      return keys_.size();
+    }
+
+    /**
+     * @brief Returns the position of the key like find(const JsonKey&), small
+     * shapes are searched without hashing the key.
+     */
+    std::size_t find(std::string_view key) const {
+      if (index_)
+        return find(JsonKey(key));
+      for (std::size_t i = 0; i < keys_.size(); i++) {
+        if (keys_[i].view == key)
+          return i;
+      }
+      return keys_.size();
+    }
+
+    /**
+     * @brief Returns the number of keys of a shape returned by intern(...).
+     */
+    std::size_t size() const {
+      return keys_.size();
+    }
+
+    /**
+     * @brief Returns the key stored at the given position.
+     */
+    const JsonKey &key(std::size_t pos) const {
+      return keys_[pos];
+    }
+
+    /**
+     * @brief Takes another reference of the shape.
+     */
+    void acquire() {
+      if (!parent_)
+        return;
+      parent_->lock();
+      ++references_;
+      parent_->unlock();
+    }
+
+    /**
+     * @brief Releases a reference, the last one deletes the shape and
+     * releases its parent.
+     */
+    void release() {
+      if (!parent_)
+        return;
+      JsonShape *parent = parent_;
+      parent->lock();
+      // The parent is locked during every change of the count, a shape
+      // reaching zero can therefore not be found by add(...) any more.
+      if (--references_ != 0) {
+        parent->unlock();
+        return;
+      }
+      parent->children_.erase(std::find(parent->children_.begin(),parent->children_.end(),this));
+      parent->unlock();
+      delete this;
+      parent->release();
+    }
+
+  private:
+    /**
+     * @brief Creates the child of parent with the given key and one
+     * reference, the keys are only collected by complete().
+     */
+    JsonShape(JsonShape *parent, const JsonKey &key) : parent_(parent), references_(1), key_(key.view), hash_(key.hash) {
+    }
+
+    /**
+     * @brief Returns the child with the given key and takes a reference of it
+     * for the caller, the child is created if it does not exist yet.
+     */
+    JsonShape *child(const JsonKey &key) {
+      lock();
+      for (JsonShape *child : children_) {
+        if (child->own_key() == key) {
+          ++child->references_;
+          unlock();
+          return child;
+        }
+      }
+      JsonShape *child = new JsonShape(this,key);
+      children_.push_back(child);
+      // Every child keeps its parent alive.
+      if (parent_)
+        acquire();
+      unlock();
+      return child;
+    }
+
+    /**
+     * @brief Returns the last key of the shape.
+     */
+    JsonKey own_key() const {
+      return JsonKey(key_,hash_);
+    }
+
+    /**
+     * @brief Collects the keys of all parents once, called with the mutex of
+     * the parent locked before the shape is handed to an object.
+     */
+    void complete() {
+      if (!keys_.empty())
+        return;
+      std::size_t count = 0;
+      for (const JsonShape *it = this; it->parent_; it = it->parent_)
+        count++;
+      keys_.resize(count);
+      for (const JsonShape *it = this; it->parent_; it = it->parent_)
+        keys_[--count] = it->own_key();
+      if (keys_.size() > JsonFlatObjectStorage::index_threshold) {
+        index_.reset(new std::unordered_map<JsonKey, std::size_t, JsonKeyHash>(keys_.size()*2));
+        for (std::size_t i = 0; i < keys_.size(); i++)
+          index_->emplace(keys_[i],i);
+      }
+    }
+
+    void lock() {
+#if !defined(GC_JSON_NO_THREADS)
+      mutex_.lock();
+#endif
+    }
+
+    void unlock() {
+#if !defined(GC_JSON_NO_THREADS)
+      mutex_.unlock();
+#endif
+    }
+
+    JsonShape *parent_;                 ///< The shape without the last key or nullptr for the root
+    std::size_t references_;            ///< The number of objects, children and caches using the shape, guarded by the mutex of the parent
+    std::string key_;                   ///< The memory of the last key, the other keys belong to the parents
+    std::size_t hash_;                  ///< The hash of the last key
+    std::vector<JsonKey> keys_;         ///< All keys in insertion order once complete() was called, empty before
+    std::unique_ptr<std::unordered_map<JsonKey, std::size_t, JsonKeyHash>> index_;  ///< The positions of the keys for larger shapes
+    std::vector<JsonShape*> children_;  ///< The shapes with one more key
+#if !defined(GC_JSON_NO_THREADS)
+    std::mutex mutex_;                  ///< Guards children_ and the reference counts of the children
+#endif
+};
+
+/**
+ * @brief A key which remembers the shape and position it was last found at,
+ * JsonBase::get(JsonCachedKey&) on objects with the same JsonShape is then
+ * a plain array access. Objects of other storage policies are searched with
+ * the key.
+ */
+class JsonCachedKey {
+  public:
+    /**
+     * @brief Hashes the key, the string must outlive the cached key.
+     */
+    explicit JsonCachedKey(std::string_view key) : key_(key), shape_(nullptr), pos_(0) {
+    }
+
+    /**
+     * @brief Uses the already hashed key, e.g. from a JsonKeyInterner.
+     */
+    explicit JsonCachedKey(const JsonKey &key) : key_(key), shape_(nullptr), pos_(0) {
+    }
+
+    JsonCachedKey(const JsonCachedKey &) = delete;
+    JsonCachedKey &operator=(const JsonCachedKey &) = delete;
+
+    /**
+     * @brief Releases the cached shape.
+     */
+    ~JsonCachedKey() {
+      if (shape_)
+        shape_->release();
+    }
+
+    /**
+     * @brief Returns the key.
+     */
+    const JsonKey &key() const {
+      return key_;
+    }
+
+    /**
+     * @brief Returns the position of the key inside the shape or
+     * shape->size() if it does not contain the key, only the first call for
+     * a shape searches it.
+     */
+    std::size_t find(JsonShape *shape) {
+      if (shape != shape_) {
+        // The cached shape is referenced so its address can not be reused
+        // by a different shape.
+        shape->acquire();
+        if (shape_)
+          shape_->release();
+        shape_ = shape;
+        pos_ = shape->find(key_);
+      }
+      return pos_;
+    }
+
+  private:
+    JsonKey key_;        ///< The key to look up
+    JsonShape *shape_;   ///< The shape of the last lookup or nullptr
+    std::size_t pos_;    ///< The position of the key inside shape_
+};
+
+/**
+ * @brief A view of contiguous values, e.g. the packed numbers of a json
+ * array, see JsonBase::packed_integers().
+ *
+ * @tparam T The type of the values.
+ */
+template<typename T>
+class JsonSpan {
+  public:
+    JsonSpan() : data_(nullptr), size_(0) {
+    }
+
+    JsonSpan(T *data, std::size_t size) : data_(data), size_(size) {
+    }
+
+    T *data() const {
+      return data_;
+    }
+
+    std::size_t size() const {
+      return size_;
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    T &operator[](std::size_t index) const {
+      return data_[index];
+    }
+
+    T *begin() const {
+      return data_;
+    }
+
+    T *end() const {
+      return data_ + size_;
+    }
+
+  private:
+    T *data_;           ///< The first value
+    std::size_t size_;  ///< The number of values
+};
+
+/**
+ * @brief One attribute of a json object with JsonFlatObjectStorage.
+ *
+ * @tparam Value The json type of the value.
+ */
+template<typename Value>
+struct JsonFlatAttribute {
+  std::string_view key;  ///< The unescaped key
+  Value value;           ///< The json stored under the key
+  bool owns_key;         ///< True if the key memory was allocated by the object
+};
+
+/**
+ * @brief Detects handlers of JsonBase::parse_events(...) which provide
+ * raw_string(std::string_view, bool) and raw_key(std::string_view, bool) to
+ * receive strings before they are unescaped.
+ */
+template<typename Handler, typename = void>
+struct json_has_raw_strings : std::false_type {
+};
+
+template<typename Handler>
+struct json_has_raw_strings<Handler, std::void_t<decltype(std::declval<Handler&>().raw_string(std::string_view(),false))>> : std::true_type {
+};
+
+/**
+ * @brief Describes one member of a struct which is read from and written to
+ * the attribute key of a json object, see JsonFields.
+ *
+ * @tparam Class The struct containing the member.
+ * @tparam Member The type of the member.
+ */
+template<typename Class, typename Member>
+struct JsonField {
+  std::string_view key;    ///< The attribute key of the member
+  Member Class::*member;   ///< The member
+};
+
+/**
+ * @brief Creates the description of one member, see JsonFields.
+ *
+ * @param key The attribute key of the member.
+ * @param member The member.
+ */
+template<typename Class, typename Member>
+constexpr JsonField<Class,Member> json_field(std::string_view key, Member Class::*member) {
+  return JsonField<Class,Member>{key,member};
+}
+
+/**
+ * @brief Binds a struct to a json object for JsonBase::parse_struct(...) and
+ * JsonBase::dump_struct(...). Specializations provide a constexpr tuple of
+ * json_field(...) named fields, GC_JSON_FIELDS(Type,members...) creates the
+ * specialization for members named like their keys:
+ * ```
+ * template<>
+ * struct JsonFields<User> {
+ *   static constexpr auto fields = std::make_tuple(json_field("id",&User::id),json_field("name",&User::name));
+ * };
+ * ```
+ */
+template<typename T>
+struct JsonFields;
+
+/**
+ * @brief Detects types with a JsonFields specialization.
+ */
+template<typename T, typename = void>
+struct json_is_bound : std::false_type {
+};
+
+template<typename T>
+struct json_is_bound<T, std::void_t<decltype(JsonFields<T>::fields)>> : std::true_type {
+};
+
+/**
+ * @brief Detects std::optional.
+ */
+template<typename T>
+struct json_is_optional : std::false_type {
+};
+
+template<typename T>
+struct json_is_optional<std::optional<T>> : std::true_type {
+};
+
+/**
+ * @brief Detects std::vector.
+ */
+template<typename T>
+struct json_is_vector : std::false_type {
+};
+
+template<typename T, typename Allocator>
+struct json_is_vector<std::vector<T,Allocator>> : std::true_type {
+};
+
+/**
+ * @brief Hashes an attribute key with FNV-1a starting from the seed, usable
+ * at compile time.
+ */
+constexpr std::uint32_t json_key_hash(std::string_view key, std::uint32_t seed) {
+  std::uint32_t hash = 2166136261u ^ seed;
+  for (std::size_t i = 0; i < key.size(); i++)
+    hash = (hash ^ (std::uint8_t)key[i]) * 16777619u;
+  return hash ^ (hash >> 15);
+}
+
+/**
+ * @brief A perfect hash of N attribute keys which is built at compile time.
+ * The seed is searched so that every key gets its own slot, if there is none
+ * the keys are compared one after the other.
+ *
+ * @tparam N The number of keys.
+ */
+template<std::size_t N>
+class JsonKeyTable {
+  public:
+    static constexpr std::size_t slot_count = N <= 4 ? 16 : (N <= 16 ? 64 : (N <= 64 ? 256 : 1024));  ///< At least four slots per key for up to 256 keys
+
+    /**
+     * @brief Searches a seed without collisions.
+     *
+     * @param keys The keys, their index is returned by find(...).
+     */
+    constexpr JsonKeyTable(const std::array<std::string_view,N> &keys) : keys_(), slots_(), seed_(0), perfect_(false) {
+      for (std::size_t i = 0; i < N; i++)
+        keys_[i] = keys[i];
+      for (std::uint32_t seed = 0; seed < 512 && !perfect_; seed++) {
+        for (std::size_t i = 0; i < slot_count; i++)
+          slots_[i] = N;
+        bool collision = false;
+        for (std::size_t i = 0; i < N && !collision; i++) {
+          std::size_t slot = json_key_hash(keys[i],seed) & (slot_count-1);
+          collision = slots_[slot] != N;
+          slots_[slot] = i;
+        }
+        seed_ = seed;
+        perfect_ = !collision;
+      }
+    }
+
+    /**
+     * @brief Returns the index of the key or N if it is unknown.
+     */
+    std::size_t find(std::string_view key) const {
+      if (perfect_) {
+        std::size_t index = slots_[json_key_hash(key,seed_) & (slot_count-1)];
+        return index < N && keys_[index] == key ? index : N;
+      }
+      for (std::size_t i = 0; i < N; i++)
+        if (keys_[i] == key)
+          return i;
+      return N;
+    }
+
+  private:
+    std::string_view keys_[N == 0 ? 1 : N];  ///< The keys by index
+    std::size_t slots_[slot_count];          ///< The index of the key in every slot, N for empty slots
+    std::uint32_t seed_;                     ///< The seed of the hash
+    bool perfect_;                           ///< False if no seed without collisions was found
+};
+
+/**
+ * @brief The compile time tables of a struct bound with JsonFields.
+ */
+template<typename T>
+struct JsonBinding {
+  using Fields = typename std::decay<decltype(JsonFields<T>::fields)>::type;
+  static constexpr std::size_t size = std::tuple_size<Fields>::value;  ///< The number of bound members
+
+  template<std::size_t... Is>
+  static constexpr JsonKeyTable<size> make_table(std::index_sequence<Is...>) {
+    return JsonKeyTable<size>(std::array<std::string_view,size>{{std::get<Is>(JsonFields<T>::fields).key...}});
+  }
+
+  static constexpr JsonKeyTable<size> table = make_table(std::make_index_sequence<size>());  ///< Finds the member of a key
+};
+
+/**
+ * @brief Receives the one scalar parsed when reading into a bound member,
+ * also ignores all events of skipped values.
+ */
+struct JsonScalarEvent {
+  long long integer_value = 0;   ///< The parsed integer
+  double floating_value = 0;     ///< The parsed double
+  bool boolean_value = false;    ///< The parsed boolean
+  bool is_float = false;         ///< True if the number was a double
+  std::string_view raw;          ///< The escaped string or key
+  bool has_escapes = false;      ///< True if raw must be unescaped
+
+  bool null() { return true; }
+  bool boolean(bool value) { boolean_value = value; return true; }
+  bool integer(long long value) { integer_value = value; is_float = false; return true; }
+  bool floating(double value) { floating_value = value; is_float = true; return true; }
+  bool raw_string(std::string_view value, bool escapes) { raw = value; has_escapes = escapes; return true; }
+  bool raw_key(std::string_view value, bool escapes) { raw = value; has_escapes = escapes; return true; }
+  bool start_object() { return true; }
+  bool end_object() { return true; }
+  bool start_array() { return true; }
+  bool end_array() { return true; }
+};
+
+/**
+ * @brief Helpers of GC_JSON_FIELDS(...).
+ */
+#define GC_JSON_EXPAND(x) x
+#define GC_JSON_CONCAT_(a,b) a##b
+#define GC_JSON_CONCAT(a,b) GC_JSON_CONCAT_(a,b)
+#define GC_JSON_COUNT(...) GC_JSON_EXPAND(GC_JSON_COUNT_(__VA_ARGS__,32,31,30,29,28,27,26,25,24,23,22,21,20,19,18,17,16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1))
+#define GC_JSON_COUNT_(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,_16,_17,_18,_19,_20,_21,_22,_23,_24,_25,_26,_27,_28,_29,_30,_31,_32,N,...) N
+#define GC_JSON_FIELD(Type,member) json_field(#member,&Type::member)
+#define GC_JSON_FIELDS_1(Type,member) GC_JSON_FIELD(Type,member)
+#define GC_JSON_FIELDS_2(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_1(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_3(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_2(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_4(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_3(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_5(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_4(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_6(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_5(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_7(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_6(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_8(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_7(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_9(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_8(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_10(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_9(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_11(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_10(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_12(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_11(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_13(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_12(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_14(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_13(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_15(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_14(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_16(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_15(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_17(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_16(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_18(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_17(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_19(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_18(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_20(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_19(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_21(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_20(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_22(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_21(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_23(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_22(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_24(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_23(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_25(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_24(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_26(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_25(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_27(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_26(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_28(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_27(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_29(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_28(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_30(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_29(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_31(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_30(Type,__VA_ARGS__))
+#define GC_JSON_FIELDS_32(Type,member,...) GC_JSON_FIELD(Type,member), GC_JSON_EXPAND(GC_JSON_FIELDS_31(Type,__VA_ARGS__))
+
+/**
+ * @brief Binds up to 32 members of a struct to the attribute keys of the
+ * same name, must be used in the global namespace:
+ * ```
+ * struct User { int id; std::string name; std::vector<std::string> tags; };
+ * GC_JSON_FIELDS(User,id,name,tags);
+ * ```
+ */
+#define GC_JSON_FIELDS(Type,...) \
+  template<> \
+  struct JsonFields<Type> { \
+    static constexpr auto fields = std::make_tuple(GC_JSON_EXPAND(GC_JSON_CONCAT(GC_JSON_FIELDS_,GC_JSON_COUNT(__VA_ARGS__))(Type,__VA_ARGS__))); \
+  }
+
+/**
+ * @brief The options to change the behaviour of JsonBase::parse(...)
+ */
+struct JsonParseOptions {
+  bool borrow_strings = false;  ///< Strings and attribute keys reference the parsed buffer instead of copying it, the buffer must outlive the parsed json
+  std::size_t max_depth = 1024;   ///< Deeper nested objects and arrays stop parsing with JsonParserError::exceeded_max_depth
+  bool intern_keys = false;       ///< Stores every distinct attribute key of the document once in its arena, only with JsonArenaAllocator
+  JsonKeyInterner *key_interner = nullptr;  ///< Interns the keys in this table shared between documents instead, it must outlive them and be thread safe for parse_many(...) and parse_parallel(...)
+};
+
+/**
+ * @brief Statistics of one JsonBase::parse(...), only collected with a log
+ * level of JsonLogLevel::log_stats or higher and all zero otherwise.
+ */
+struct JsonParseStats {
+  std::size_t bytes_scanned = 0;   ///< The number of consumed characters
+  std::size_t objects = 0;         ///< The number of parsed objects
+  std::size_t arrays = 0;          ///< The number of parsed arrays
+  std::size_t strings = 0;         ///< The number of parsed string values
+  std::size_t keys = 0;            ///< The number of parsed attribute keys
+  std::size_t integers = 0;        ///< The number of parsed integers
+  std::size_t floats = 0;          ///< The number of parsed doubles
+  std::size_t booleans = 0;        ///< The number of parsed booleans
+  std::size_t nulls = 0;           ///< The number of parsed nulls
+  std::size_t allocations = 0;     ///< The number of nodes the DOM builder created with the allocator
+  std::size_t max_depth = 0;       ///< The deepest nesting of objects and arrays
+  std::uint64_t string_ns = 0;     ///< Time spent scanning and handing out strings and keys
+  std::uint64_t number_ns = 0;     ///< Time spent converting and handing out numbers
+  std::uint64_t structural_ns = 0; ///< The remaining time spent on structure and literals
+  std::uint64_t total_ns = 0;      ///< The time of the whole parse
+
+  /**
+   * @brief Returns all counters as one line, used for trace logging.
+   */
+  std::string to_string() const {
+    return "bytes=" + std::to_string(bytes_scanned) + " objects=" + std::to_string(objects) +
+      " arrays=" + std::to_string(arrays) + " strings=" + std::to_string(strings) +
+      " keys=" + std::to_string(keys) + " integers=" + std::to_string(integers) +
+      " floats=" + std::to_string(floats) + " booleans=" + std::to_string(booleans) +
+      " nulls=" + std::to_string(nulls) + " allocations=" + std::to_string(allocations) +
+      " max_depth=" + std::to_string(max_depth) + " string_ns=" + std::to_string(string_ns) +
+      " number_ns=" + std::to_string(number_ns) + " structural_ns=" + std::to_string(structural_ns) +
+      " total_ns=" + std::to_string(total_ns);
+  }
+};
+
+/**
+ * @brief Adds the lifetime of the timer in nanoseconds to a counter.
+ */
+class JsonPhaseTimer {
+  public:
+    explicit JsonPhaseTimer(std::uint64_t &counter) : counter_(counter), start_(std::chrono::steady_clock::now()) {
+    }
+
+    ~JsonPhaseTimer() {
+      counter_ += (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+  private:
+    std::uint64_t &counter_;                             ///< Receives the elapsed time
+    std::chrono::steady_clock::time_point start_;        ///< The construction time
+};
+
+/**
+ * @brief Replaces JsonPhaseTimer when no statistics are collected, compiles
+ * to nothing.
+ */
+struct JsonNoPhaseTimer {
+  explicit JsonNoPhaseTimer(std::uint64_t &) {
+  }
+};
+
+/**
+ * @brief A read only view of a whole file. Where available the file is memory
+ * mapped, otherwise (or with GC_JSON_NO_MMAP defined) it is read into one heap
+ * buffer. The content does not move when the object is moved.
+ */
+class JsonMappedFile {
+  public:
+    JsonMappedFile() : data_(nullptr), size_(0), mapped_(false), open_(false) {
+    }
+
+    /**
+     * @brief Opens and maps the file, check is_open() for success.
+     *
+     * @param path The path of the file.
+     */
+    explicit JsonMappedFile(const std::string &path) : JsonMappedFile() {
+#if defined(GC_JSON_MMAP)
+      int fd = ::open(path.c_str(),O_RDONLY);
+      if (fd < 0)
+        return;
+      struct stat info;
+      if (::fstat(fd,&info) != 0) {
+        ::close(fd);
+        return;
+      }
+      open_ = true;
+      size_ = (std::size_t)info.st_size;
+      if (size_ != 0) {
+        void *data = ::mmap(nullptr,size_,PROT_READ,MAP_PRIVATE,fd,0);
+        if (data != MAP_FAILED) {
+          // The parser reads the file front to back exactly once.
+          ::madvise(data,size_,MADV_SEQUENTIAL);
+          data_ = static_cast<const char*>(data);
+          mapped_ = true;
+        }
+        else {
+          size_ = 0;
+          open_ = read_buffered(path);
+        }
+      }
+      ::close(fd);
+#else
+      open_ = read_buffered(path);
+#endif
+    }
+
+    JsonMappedFile(const JsonMappedFile &) = delete;
+    JsonMappedFile &operator=(const JsonMappedFile &) = delete;
+
+    JsonMappedFile(JsonMappedFile &&other) noexcept : JsonMappedFile() {
+      swap(other);
+    }
+
+    JsonMappedFile &operator=(JsonMappedFile &&other) noexcept {
+      if (this != &other) {
+        JsonMappedFile tmp(std::move(other));
+        swap(tmp);
+      }
+      return *this;
+    }
+
+    ~JsonMappedFile() {
+#if defined(GC_JSON_MMAP)
+      if (mapped_)
+        ::munmap(const_cast<char*>(data_),size_);
+#endif
+    }
+
+    /**
+     * @brief Returns true if the file could be opened and read.
+     */
+    bool is_open() const {
+      return open_;
+    }
+
+    /**
+     * @brief Returns true if the content is memory mapped and not copied.
+     */
+    bool is_mapped() const {
+      return mapped_;
+    }
+
+    /**
+     * @brief Returns the content of the file.
+     */
+    std::string_view view() const {
+      return std::string_view(data_ ? data_ : "",size_);
+    }
+
+  private:
+    /**
+     * @brief Reads the whole file into buffer_.
+     *
+     * @return Returns false if the file can not be read.
+     */
+    bool read_buffered(const std::string &path) {
+      std::FILE *file = std::fopen(path.c_str(),"rb");
+      if (!file)
+        return false;
+      std::vector<char> content;
+      char chunk[4096];
+      std::size_t read;
+      while ((read = std::fread(chunk,1,sizeof(chunk),file)) != 0)
+        content.insert(content.end(),chunk,chunk+read);
+      bool ok = !std::ferror(file);
+      std::fclose(file);
+      if (!ok)
+        return false;
+      buffer_.reset(new char[content.size() ? content.size() : 1]);
+      std::memcpy(buffer_.get(),content.data(),content.size());
+      data_ = buffer_.get();
+      size_ = content.size();
+      return true;
+    }
+
+    void swap(JsonMappedFile &other) noexcept {
+      std::swap(data_,other.data_);
+      std::swap(size_,other.size_);
+      std::swap(mapped_,other.mapped_);
+      std::swap(open_,other.open_);
+      buffer_.swap(other.buffer_);
+    }
+
+    const char *data_;                ///< The content, either mapped or buffer_
+    std::size_t size_;                ///< The size of the content in bytes
+    bool mapped_;                     ///< True if data_ must be unmapped
+    bool open_;                       ///< True if the file was read successfully
+    std::unique_ptr<char[]> buffer_;  ///< The content if the file is not mapped
+};
+
+/**
+ * @brief A json parsed from a file together with the file content, strings
+ * of the json reference the content directly. Moving the document keeps them
+ * valid, the json must not outlive its document.
+ *
+ * @tparam Json The JsonBase type of the document.
+ */
+template<typename Json>
+class JsonDocument {
+  public:
+    JsonDocument(JsonMappedFile file, Json root) : file_(std::move(file)), root_(std::move(root)) {
+    }
+
+    /**
+     * @brief Returns the root of the parsed json.
+     */
+    Json &root() {
+      return root_;
+    }
+
+    Json &operator*() {
+      return root_;
+    }
+
+    Json *operator->() {
+      return &root_;
+    }
+
+    /**
+     * @brief Returns the file the json was parsed from.
+     */
+    const JsonMappedFile &file() const {
+      return file_;
+    }
+
+  private:
+    JsonMappedFile file_;  ///< Declared first so the json is destroyed before the content it references
+    Json root_;            ///< The parsed json
+};
+
+/**
+ * @brief A json pointer (RFC 6901) parsed once into its reference tokens,
+ * e.g. "/a/b/3". The tokens are unescaped and array indices converted to
+ * numbers up front so evaluating the path only compares keys.
+ */
+class JsonPath {
+  public:
+    /**
+     * @brief One reference token of the pointer.
+     */
+    struct Token {
+      std::string key;  ///< The unescaped attribute key
+      int index;        ///< The array index or -1 if the token is not a valid index
+    };
+
+    /**
+     * @brief Parses the json pointer, check valid() for success.
+     *
+     * @param pointer The json pointer, "" references the whole json.
+     */
+    explicit JsonPath(std::string_view pointer) : valid_(pointer.empty() || pointer[0] == '/') {
+      if (!valid_ || pointer.empty())
+        return;
+      std::size_t pos = 1;
+      for (;;) {
+        std::size_t end = std::min(pointer.find('/',pos),pointer.size());
+        Token token{std::string(),-1};
+        for (std::size_t i = pos; i < end; i++) {
+          if (pointer[i] != '~') {
+            token.key += pointer[i];
+            continue;
+          }
+          if (i+1 == end || (pointer[i+1] != '0' && pointer[i+1] != '1')) {
+            valid_ = false;
+            tokens_.clear();
+            return;
+          }
+          token.key += pointer[++i] == '0' ? '~' : '/';
+        }
+        token.index = array_index(token.key);
+        tokens_.push_back(std::move(token));
+        if (end == pointer.size())
+          break;
+        pos = end+1;
+      }
+    }
+
+    /**
+     * @brief Returns false if the pointer is malformed, invalid paths never
+     * match.
+     */
+    bool valid() const {
+      return valid_;
+    }
+
+    /**
+     * @brief Returns the number of reference tokens.
+     */
+    std::size_t size() const {
+      return tokens_.size();
+    }
+
+    /**
+     * @brief Returns the reference token at the given depth.
+     */
+    const Token &operator[](std::size_t depth) const {
+      return tokens_[depth];
+    }
+
+  private:
+    /**
+     * @brief Converts the token into an array index, leading zeros and "-"
+     * are not allowed.
+     *
+     * @return The index or -1.
+     */
+    static int array_index(const std::string &token) {
+      if (token.empty() || token.size() > 9 || (token[0] == '0' && token.size() > 1))
+        return -1;
+      int index = 0;
+      for (char c : token) {
+        if (c < '0' || c > '9')
+          return -1;
+        index = index*10 + (c-'0');
+      }
+      return index;
+    }
+
+    std::vector<Token> tokens_;  ///< The reference tokens from the root down
+    bool valid_;                 ///< False if the pointer is malformed
+};
+
+/**
+ * @brief The tape format written by JsonTapeWriter and read by JsonTape. A
+ * tape is a header followed by 64 bit words and a string pool, all offsets
+ * are relative so it can be mapped at any address and shared between
+ * processes. Every value starts with a word holding the tag in the top 8 bits
+ * and a payload in the lower 56 bits:
+ *
+ *  - null, true, false: no payload
+ *  - integer, floating: the value follows in the next word
+ *  - string: the payload is the offset of the string in the pool, which
+ *    stores a 32 bit length followed by the characters
+ *  - array, object: the payload is the word one past the container, the
+ *    next word holds the number of items or attributes, then follow the
+ *    items or the pairs of key string and value
+ *
+ * Words are stored in the byte order of the writer, the magic number rejects
+ * tapes written on a machine with a different byte order.
+ */
+struct JsonTapeFormat {
+  static constexpr std::uint64_t magic = 0x0001455041544a47ULL;  ///< "GJTAPE" and the version 1
+  static constexpr std::size_t header_size = 24;                 ///< Magic, number of words and pool size
+  static constexpr std::uint64_t payload_mask = (1ULL << 56) - 1;
+
+  static constexpr char null = 'n';
+  static constexpr char true_value = 't';
+  static constexpr char false_value = 'f';
+  static constexpr char integer = 'l';
+  static constexpr char floating = 'd';
+  static constexpr char string = 's';
+  static constexpr char array = '[';
+  static constexpr char object = '{';
+};
+
+/**
+ * @brief Writes a tape (see JsonTapeFormat) from the calls of an event
+ * handler, either while parsing with JsonBase::parse_events(...) or from a
+ * tree with JsonBase::dump_tape(). Attribute keys are stored once in the pool.
+ */
+class JsonTapeWriter {
+  public:
+    bool null() {
+      return value(JsonTapeFormat::null,0);
+    }
+
+    bool boolean(bool value) {
+      return this->value(value ? JsonTapeFormat::true_value : JsonTapeFormat::false_value,0);
+    }
+
+    bool integer(long long value) {
+      this->value(JsonTapeFormat::integer,0);
+      tape_.push_back((std::uint64_t)value);
+      return true;
+    }
+
+    bool floating(double value) {
+      std::uint64_t bits;
+      std::memcpy(&bits,&value,8);
+      this->value(JsonTapeFormat::floating,0);
+      tape_.push_back(bits);
+      return true;
+    }
+
+    bool string(std::string_view value) {
+      return this->value(JsonTapeFormat::string,pool_string(value));
+    }
+
+    bool key(std::string_view key) {
+      auto fnd = keys_.find(std::string(key));
+      std::uint64_t offset = fnd != keys_.end() ? fnd->second : (keys_[std::string(key)] = pool_string(key));
+      tape_.push_back(word(JsonTapeFormat::string,offset));
+      return true;
+    }
+
+    bool start_object(std::size_t=0) {
+      return open(JsonTapeFormat::object);
+    }
+
+    bool end_object() {
+      return close();
+    }
+
+    bool start_array(std::size_t=0) {
+      return open(JsonTapeFormat::array);
+    }
+
+    bool end_array() {
+      return close();
+    }
+
+    /**
+     * @brief Writes the finished tape into the sink.
+     *
+     * @param sink Receives the header, the words and the pool.
+     */
+    void write(JsonSink &sink) {
+      std::uint64_t header[3] = {JsonTapeFormat::magic,(std::uint64_t)tape_.size(),(std::uint64_t)pool_.size()};
+      sink.append(reinterpret_cast<const char*>(header),sizeof(header));
+      sink.append(reinterpret_cast<const char*>(tape_.data()),tape_.size()*8);
+      sink.append(pool_.data(),pool_.size());
+    }
+
+    /**
+     * @brief Returns the finished tape.
+     */
+    std::string finish() {
+      std::string ret;
+      ret.reserve(JsonTapeFormat::header_size + tape_.size()*8 + pool_.size());
+      {
+        JsonStringSink sink(ret);
+        write(sink);
+      }
+      return ret;
+    }
+
+  private:
+    static std::uint64_t word(char tag, std::uint64_t payload) {
+      return ((std::uint64_t)(unsigned char)tag << 56) | payload;
+    }
+
+    /**
+     * @brief Appends the first word of a value and counts it as item of the
+     * innermost container.
+     */
+    bool value(char tag, std::uint64_t payload) {
+      if (!open_.empty())
+        tape_[open_.back()+1]++;
+      tape_.push_back(word(tag,payload));
+      return true;
+    }
+
+    std::uint64_t pool_string(std::string_view value) {
+      std::uint64_t offset = pool_.size();
+      std::uint32_t length = (std::uint32_t)value.size();
+      pool_.append(reinterpret_cast<const char*>(&length),4);
+      pool_.append(value.data(),value.size());
+      return offset;
+    }
+
+    bool open(char tag) {
+      value(tag,0);
+      open_.push_back(tape_.size()-1);
+      tape_.push_back(0);
+      return true;
+    }
+
+    /**
+     * @brief Stores the end of the innermost container in its first word.
+     */
+    bool close() {
+      std::size_t start = open_.back();
+      open_.pop_back();
+      tape_[start] |= (std::uint64_t)tape_.size();
+      return true;
+    }
+
+    std::vector<std::uint64_t> tape_;                       ///< The words written so far
+    std::string pool_;                                      ///< The string pool
+    std::vector<std::size_t> open_;                         ///< The first word of every open container
+    std::unordered_map<std::string,std::uint64_t> keys_;    ///< The pool offset of every key written so far
+};
+
+/**
+ * @brief A value on a tape. It offers the read accessors of JsonBase, no
+ * call parses anything or allocates except those passing a std::string.
+ * Lookups in objects and arrays skip over the values in front of the wanted
+ * one.
+ */
+class JsonTapeValue {
+  public:
+    /**
+     * @brief Returns the type of the value, for invalid values
+     * JsonType::null.
+     */
+    JsonType type() const {
+      switch (tag()) {
+        case JsonTapeFormat::true_value:
+        case JsonTapeFormat::false_value: return JsonType::boolean;
+        case JsonTapeFormat::integer:     return JsonType::integer;
+        case JsonTapeFormat::floating:    return JsonType::floating_point;
+        case JsonTapeFormat::string:      return JsonType::string;
+        case JsonTapeFormat::array:       return JsonType::array;
+        case JsonTapeFormat::object:      return JsonType::object;
+        default:                          return JsonType::null;
+      }
+    }
+
+    /**
+     * @brief Returns the error of the lookup which created this value.
+     */
+    JsonError error() const {
+      return error_;
+    }
+
+    /**
+     * @brief Returns true if the value is invalid.
+     */
+    bool has_error() const {
+      return error_ != JsonError::ok;
+    }
+
+    /**
+     * @brief Returns the number of items of an array or attributes of an
+     * object, 1 for all other values.
+     */
+    int size() const {
+      if (tag() != JsonTapeFormat::array && tag() != JsonTapeFormat::object)
+        return 1;
+      return (int)word(index_+1);
+    }
+
+    /**
+     * @brief Returns the attribute with the given key, if this is not an
+     * object or the key does not exist the returned value has an error set.
+     *
+     * @param key The key to search for.
+     */
+    JsonTapeValue get(std::string_view key) const {
+      if (tag() != JsonTapeFormat::object)
+        return with_error(JsonError::not_implemented);
+      std::size_t end = container_end();
+      for (std::size_t i = index_+2; i+1 < end; i = next(i+1)) {
+        if (string_at(i) == key)
+          return at(i+1);
+      }
+      return with_error(JsonError::does_not_exist);
+    }
+
+    /**
+     * @brief Returns the item at the given index, if this is not an array or
+     * the index is out of range the returned value has an error set.
+     *
+     * @param index The index of the item.
+     */
+    JsonTapeValue get(int index) const {
+      if (tag() != JsonTapeFormat::array)
+        return with_error(JsonError::not_implemented);
+      if (index < 0 || index >= size())
+        return with_error(JsonError::does_not_exist);
+      std::size_t i = index_+2;
+      for (int n = 0; n < index; n++)
+        i = next(i);
+      return at(i);
+    }
+
+    /**
+     * @brief Returns the value referenced by the json pointer.
+     *
+     * @param path The compiled json pointer.
+     */
+    JsonTapeValue get(const JsonPath &path) const {
+      if (!path.valid())
+        return with_error(JsonError::does_not_exist);
+      JsonTapeValue current(*this);
+      for (std::size_t i = 0; i < path.size() && !current.has_error(); i++)
+        current = current.tag() == JsonTapeFormat::array ? current.get(path[i].index) : current.get(std::string_view(path[i].key));
+      return current;
+    }
+
+    /**
+     * @brief Executes the given function if the value is a string.
+     *
+     * @param func The function to call with a std::string_view into the tape
+     * if it accepts one, otherwise with a copy of the string.
+     *
+     * @return Returns a reference to itself for function chaining
+     */
+    template<typename Func>
+    const JsonTapeValue &map_string(Func &&func) const {
+      if (tag() != JsonTapeFormat::string)
+        return *this;
+      if constexpr (std::is_invocable<Func&,std::string_view>::value)
+        func(string_at(index_));
+      else {
+        std::string tmp(string_at(index_));
+        func(tmp);
+      }
+      return *this;
+    }
+
+    /**
+     * @brief Executes the given function if the value is an integer.
+     *
+     * @return Returns a reference to itself for function chaining
+     */
+    template<typename Func>
+    const JsonTapeValue &map_int(Func &&func) const {
+      if (tag() == JsonTapeFormat::integer)
+        func((int)(long long)word(index_+1));
+      return *this;
+    }
+
+    /**
+     * @brief Executes the given function if the value is a boolean.
+     *
+     * @return Returns a reference to itself for function chaining
+     */
+    template<typename Func>
+    const JsonTapeValue &map_bool(Func &&func) const {
+      if (tag() == JsonTapeFormat::true_value || tag() == JsonTapeFormat::false_value)
+        func(tag() == JsonTapeFormat::true_value);
+      return *this;
+    }
+
+    /**
+     * @brief Executes the given function for every item if the value is an
+     * array.
+     *
+     * @return Returns a reference to itself for function chaining
+     */
+    template<typename Func>
+    const JsonTapeValue &map_array(Func &&func) const {
+      if (tag() != JsonTapeFormat::array)
+        return *this;
+      std::size_t end = container_end();
+      for (std::size_t i = index_+2; i < end; i = next(i)) {
+        JsonTapeValue item = at(i);
+        func(item);
+      }
+      return *this;
+    }
+
+    /**
+     * @brief Executes the given function for every attribute if the value is
+     * an object, the key is passed as std::string_view into the tape if the
+     * function accepts one and as const std::string& otherwise.
+     *
+     * @return Returns a reference to itself for function chaining
+     */
+    template<typename Func>
+    const JsonTapeValue &map_object(Func &&func) const {
+      if (tag() != JsonTapeFormat::object)
+        return *this;
+      std::size_t end = container_end();
+      std::string key;
+      for (std::size_t i = index_+2; i+1 < end; i = next(i+1)) {
+        JsonTapeValue value = at(i+1);
+        if constexpr (std::is_invocable<Func&,std::string_view,JsonTapeValue&>::value)
+          func(string_at(i),value);
+        else {
+          std::string_view view = string_at(i);
+          key.assign(view.data(),view.size());
+          func(static_cast<const std::string&>(key),value);
+        }
+      }
+      return *this;
+    }
+
+    /**
+     * @brief Writes the value as json text into the sink.
+     */
+    void dump(JsonSink &sink) const {
+      write(index_,sink,JsonParseOptions().max_depth);
+    }
+
+    /**
+     * @brief Returns the value as json text.
+     */
+    std::string dump() const {
+      std::string ret;
+      {
+        JsonStringSink sink(ret);
+        write(index_,sink,JsonParseOptions().max_depth);
+      }
+      return ret;
+    }
+
+  private:
+    friend class JsonTape;
+
+    JsonTapeValue(const char *words, std::size_t count, const char *pool, std::size_t pool_size, std::size_t index, JsonError error) : words_(words), count_(count), pool_(pool), pool_size_(pool_size), index_(index), error_(error) {
+    }
+
+    std::uint64_t word(std::size_t index) const {
+      std::uint64_t ret = 0;
+      if (index < count_)
+        std::memcpy(&ret,words_+index*8,8);
+      return ret;
+    }
+
+    char tag_at(std::size_t index) const {
+      return (char)(word(index) >> 56);
+    }
+
+    char tag() const {
+      return error_ == JsonError::ok ? tag_at(index_) : JsonTapeFormat::null;
+    }
+
+    /**
+     * @brief Returns the word one past the container at index_.
+     */
+    std::size_t container_end() const {
+      return std::min<std::size_t>(word(index_) & JsonTapeFormat::payload_mask,count_);
+    }
+
+    /**
+     * @brief Returns the word one past the value at index, never moves
+     * backwards so a damaged tape can not loop.
+     */
+    std::size_t next(std::size_t index) const {
+      char tag = tag_at(index);
+      if (tag == JsonTapeFormat::integer || tag == JsonTapeFormat::floating)
+        return index+2;
+      if (tag == JsonTapeFormat::array || tag == JsonTapeFormat::object)
+        return std::max<std::size_t>(word(index) & JsonTapeFormat::payload_mask,index+2);
+      return index+1;
+    }
+
+    /**
+     * @brief Returns the string in the pool referenced by the word at index,
+     * an empty view if it is out of bounds.
+     */
+    std::string_view string_at(std::size_t index) const {
+      std::uint64_t offset = word(index) & JsonTapeFormat::payload_mask;
+      std::uint32_t length;
+      if (offset > pool_size_ || pool_size_ - offset < 4)
+        return std::string_view();
+      std::memcpy(&length,pool_+offset,4);
+      if (pool_size_ - offset - 4 < length)
+        return std::string_view();
+      return std::string_view(pool_+offset+4,length);
+    }
+
+    JsonTapeValue at(std::size_t index) const {
+      return JsonTapeValue(words_,count_,pool_,pool_size_,index,index < count_ ? JsonError::ok : JsonError::parse_error);
+    }
+
+    JsonTapeValue with_error(JsonError error) const {
+      JsonTapeValue ret(*this);
+      ret.error_ = error;
+      return ret;
+    }
+
+    /**
+     * @brief Writes the value at index, containers nested deeper than depth
+     * levels, which only a damaged tape holds, are written as null so the
+     * recursion is bounded like parsing.
+     */
+    void write(std::size_t index, JsonSink &sink, std::size_t depth) const {
+      switch (tag_at(index)) {
+        case JsonTapeFormat::true_value:
+          sink.append("true",4);
+          return;
+        case JsonTapeFormat::false_value:
+          sink.append("false",5);
+          return;
+        case JsonTapeFormat::integer:
+          sink.commit(json_format_integer((long long)word(index+1),sink.reserve(20)));
+          return;
+        case JsonTapeFormat::floating: {
+          std::uint64_t bits = word(index+1);
+          double value;
+          std::memcpy(&value,&bits,8);
+          sink.commit(json_format_double(value,sink.reserve(32)));
+          return;
+        }
+        case JsonTapeFormat::string:
+          sink.put('"');
+          json_escape(string_at(index),sink);
+          sink.put('"');
+          return;
+        case JsonTapeFormat::array:
+        case JsonTapeFormat::object: {
+          if (depth == 0) {
+            sink.append("null",4);
+            return;
+          }
+          bool is_object = tag_at(index) == JsonTapeFormat::object;
+          std::size_t end = std::min<std::size_t>(word(index) & JsonTapeFormat::payload_mask,count_);
+          sink.put(is_object ? '{' : '[');
+          for (std::size_t i = index+2; i < end; i = next(i)) {
+            if (i != index+2)
+              sink.put(',');
+            if (is_object) {
+              sink.put('"');
+              json_escape(string_at(i),sink);
+              sink.append("\":",2);
+              if (++i >= end)
+                break;
+            }
+            write(i,sink,depth-1);
+          }
+          sink.put(is_object ? '}' : ']');
+          return;
+        }
+        default:
+          sink.append("null",4);
+      }
+    }
+
+    const char *words_;      ///< The first word of the tape
+    std::size_t count_;      ///< The number of words
+    const char *pool_;       ///< The string pool
+    std::size_t pool_size_;  ///< The size of the string pool in bytes
+    std::size_t index_;      ///< The first word of this value
+    JsonError error_;        ///< The error of the lookup which created this value
+};
+
+/**
+ * @brief A tape (see JsonTapeFormat) ready to be queried. The tape is either
+ * borrowed or a mapped file kept alive by this object, open it with
+ * JsonTape(JsonMappedFile(path)) to share the page cached file between
+ * processes.
+ */
+class JsonTape {
+  public:
+    /**
+     * @brief Uses the tape inside the given buffer, which must outlive this
+     * object and all its values.
+     *
+     * @param data The tape.
+     */
+    explicit JsonTape(std::string_view data) : data_(data), count_(0), pool_size_(0), valid_(false) {
+      validate();
+    }
+
+    /**
+     * @brief Uses the content of the file as tape.
+     *
+     * @param file The mapped tape file, kept alive by this object.
+     */
+    explicit JsonTape(JsonMappedFile file) : file_(std::move(file)), data_(file_.view()), count_(0), pool_size_(0), valid_(false) {
+      validate();
+    }
+
+    /**
+     * @brief Returns false if the data is no tape or damaged.
+     */
+    bool valid() const {
+      return valid_;
+    }
+
+    /**
+     * @brief Returns the root value, it has JsonError::parse_error set if the
+     * tape is invalid.
+     */
+    JsonTapeValue root() const {
+      const char *words = data_.data() + JsonTapeFormat::header_size;
+      return JsonTapeValue(words,count_,words+count_*8,pool_size_,0,valid_ ? JsonError::ok : JsonError::parse_error);
+    }
+
+  private:
+    void validate() {
+      std::uint64_t header[3];
+      if (data_.size() < JsonTapeFormat::header_size)
+        return;
+      std::memcpy(header,data_.data(),sizeof(header));
+      std::uint64_t available = data_.size() - JsonTapeFormat::header_size;
+      if (header[0] != JsonTapeFormat::magic || header[1] == 0 || header[1] > available/8 || header[2] > available - header[1]*8)
+        return;
+      count_ = (std::size_t)header[1];
+      pool_size_ = (std::size_t)header[2];
+      valid_ = true;
+    }
+
+    JsonMappedFile file_;    ///< The mapped file if the tape is not borrowed
+    std::string_view data_;  ///< The whole tape
+    std::size_t count_;      ///< The number of words
+    std::size_t pool_size_;  ///< The size of the string pool
+    bool valid_;             ///< True if the header fits the data
+};
+
+/**
+ * @brief Describes the JsonBase class contains all helper functions to deal
+ * with the underlying interface.
+ *
+ * @tparam log_level What the parser logs and collects. log_error passes
+ * parse errors to log_functor, log_stats also collects JsonParseStats and
+ * log_trace logs them after every parse. With JsonLogLevel::none all of it
+ * compiles to nothing.
+ * @tparam log_functor Constructed with the message to log.
+ * @tparam json_allocator The allocation policy for all nodes, either
+ * JsonHeapAllocator or JsonArenaAllocator.
+ */
+template<JsonLogLevel log_level=JsonLogLevel::none, typename log_functor=JsonStdoutColoredFunctor, typename json_allocator=JsonHeapAllocator, typename object_storage=JsonHashObjectStorage>
+class JsonBase {
+  public:
+    template<typename T>
+    using stl_allocator = typename json_allocator::template stl_allocator<T>;  ///< The allocator used by the containers inside the nodes
+    using string_type = std::basic_string<char, std::char_traits<char>, stl_allocator<char>>;  ///< The string type used inside the nodes
+    static_assert(!json_has_arena<json_allocator>::value || !std::is_same<object_storage, JsonShapedObjectStorage>::value, "JsonShapedObjectStorage needs an allocator which destroys the objects, arena objects would never release their shapes");
+
+    /**
+     * @brief The Basic interface to interact with, can be Object, Array,
+     * String, Integer or Boolean, therefore it provides functions for all of
+     * these implementations
+     */
+    class JsonInterface {
+      public:
+        /**
+         * @brief Returns the type of the underlying implementation can be
+         * anything of JsonType.
+         *
+         * @return The type of the implementation
+         */
+        virtual JsonType type() = 0;
+
+        /**
+         * @brief Returns the size of the implementation is 1 for all primitive
+         * data types or the container size for more complex types
+         *
+         * @return The size of the underlying container or 1 for a primitive
+         * type.
+         */
+        virtual int size() = 0;
+        
+        /**
+         * @brief Inserts the key into the underlying container, illegal
+         * operation for all primitive data types. The standard definition
+         * states not implemented to reduce the boilerplate amount
+         *
+         * @param key The key must be "" for an array and must be non empty for
+         * an object insertion
+         * @param new_insert The new Json to insert into the container
+         * @param err A reference to the error will fill the error if an error
+         * occured, does not change the err otherwise
+         */
+        virtual void insert(const std::string &key, JsonBase *new_insert, JsonError &err) {
+          err = JsonError::not_implemented;
+        }
+
+        /**
+         * @brief Returns the JsonBase for the given key, this operation is only
+         * valid for json objects. For unimplemented cases sets the err field to
+         * JsonError::not_implemented and returns an nullptr
+         *
+         * @param key The key to search for in the object
+         * @param err A reference to an error, will fill the error if an error
+         * occurs and does not touch the variable otherwise
+         *
+         * @return The found JsonObject or nullptr if there is no object with
+         * this key name
+         */
+        virtual JsonBase* get(const std::string &key, JsonError &err) {
+          err = JsonError::not_implemented;
+          return nullptr;
+        }
+
+        /**
+         * @brief Return the Json at the given base index, the interface does
+         * not require out of bound checking! This function is implemented in
+         * json array types. For unimplemented cases set the err field to
+         * JsonError::not_implemented and return nullptr
+         *
+         * @param index The index to access.
+         * @param err A reference to an error instance, the function will set
+         * the error if one occurs and does not touch the error otherwise
+         *
+         * @return 
+         */
+        virtual JsonBase* get(const int index, JsonError &err) {
+          err = JsonError::not_implemented;
+          return nullptr;
+        }
+        
+        /**
+         * @brief Converts the json into a string. 
+         *
+         * @return The json converted to string format
+         */
+        virtual std::string dump() = 0;
+
+        /**
+         * @brief Appends the json in string format to the sink. The default
+         * implementation appends the result of dump(), all implementations of
+         * this library write directly into the sink.
+         *
+         * @param sink The sink to write the json to.
+         */
+        virtual void dump_to(JsonSink &sink) {
+          sink.append(dump());
+        }
+
+        /**
+         * @brief Returns a cheap estimate of the length of dump(), used to
+         * size the output buffer before dumping.
+         *
+         * @return The estimated number of characters.
+         */
+        virtual std::size_t dump_size_estimate() {
+          return 16;
+        }
+
+        /**
+         * @brief Dumps the json into a string presized with
+         * dump_size_estimate() through dump_to(...).
+         *
+         * @return The json converted to string format
+         */
+        std::string dump_string() {
+          std::string ret;
+          ret.reserve(dump_size_estimate());
+          {
+            JsonStringSink sink(ret);
+            dump_to(sink);
+          }
+          return ret;
+        }
+
+        /**
+         * @brief Returns the stored string is only implemented for
+         * JsonType::string. For unimplemented cases set the err field to
+         * JsonError::unimplemented and return an empty string
+         *
+         * @param err Fills the error if the underlying type is not of type
+         * JsonType::string 
+         *
+         * @return Returns the contained string if the type fits.
+         */
+        virtual std::string to_string(JsonError &err) {
+          err = JsonError::not_implemented;
+          return "";
+        }
+
+        /**
+         * @brief Returns a view of the stored characters if the string is
+         * stored unescaped, used to call map_string(...) without a copy.
+         *
+         * @param out Set to the characters of the string.
+         *
+         * @return Returns false if there is no such view.
+         */
+        virtual bool to_string_view(std::string_view &) {
+          return false;
+        }
+
+        /**
+         * @brief Returns the stored int if the underlying type is integer, for
+         * unimplemented cases set error field to JsonError::not_implemented and
+         * return -1.
+         *
+         * @param err A reference to an error, the error gets filled if the
+         * undelrying type is not JsonType::integer. 
+         *
+         * @return Return the stored integer if there is any
+         */
+        virtual long long to_int(JsonError &err) {
+          err = JsonError::not_implemented;
+          return -1;
+        }
+        
+        /**
+         * @brief Returns the stored boolean if the underlying type is boolean,
+         * for unimplemented cases set the error field to
+         * JsonError::not_implemented and return false.
+         *
+         * @param err A reference to an error instance, it is filled if the
+         * underlying type is not JsonType::boolean
+         *
+         * @return Returns the stored boolean if there is any
+         */
+        virtual bool to_bool(JsonError &err) {
+          err = JsonError::not_implemented;
+          return false;
+        }
+
+        /**
+         * @brief Returns the stored double value if the underlying type is
+         * boolean, for unimplemented cases set the error field to
+         * JsonError::not_implemented and return 0
+         *
+         * @param err A reference to an error instance, it if filled if the
+         * underlying type is not JsonType::double
+         *
+         * @return  Returns the stored double or 0 if it is not an double
+         */
+        virtual double to_double(JsonError &err) {
+          err = JsonError::not_implemented;
+          return 0;
+        }
+
+        /**
+         * @brief Returns a copy of this node created with the given allocator,
+         * used before a node shared by several jsons is changed. The children
+         * of containers are copied with JsonBase(json_allocator, const JsonBase&),
+         * so they stay shared unless they are exposed. Nodes which can not be
+         * copied return nullptr and are never unshared.
+         *
+         * @param alloc The allocator of the json receiving the copy.
+         *
+         * @return The new node or nullptr.
+         */
+        virtual JsonInterface *clone(json_allocator &) {
+          return nullptr;
+        }
+
+        /**
+         * @brief Creates an empty destructor to make sure that the inheriting
+         * implementations can call their constructor instead
+         */
+        virtual ~JsonInterface() {};
+
+        std::atomic<std::size_t> references_{1};  ///< The number of jsons sharing this node
+        std::atomic<bool> exposed_{false};        ///< True once references to the children were handed out, copies then copy the node instead of sharing it
+    };
+
+    /**
+     * @brief The implementation of a json object, implements the necesarry
+     * functions of JsonInterface and feeds an error to the unsupported
+     * functions. The attributes are kept in an unordered_map, selected by
+     * JsonHashObjectStorage.
+     */
+    class JsonImplHashObject final : public JsonInterface {
+      public:
+        /**
+         * @brief Creates an empty json object, the attributes are allocated
+         * with the given allocator.
+         *
+         * @param alloc The allocator of the node owning this object.
+         */
+        JsonImplHashObject(json_allocator &alloc) : allocator_(alloc.child()), traits_(0, JsonKeyHash(), std::equal_to<JsonKey>(), alloc.template stl<std::pair<const JsonKey, Attribute>>()) {
+        }
+
+        /**
+         * @brief Returns the type of the Implementation, is always
+         * JsonType::object for this class
+         *
+         * @return Returns JsonType::object.
+         */
+        JsonType type() override {
+          return JsonType::object;
+        }
+
+        /**
+         * @brief Returns the size of the json container, is always the size of
+         * the container.
+         *
+         * @return Returns the number of stored attributes.
+         */
+        int size() override {
+          return traits_.size();
+        }
+
+        /**
+         * @brief Inserts a new attribute with the given key into the map if the
+         * key exists overwrite the existent key and delete the stored object.
+         *
+         * @param key The key to insert/overrwrite inside the map
+         * @param new_insert The object to include into the map, this function
+         * takes memory ownership. This means the object gets deleted by the
+         * destructor of this class. Make sure there are no multiple ownerships.
+         * @param err A reference to an error instance, this puts
+         * JsonError::empty_attribute_key inside the error if the key is empty
+         */
+        void insert(const std::string &key, JsonBase *new_insert, JsonError &err) override {
+          // Check if key is non empty
+          if (key=="")
+            err = JsonError::empty_attribute_key;
+          else
+            insert_attribute(key,false,new_insert);
+        }
+
+        /**
+         * @brief Inserts a new attribute without checking the key. This is
+         * actually a non derived function used by the parser.
+         *
+         * @param key The key to insert/overwrite inside the map.
+         * @param borrowed If true the key is referenced as is and must outlive
+         * this object, otherwise the object stores a copy of the key.
+         * @param new_insert The object to include into the map, this function
+         * takes memory ownership.
+         */
+        void insert_attribute(std::string_view key, bool borrowed, JsonBase *new_insert) {
+          insert_attribute(JsonKey(key),borrowed,new_insert);
+        }
+
+        /**
+         * @brief Inserts a new attribute with an already hashed key, used
+         * for interned keys.
+         *
+         * @param key The key to insert/overwrite inside the map.
+         * @param borrowed If true the key is referenced as is and must outlive
+         * this object, otherwise the object stores a copy of the key.
+         * @param new_insert The object to include into the map, this function
+         * takes memory ownership.
+         */
+        void insert_attribute(JsonKey key, bool borrowed, JsonBase *new_insert) {
+          auto fnd = traits_.find(key);
+          if (fnd != traits_.end()) {
+            // The key exists already, keep the stored key and replace the
+            // value
+            allocator_.destroy(fnd->second.value);
+            fnd->second.value = new_insert;
+            return;
+          }
+
+          if (!borrowed) {
+            char *copy = allocator_.template stl<char>().allocate(key.view.size());
+            key.view.copy(copy,key.view.size());
+            key.view = std::string_view(copy,key.view.size());
+          }
+          traits_.emplace(key,Attribute{new_insert,!borrowed});
+        }
+
+        /**
+         * @brief Inserts the value as new attribute without checking the key,
+         * used by the parser.
+         *
+         * @param key The key to insert/overwrite inside the map.
+         * @param borrowed If true the key is referenced as is and must outlive
+         * this object, otherwise the object stores a copy of the key.
+         * @param value The value to move into a new node of the map.
+         */
+        void insert_attribute(std::string_view key, bool borrowed, JsonBase &&value) {
+          insert_attribute(JsonKey(key),borrowed,allocator_.template create<JsonBase>(std::move(value)));
+        }
+
+        /**
+         * @brief Moves the value into a new attribute with an already hashed
+         * key, used for interned keys.
+         */
+        void insert_attribute(JsonKey key, bool borrowed, JsonBase &&value) {
+          insert_attribute(key,borrowed,allocator_.template create<JsonBase>(std::move(value)));
+        }
+
+        /**
+         * @brief Returns the Json associated with the given key, if the key
+         * does not exist returns nullptr
+         *
+         * @param key The key to look for inside the map
+         * @param err The error will get filled when accessing an element that
+         * does not exist with JsonError::does_not_exist
+         *
+         * @return The Json object if found or nullptr otherwise
+         */
+        JsonBase* get(const std::string &key, JsonError &err) override {
+          return get(JsonKey(key),err);
+        }
+
+        /**
+         * @brief Returns the Json associated with the key like
+         * get(const std::string&, JsonError&) without copying the key.
+         */
+        JsonBase* get(std::string_view key, JsonError &err) {
+          return get(JsonKey(key),err);
+        }
+
+        /**
+         * @brief Returns the Json associated with the already hashed key or
+         * nullptr, an interned key is compared by pointer.
+         */
+        JsonBase* get(const JsonKey &key, JsonError &err) {
+          auto fnd = traits_.find(key);
+          if (fnd == traits_.end()) {
+            err = JsonError::does_not_exist;
+            return nullptr;
+          }
+          return fnd->second.value;
+        }
+
+        /**
+         * @brief Converts the json object into a string and returns the string
+         *
+         * @return 
+         */
+        std::string dump() override {
+          return this->dump_string();
+        }
+
+        /**
+         * @brief Writes the json object into the sink, the attributes are
+         * written directly after each other without temporary strings.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.put('{');
+          bool first = true;
+          for (const auto &it : traits_) {
+            if (!first)
+              sink.put(',');
+            first = false;
+            sink.put('"');
+            json_escape(it.first.view,sink);
+            sink.append("\":",2);
+            it.second.value->write(sink);
+          }
+          sink.put('}');
+        }
+
+        /**
+         * @brief Sums the estimates of all attributes.
+         *
+         * @return The estimated length of the dump.
+         */
+        std::size_t dump_size_estimate() override {
+          std::size_t size = 2;
+          for (const auto &it : traits_)
+            size += it.first.view.size() + 4 + it.second.value->size_estimate();
+          return size;
+        }
+
+        /**
+         * @brief Calls func(key,value) for every attribute without copying
+         * the keys.
+         */
+        template<typename Func>
+        void for_each_attribute(Func &&func) {
+          for (const auto &it : traits_)
+            func(it.first.view,*it.second.value);
+        }
+
+        /**
+         * @brief Copies the attributes, the values stay shared.
+         */
+        JsonInterface *clone(json_allocator &alloc) override {
+          auto copy = alloc.template create<JsonImplHashObject>(alloc);
+          copy->traits_.reserve(traits_.size());
+          for (const auto &it : traits_)
+            copy->insert_attribute(it.first,!it.second.owns_key,copy->allocator_.template create<JsonBase>(copy->allocator_.child(),*it.second.value));
+          return copy;
+        }
+
+        /**
+         * @brief Cleans up the accquired memory will delete all pointers given
+         * to this class in the method insert(...)
+         */
+        ~JsonImplHashObject() {
+          for(const auto &it : traits_) {
+            allocator_.destroy(it.second.value);
+            if (it.second.owns_key)
+              allocator_.template stl<char>().deallocate(const_cast<char*>(it.first.view.data()),it.first.view.size());
+          }
+        }
+      private:
+        /**
+         * @brief The value stored for every key.
+         */
+        struct Attribute {
+          JsonBase *value;  ///< The json stored under the key
+          bool owns_key;    ///< True if the key memory was allocated by this object
+        };
+
+        json_allocator allocator_;  ///< The allocator of the inserted attributes
+        std::unordered_map<JsonKey, Attribute, JsonKeyHash, std::equal_to<JsonKey>, stl_allocator<std::pair<const JsonKey, Attribute>>> traits_; ///< Saves the attribute, Value pair of a json object, the keys are unescaped and hashed once
+    };
+
+    /**
+     * @brief The implementation of a json object selected by
+     * JsonFlatObjectStorage. Keys and values are stored next to each other in
+     * insertion order, small objects are searched linearly and larger ones
+     * through a hash index built on demand.
+     */
+    class JsonImplFlatObject final : public JsonInterface {
+      public:
+        /**
+         * @brief Creates an empty json object, the attributes are allocated
+         * with the given allocator.
+         *
+         * @param alloc The allocator of the node owning this object.
+         */
+        JsonImplFlatObject(json_allocator &alloc) : allocator_(alloc.child()), attributes_(alloc.template stl<JsonFlatAttribute<JsonBase>>()), index_(nullptr) {
+        }
+
+        /**
+         * @brief Returns the type of the Implementation, is always
+         * JsonType::object for this class
+         *
+         * @return Returns JsonType::object.
+         */
+        JsonType type() override {
+          return JsonType::object;
+        }
+
+        /**
+         * @brief Returns the number of stored attributes.
+         *
+         * @return Returns the number of stored attributes.
+         */
+        int size() override {
+          return attributes_.size();
+        }
+
+        /**
+         * @brief Inserts a new attribute with the given key, if the key exists
+         * the stored value is overwritten and keeps its position.
+         *
+         * @param key The key to insert/overrwrite.
+         * @param new_insert The value is moved into the object and the node
+         * itself released.
+         * @param err Set to JsonError::empty_attribute_key if the key is empty.
+         */
+        void insert(const std::string &key, JsonBase *new_insert, JsonError &err) override {
+          if (key=="")
+            err = JsonError::empty_attribute_key;
+          else {
+            insert_attribute(key,false,std::move(*new_insert));
+            allocator_.destroy(new_insert);
+          }
+        }
+
+        /**
+         * @brief Inserts the value as new attribute without checking the key,
+         * used by the parser.
+         *
+         * @param key The key to insert/overwrite.
+         * @param borrowed If true the key is referenced as is and must outlive
+         * this object, otherwise the object stores a copy of the key.
+         * @param value The value to move into the object.
+         */
+        void insert_attribute(std::string_view key, bool borrowed, JsonBase &&value) {
+          // Small objects are searched linearly and never need the hash.
+          if (index_)
+            insert_attribute(JsonKey(key),borrowed,std::move(value));
+          else
+            append(find_linear(key),key,borrowed,std::move(value),nullptr);
+        }
+
+        /**
+         * @brief Inserts the value with an already hashed key, used for
+         * interned keys.
+         */
+        void insert_attribute(JsonKey key, bool borrowed, JsonBase &&value) {
+          append(find(key),key.view,borrowed,std::move(value),&key.hash);
+        }
+
+        /**
+         * @brief Returns the Json associated with the given key.
+         *
+         * @param key The key to look for.
+         * @param err Set to JsonError::does_not_exist if there is no such key.
+         *
+         * @return The Json object if found or nullptr otherwise, the pointer is
+         * valid until the next insertion.
+         */
+        JsonBase* get(const std::string &key, JsonError &err) override {
+          return get(std::string_view(key),err);
+        }
+
+        /**
+         * @brief Returns the Json associated with the key like
+         * get(const std::string&, JsonError&) without copying the key.
+         */
+        JsonBase* get(std::string_view key, JsonError &err) {
+          std::size_t pos = index_ ? find(JsonKey(key)) : find_linear(key);
+          return at(pos,err);
+        }
+
+        /**
+         * @brief Returns the Json associated with the already hashed key or
+         * nullptr, an interned key is compared by pointer.
+         */
+        JsonBase* get(const JsonKey &key, JsonError &err) {
+          return at(find(key),err);
+        }
+
+        /**
+         * @brief Converts the json object into a string and returns the string
+         *
+         * @return The json object in string format.
+         */
+        std::string dump() override {
+          return this->dump_string();
+        }
+
+        /**
+         * @brief Writes the attributes in insertion order into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.put('{');
+          bool first = true;
+          for (auto &it : attributes_) {
+            if (!first)
+              sink.put(',');
+            first = false;
+            sink.put('"');
+            json_escape(it.key,sink);
+            sink.append("\":",2);
+            it.value.write(sink);
+          }
+          sink.put('}');
+        }
+
+        /**
+         * @brief Sums the estimates of all attributes.
+         *
+         * @return The estimated length of the dump.
+         */
+        std::size_t dump_size_estimate() override {
+          std::size_t size = 2;
+          for (auto &it : attributes_)
+            size += it.key.size() + 4 + it.value.size_estimate();
+          return size;
+        }
+
+        /**
+         * @brief Calls func(key,value) for every attribute in insertion order
+         * without copying the keys.
+         */
+        template<typename Func>
+        void for_each_attribute(Func &&func) {
+          for (auto &it : attributes_)
+            func(it.key,it.value);
+        }
+
+        /**
+         * @brief Copies the attributes, the values stay shared.
+         */
+        JsonInterface *clone(json_allocator &alloc) override {
+          auto copy = alloc.template create<JsonImplFlatObject>(alloc);
+          copy->copy_attributes(*this);
+          return copy;
+        }
+
+        /**
+         * @brief Appends copies of the attributes of other like clone(...).
+         */
+        void copy_attributes(JsonImplFlatObject &other) {
+          attributes_.reserve(attributes_.size() + other.attributes_.size());
+          for (auto &it : other.attributes_)
+            append(attributes_.size(),it.key,!it.owns_key,JsonBase(allocator_.child(),it.value),nullptr);
+        }
+
+        /**
+         * @brief Returns the key of the attribute at pos in insertion order.
+         */
+        std::string_view key_at(std::size_t pos) const {
+          return attributes_[pos].key;
+        }
+
+        /**
+         * @brief Moves the values in insertion order to the end of out and
+         * removes all attributes.
+         */
+        template<typename Vector>
+        void move_values(Vector &out) {
+          out.reserve(out.size() + attributes_.size());
+          for (auto &it : attributes_)
+            out.push_back(std::move(it.value));
+          clear();
+        }
+
+        /**
+         * @brief Releases the copied keys and the index, the values are
+         * released by the vector.
+         */
+        ~JsonImplFlatObject() {
+          clear();
+        }
+      private:
+        /**
+         * @brief Removes all attributes and releases the copied keys and the
+         * index.
+         */
+        void clear() {
+          for(auto &it : attributes_) {
+            if (it.owns_key)
+              allocator_.template stl<char>().deallocate(const_cast<char*>(it.key.data()),it.key.size());
+          }
+          attributes_.clear();
+          if (index_)
+            allocator_.destroy(index_);
+          index_ = nullptr;
+        }
+
+        using Index = std::unordered_map<JsonKey, std::size_t, JsonKeyHash, std::equal_to<JsonKey>, stl_allocator<std::pair<const JsonKey, std::size_t>>>;  ///< Maps every key to its position
+
+        /**
+         * @brief Returns the position of the key or the number of attributes if
+         * the key does not exist.
+         */
+        std::size_t find(const JsonKey &key) {
+          if (index_) {
+            auto fnd = index_->find(key);
+            return fnd == index_->end() ? attributes_.size() : fnd->second;
+          }
+          return find_linear(key.view);
+        }
+
+        /**
+         * @brief Searches the attributes one after another, interned keys
+         * match by pointer first.
+         */
+        std::size_t find_linear(std::string_view key) {
+          for (std::size_t i = 0; i < attributes_.size(); i++) {
+            std::string_view stored = attributes_[i].key;
+            if (stored.size() == key.size() && (stored.data() == key.data() || stored == key))
+              return i;
+          }
+          return attributes_.size();
+        }
+
+        /**
+         * @brief Replaces the value at pos or appends a new attribute if pos is
+         * the number of attributes.
+         *
+         * @param hash The hash of the key or nullptr if it is not computed
+         * yet, only needed once the object has an index.
+         */
+        void append(std::size_t pos, std::string_view key, bool borrowed, JsonBase &&value, const std::size_t *hash) {
+          if (pos != attributes_.size()) {
+            attributes_[pos].value = std::move(value);
+            return;
+          }
+
+          if (!borrowed) {
+            char *copy = allocator_.template stl<char>().allocate(key.size());
+            key.copy(copy,key.size());
+            key = std::string_view(copy,key.size());
+          }
+          attributes_.push_back(JsonFlatAttribute<JsonBase>{key,std::move(value),!borrowed});
+          if (index_)
+            index_->emplace(hash ? JsonKey(key,*hash) : JsonKey(key),pos);
+          else if (attributes_.size() > JsonFlatObjectStorage::index_threshold)
+            build_index();
+        }
+
+        /**
+         * @brief Returns the value at pos or sets JsonError::does_not_exist
+         * if pos is the number of attributes.
+         */
+        JsonBase *at(std::size_t pos, JsonError &err) {
+          if (pos == attributes_.size()) {
+            err = JsonError::does_not_exist;
+            return nullptr;
+          }
+          return &attributes_[pos].value;
+        }
+
+        /**
+         * @brief Indexes all attributes, called once the object grows beyond
+         * JsonFlatObjectStorage::index_threshold.
+         */
+        void build_index() {
+          index_ = allocator_.template create<Index>(attributes_.size()*2, JsonKeyHash(), std::equal_to<JsonKey>(), allocator_.template stl<std::pair<const JsonKey, std::size_t>>());
+          for (std::size_t i = 0; i < attributes_.size(); i++)
+            index_->emplace(JsonKey(attributes_[i].key),i);
+        }
+
+        json_allocator allocator_;  ///< The allocator of the keys and the index
+        std::vector<JsonFlatAttribute<JsonBase>, stl_allocator<JsonFlatAttribute<JsonBase>>> attributes_;  ///< The attributes in insertion order, the keys are unescaped
+        Index *index_;              ///< The positions of all keys or nullptr while the object is small
+    };
+
+    /**
+     * @brief The implementation of a json object selected by
+     * JsonShapedObjectStorage. Objects store their attributes in a
+     * JsonImplFlatObject until share_keys() or use_shape(...) moves the keys
+     * into a JsonShape shared with all objects having the same key sequence,
+     * the object then only holds the values in the same order. A new key
+     * moves the attributes back into the JsonImplFlatObject.
+     */
+    class JsonImplShapedObject final : public JsonInterface {
+      public:
+        /**
+         * @brief Creates an empty json object which stores its keys, the
+         * values are allocated with the given allocator.
+         *
+         * @param alloc The allocator of the node owning this object.
+         */
+        JsonImplShapedObject(json_allocator &alloc) : allocator_(alloc.child()), shape_(nullptr), values_(alloc.template stl<JsonBase>()), flat_(alloc) {
+        }
+
+        /**
+         * @brief Returns the type of the Implementation, is always
+         * JsonType::object for this class
+         *
+         * @return Returns JsonType::object.
+         */
+        JsonType type() override {
+          return JsonType::object;
+        }
+
+        /**
+         * @brief Returns the number of stored attributes.
+         *
+         * @return Returns the number of stored attributes.
+         */
+        int size() override {
+          return shape_ ? values_.size() : flat_.size();
+        }
+
+        /**
+         * @brief Inserts a new attribute with the given key, if the key exists
+         * the stored value is overwritten and keeps its position.
+         *
+         * @param key The key to insert/overrwrite.
+         * @param new_insert The value is moved into the object and the node
+         * itself released.
+         * @param err Set to JsonError::empty_attribute_key if the key is empty.
+         */
+        void insert(const std::string &key, JsonBase *new_insert, JsonError &err) override {
+          if (key=="")
+            err = JsonError::empty_attribute_key;
+          else {
+            insert_attribute(JsonKey(key),false,std::move(*new_insert));
+            allocator_.destroy(new_insert);
+          }
+        }
+
+        /**
+         * @brief Inserts the value as new attribute without checking the key,
+         * used by the parser.
+         *
+         * @param key The key to insert/overwrite.
+         * @param borrowed If true the key is referenced as is while the
+         * object stores its keys and must outlive this object.
+         * @param value The value to move into the object.
+         */
+        void insert_attribute(std::string_view key, bool borrowed, JsonBase &&value) {
+          if (!shape_)
+            flat_.insert_attribute(key,borrowed,std::move(value));
+          // The next key of an expected shape is appended without hashing.
+          else if (values_.size() < shape_->size() && shape_->key(values_.size()).view == key)
+            values_.push_back(std::move(value));
+          else
+            insert_attribute(JsonKey(key),borrowed,std::move(value));
+        }
+
+        /**
+         * @brief Inserts the value with an already hashed key, used for
+         * interned keys.
+         */
+        void insert_attribute(JsonKey key, bool borrowed, JsonBase &&value) {
+          if (!shape_) {
+            flat_.insert_attribute(key,borrowed,std::move(value));
+            return;
+          }
+          std::size_t pos = values_.size() < shape_->size() && shape_->key(values_.size()) == key ? values_.size() : shape_->find(key);
+          if (pos < values_.size())
+            values_[pos] = std::move(value);
+          else if (pos == values_.size() && pos < shape_->size())
+            values_.push_back(std::move(value));
+          else {
+            store_keys();
+            flat_.insert_attribute(key,borrowed,std::move(value));
+          }
+        }
+
+        /**
+         * @brief Returns the Json associated with the given key.
+         *
+         * @param key The key to look for.
+         * @param err Set to JsonError::does_not_exist if there is no such key.
+         *
+         * @return The Json object if found or nullptr otherwise, the pointer is
+         * valid until the next insertion.
+         */
+        JsonBase* get(const std::string &key, JsonError &err) override {
+          return get(std::string_view(key),err);
+        }
+
+        /**
+         * @brief Returns the Json associated with the key like
+         * get(const std::string&, JsonError&) without copying the key.
+         */
+        JsonBase* get(std::string_view key, JsonError &err) {
+          if (!shape_)
+            return flat_.get(key,err);
+          return at(shape_->find(key),err);
+        }
+
+        /**
+         * @brief Returns the Json associated with the already hashed key or
+         * nullptr.
+         */
+        JsonBase* get(const JsonKey &key, JsonError &err) {
+          if (!shape_)
+            return flat_.get(key,err);
+          return at(shape_->find(key),err);
+        }
+
+        /**
+         * @brief Returns the Json associated with the key, the position is
+         * only searched if the key was last used with a different shape.
+         */
+        JsonBase* get(JsonCachedKey &key, JsonError &err) {
+          if (!shape_)
+            return flat_.get(key.key(),err);
+          return at(key.find(shape_),err);
+        }
+
+        /**
+         * @brief Converts the json object into a string and returns the string
+         *
+         * @return The json object in string format.
+         */
+        std::string dump() override {
+          return this->dump_string();
+        }
+
+        /**
+         * @brief Writes the attributes in insertion order into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          if (!shape_) {
+            flat_.dump_to(sink);
+            return;
+          }
+          sink.put('{');
+          for (std::size_t i = 0; i < values_.size(); i++) {
+            if (i)
+              sink.put(',');
+            sink.put('"');
+            json_escape(shape_->key(i).view,sink);
+            sink.append("\":",2);
+            values_[i].write(sink);
+          }
+          sink.put('}');
+        }
+
+        /**
+         * @brief Sums the estimates of all attributes.
+         *
+         * @return The estimated length of the dump.
+         */
+        std::size_t dump_size_estimate() override {
+          if (!shape_)
+            return flat_.dump_size_estimate();
+          std::size_t size = 2;
+          for (std::size_t i = 0; i < values_.size(); i++)
+            size += shape_->key(i).view.size() + 4 + values_[i].size_estimate();
+          return size;
+        }
+
+        /**
+         * @brief Calls func(key,value) for every attribute in insertion order
+         * without copying the keys.
+         */
+        template<typename Func>
+        void for_each_attribute(Func &&func) {
+          if (!shape_) {
+            flat_.for_each_attribute(std::forward<Func>(func));
+            return;
+          }
+          for (std::size_t i = 0; i < values_.size(); i++)
+            func(shape_->key(i).view,values_[i]);
+        }
+
+        /**
+         * @brief Shares the shape and copies the values, which stay shared.
+         */
+        JsonInterface *clone(json_allocator &alloc) override {
+          auto copy = alloc.template create<JsonImplShapedObject>(alloc);
+          if (!shape_) {
+            copy->flat_.copy_attributes(flat_);
+            return copy;
+          }
+          shape_->acquire();
+          copy->shape_ = shape_;
+          copy->values_.reserve(values_.size());
+          for (auto &it : values_)
+            copy->values_.emplace_back(copy->allocator_.child(),it);
+          return copy;
+        }
+
+        /**
+         * @brief Releases the shape, the values are released by the vector.
+         */
+        ~JsonImplShapedObject() {
+          if (shape_)
+            shape_->release();
+        }
+
+        /**
+         * @brief Returns the shared shape or nullptr if the object stores its
+         * keys.
+         */
+        JsonShape *shape() const {
+          return shape_;
+        }
+
+        /**
+         * @brief Moves the keys of an object which stores them into a shared
+         * shape, called for the first of several objects with the same keys.
+         *
+         * @return The shape or nullptr if the object is empty, already shared
+         * or has more than JsonShapedObjectStorage::max_shape_keys attributes.
+         */
+        JsonShape *share_keys() {
+          std::size_t count = flat_.size();
+          if (shape_ || count == 0 || count > JsonShapedObjectStorage::max_shape_keys)
+            return nullptr;
+          shape_ = JsonShape::intern(count,[this](std::size_t i){return flat_.key_at(i);});
+          flat_.move_values(values_);
+          return shape_;
+        }
+
+        /**
+         * @brief Shares the shape if the object stores exactly its keys in
+         * the same order.
+         *
+         * @return True if the object uses the shape from now on.
+         */
+        bool use_shape(JsonShape *shape) {
+          if (shape_ || (std::size_t)flat_.size() != shape->size())
+            return false;
+          for (std::size_t i = 0; i < shape->size(); i++) {
+            if (flat_.key_at(i) != shape->key(i).view)
+              return false;
+          }
+          shape->acquire();
+          shape_ = shape;
+          flat_.move_values(values_);
+          return true;
+        }
+
+        /**
+         * @brief Returns true if both objects store their keys and these are
+         * the same in the same order.
+         */
+        bool same_keys(JsonImplShapedObject &other) {
+          if (shape_ || other.shape_ || flat_.size() != other.flat_.size())
+            return false;
+          for (int i = 0; i < flat_.size(); i++) {
+            if (flat_.key_at(i) != other.flat_.key_at(i))
+              return false;
+          }
+          return true;
+        }
+
+        /**
+         * @brief Lets an empty object expect the keys of the shape, matching
+         * keys are then inserted without storing them. Any other key and
+         * finish() store the keys again, unless all keys arrived.
+         */
+        void expect(JsonShape *shape) {
+          if (shape_ || flat_.size() != 0)
+            return;
+          shape->acquire();
+          shape_ = shape;
+        }
+
+        /**
+         * @brief Stores the keys again if the object did not get all keys it
+         * expected.
+         */
+        void finish() {
+          if (shape_ && values_.size() != shape_->size())
+            store_keys();
+        }
+
+      private:
+        /**
+         * @brief Returns the value at pos or sets JsonError::does_not_exist
+         * if the shape does not hold a value at pos.
+         */
+        JsonBase *at(std::size_t pos, JsonError &err) {
+          if (pos >= values_.size()) {
+            err = JsonError::does_not_exist;
+            return nullptr;
+          }
+          return &values_[pos];
+        }
+
+        /**
+         * @brief Moves all attributes into the JsonImplFlatObject, which is
+         * used from now on. The keys are copied as the shape is released.
+         */
+        void store_keys() {
+          for (std::size_t i = 0; i < values_.size(); i++)
+            flat_.insert_attribute(shape_->key(i),false,std::move(values_[i]));
+          values_.clear();
+          shape_->release();
+          shape_ = nullptr;
+        }
+
+        json_allocator allocator_;  ///< The allocator of the values
+        JsonShape *shape_;          ///< The keys of the values or nullptr while flat_ holds the attributes
+        std::vector<JsonBase, stl_allocator<JsonBase>> values_;  ///< The values in the order of the keys of the shape
+        JsonImplFlatObject flat_;   ///< Holds all attributes while the object stores its keys
+    };
+
+    /**
+     * @brief Gives the objects of an array which is being built one shared
+     * JsonShape as soon as two consecutive objects have the same keys in the
+     * same order. The following objects expect these keys, objects with
+     * other keys keep storing them. Only used with JsonShapedObjectStorage.
+     */
+    struct JsonShapeSharing {
+      JsonImplShapedObject *previous = nullptr;  ///< The last object added to the array
+      JsonShape *shape = nullptr;                ///< The shape of the last objects with the same keys, kept alive by them
+
+      /**
+       * @brief Called for an object of the array before its attributes are
+       * inserted.
+       */
+      void start(JsonImplShapedObject *object) {
+        if (shape)
+          object->expect(shape);
+      }
+
+      /**
+       * @brief Called for an object of the array after all its attributes
+       * are inserted.
+       */
+      void end(JsonImplShapedObject *object) {
+        object->finish();
+        if (!object->shape() && !(shape && object->use_shape(shape)) && previous && object->same_keys(*previous)) {
+          if (JsonShape *shared = previous->share_keys()) {
+            object->use_shape(shared);
+            shape = shared;
+          }
+        }
+        previous = object;
+      }
+    };
+
+    /**
+     * @brief The json object implementation chosen by the object_storage
+     * template parameter.
+     */
+    using JsonImplObject = typename std::conditional<std::is_same<object_storage, JsonFlatObjectStorage>::value, JsonImplFlatObject,
+                           typename std::conditional<std::is_same<object_storage, JsonShapedObjectStorage>::value, JsonImplShapedObject, JsonImplHashObject>::type>::type;
+
+    /**
+     * @brief The basic implementation of a json string
+     */
+    class JsonImplString : public JsonInterface  {
+      public:
+        /**
+         * @brief Initialises the string from a given string
+         *
+         * @param initialise_value The string to initialise the value with
+         */
+        JsonImplString(string_type initialise_value) : content_(std::move(initialise_value)) {
+        }
+
+        /**
+         * @brief Returns JsonType::string as type.
+         *
+         * @return Return always JsonType::string
+         */
+        JsonType type() override {
+          return JsonType::string;
+        }
+
+        /**
+         * @brief Returns the size of the container, as this is an primitive
+         * type always return 1.
+         *
+         * @return Returns always 1
+         */
+        int size() override {
+          return 1;
+        }
+
+        /**
+         * @brief Converts the underlying string into a json string
+         *
+         * @return Return the string representation of a json string
+         */
+        std::string dump() override {
+          return this->dump_string();
+        }
+
+        /**
+         * @brief Writes the escaped string into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.put('"');
+          json_escape(std::string_view(content_.data(),content_.size()),sink);
+          sink.put('"');
+        }
+
+        /**
+         * @brief Returns the length of the string without escapes.
+         */
+        std::size_t dump_size_estimate() override {
+          return content_.size() + 2;
+        }
+
+        /**
+         * @brief Returns a copy to the saved string
+         *
+         * @param err Always leave err untouched
+         *
+         * @return Returns always the saved string 
+         */
+        std::string to_string(JsonError &err) override {
+          return std::string(content_.data(),content_.size());
+        }
+
+        /**
+         * @brief Returns a view of the saved string.
+         */
+        bool to_string_view(std::string_view &out) override {
+          out = std::string_view(content_.data(),content_.size());
+          return true;
+        }
+
+        /**
+         * @brief Copies the string into the given allocator.
+         */
+        JsonInterface *clone(json_allocator &alloc) override {
+          return alloc.template create<JsonImplString>(string_type(content_.begin(),content_.end(),alloc.template stl<char>()));
+        }
+
+      private:
+        string_type content_; ///< Saves the content of the json string
+    };
+
+    /**
+     * @brief A json string which references the escaped string inside the
+     * parsed buffer instead of copying it. The buffer must outlive the json.
+     * Escape sequences are only resolved when the string is accessed.
+     */
+    class JsonImplBorrowedString : public JsonInterface  {
+      public:
+        /**
+         * @brief Initialises the string from the raw string inside the json
+         *
+         * @param raw The characters between the quotes, still escaped
+         * @param has_escapes True if raw contains at least one backslash
+         */
+        JsonImplBorrowedString(std::string_view raw, bool has_escapes) : raw_(raw), has_escapes_(has_escapes) {
+        }
+
+        /**
+         * @brief Returns JsonType::string as type.
+         *
+         * @return Return always JsonType::string
+         */
+        JsonType type() override {
+          return JsonType::string;
+        }
+
+        /**
+         * @brief Returns the size of the container, as this is an primitive
+         * type always return 1.
+         *
+         * @return Returns always 1
+         */
+        int size() override {
+          return 1;
+        }
+
+        /**
+         * @brief The raw string is still escaped and can be written as is.
+         *
+         * @return Return the string representation of a json string
+         */
+        std::string dump() override {
+          return this->dump_string();
+        }
+
+        /**
+         * @brief Writes the raw string into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.put('"');
+          sink.append(raw_.data(),raw_.size());
+          sink.put('"');
+        }
+
+        /**
+         * @brief Returns the exact length of the dump.
+         */
+        std::size_t dump_size_estimate() override {
+          return raw_.size() + 2;
+        }
+
+        /**
+         * @brief Returns a copy of the string with all escape sequences
+         * resolved.
+         *
+         * @param err Always leave err untouched
+         *
+         * @return Returns always the unescaped string
+         */
+        std::string to_string(JsonError &) override {
+          if (!has_escapes_)
+            return std::string(raw_);
+          std::string ret;
+          json_unescape(raw_,ret);
+          return ret;
+        }
+
+        /**
+         * @brief Returns the borrowed characters if they need no unescaping.
+         */
+        bool to_string_view(std::string_view &out) override {
+          out = raw_;
+          return !has_escapes_;
+        }
+
+        /**
+         * @brief Copies the reference, the buffer must outlive the copy too.
+         */
+        JsonInterface *clone(json_allocator &alloc) override {
+          return alloc.template create<JsonImplBorrowedString>(raw_,has_escapes_);
+        }
+
+      private:
+        std::string_view raw_;  ///< The escaped string inside the parsed buffer
+        bool has_escapes_;      ///< True if raw_ must be unescaped on access
+    };
+
+
+    /**
+     * @brief The basic implementation of a json null value.
+     */
+    class JsonImplNull : public JsonInterface  {
+      public:
+        /**
+         * @brief Returns JsonType::string as type.
+         *
+         * @return Return always JsonType::string
+         */
+        JsonType type() override {
+          return JsonType::null;
+        }
+
+        /**
+         * @brief Returns the size of the container, as this is an primitive
+         * type always return 1.
+         *
+         * @return Returns always 1
+         */
+        int size() override {
+          return 1;
+        }
+
+        /**
+         * @brief Converts the underlying string into a json string
+         *
+         * @return Return the string representation of a json string
+         */
+        std::string dump() override {
+          return "null";
+        }
+
+        /**
+         * @brief Writes null into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.append("null",4);
+        }
+
+        JsonInterface *clone(json_allocator &alloc) override {
+          return alloc.template create<JsonImplNull>();
+        }
+
+        /**
+         * @brief Returns the exact length of the dump.
+         */
+        std::size_t dump_size_estimate() override {
+          return 4;
+        }
+    };
+
+
+    /**
+     * @brief The basic implementation of a json double value
+     */
+    class JsonImplDouble : public JsonInterface  {
+      public:
+        /**
+         * @brief Initialises the string from a given string
+         *
+         * @param initialise_value The string to initialise the value with
+         */
+        JsonImplDouble(double value) : value_(value) {
+        }
+
+        /**
+         * @brief Returns JsonType::string as type.
+         *
+         * @return Return always JsonType::string
+         */
+        JsonType type() override {
+          return JsonType::floating_point;
+        }
+
+        /**
+         * @brief Returns the size of the container, as this is an primitive
+         * type always return 1.
+         *
+         * @return Returns always 1
+         */
+        int size() override {
+          return 1;
+        }
+
+        /**
+         * @brief Converts the underlying string into a json string
+         *
+         * @return Return the string representation of a json string
+         */
+        std::string dump() override {
+          char buffer[32];
+          return std::string(buffer,json_format_double(value_,buffer));
+        }
+
+        /**
+         * @brief Formats the double directly into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.commit(json_format_double(value_,sink.reserve(32)));
+        }
+
+        /**
+         * @brief Returns the typical length of a formatted double.
+         */
+        std::size_t dump_size_estimate() override {
+          return 24;
+        }
+
+        /**
+         * @brief Returns the double value and never sets the error field.
+         *
+         * @param err Never sets the error field to anything
+         *
+         * @return Returns the saved double
+         */
+        double to_double(JsonError &err) {
+          return value_;
+        }
+
+        JsonInterface *clone(json_allocator &alloc) override {
+          return alloc.template create<JsonImplDouble>(value_);
+        }
+
+      private:
+        double value_; ///< Saves the content of the json string
+    };
+
+    /**
+     * @brief The basic implementation for a Json array, contains a list of
+     * other Json objects
+     */
+    class JsonImplArray final : public JsonInterface {
+      public:
+        /**
+         * @brief Creates an empty json array, the items are allocated with the
+         * given allocator.
+         *
+         * @param alloc The allocator of the node owning this array.
+         */
+        JsonImplArray(json_allocator &alloc) : allocator_(alloc.child()), vec_(alloc.template stl<JsonBase>()), numbers_(nullptr) {
+        }
+
+        JsonImplArray(const JsonImplArray &) = delete;
+        JsonImplArray &operator=(const JsonImplArray &) = delete;
+
+        /**
+         * @brief Copies the items, which stay shared, and the packed numbers.
+         */
+        JsonInterface *clone(json_allocator &alloc) override {
+          auto copy = alloc.template create<JsonImplArray>(alloc);
+          if (numbers_) {
+            copy->numbers_ = copy->allocator_.template create<Numbers>(copy->allocator_,numbers_->is_float);
+            copy->numbers_->integers.assign(numbers_->integers.begin(),numbers_->integers.end());
+            copy->numbers_->floats.assign(numbers_->floats.begin(),numbers_->floats.end());
+            copy->numbers_->integer_items.assign(numbers_->integer_items.begin(),numbers_->integer_items.end());
+          }
+          copy->vec_.reserve(vec_.size());
+          for (auto &it : vec_)
+            copy->vec_.emplace_back(copy->allocator_.child(),it);
+          return copy;
+        }
+
+        /**
+         * @brief Releases the packed numbers, the items are released by the
+         * vector.
+         */
+        ~JsonImplArray() {
+          if (numbers_)
+            allocator_.destroy(numbers_);
+        }
+
+        /**
+         * @brief Returns the type JsonType::array.
+         *
+         * @return Always returns the type JsonType::array.
+         */
+        JsonType type() override {
+          return JsonType::array;
+        }
+
+        /**
+         * @brief Returns the size of the Json array which is always equivalent
+         * to the number of items contained.
+         *
+         * @return The size of the Json array
+         */
+        int size() override {
+          if (numbers_)
+            return numbers_->is_float ? numbers_->floats.size() : numbers_->integers.size();
+          return vec_.size();
+        }
+
+        /**
+         * @brief Inserts a new value inside the Json array, sets error to
+         * JsonError::not_implemented when a key is supplied!
+         *
+         * @param key The key must always be empty as this is not an Json object
+         * @param new_insert The inserted object can be any type, its value is
+         * moved into the array and the node itself released.
+         * @param err Leaves the error untouched if the key is empty, if there
+         * is a non empty key sets the error to JsonError::not_implemented
+         */
+        void insert(const std::string &key, JsonBase *new_insert, JsonError &err) override {
+          if (key != "") 
+            err = JsonError::not_implemented;
+          else {
+            push(std::move(*new_insert));
+            allocator_.destroy(new_insert);
+          }
+        }
+
+        /**
+         * @brief Appends the value to the array, this is actually a non
+         * derived function used by the parser. Numbers are packed as long as
+         * the array holds nothing else.
+         *
+         * @param value The value to move into the array.
+         */
+        void push(JsonBase &&value) {
+          if (vec_.empty() && pack(value))
+            return;
+          vec_.push_back(std::move(value));
+        }
+
+        /**
+         * @brief Returns the packed integers if the array only holds
+         * integers.
+         */
+        JsonSpan<const long long> packed_integers() const {
+          if (!numbers_ || numbers_->is_float)
+            return JsonSpan<const long long>();
+          return JsonSpan<const long long>(numbers_->integers.data(),numbers_->integers.size());
+        }
+
+        /**
+         * @brief Returns the packed numbers as double if the array holds
+         * floating point numbers and maybe integers.
+         */
+        JsonSpan<const double> packed_floats() const {
+          if (!numbers_ || !numbers_->is_float)
+            return JsonSpan<const double>();
+          return JsonSpan<const double>(numbers_->floats.data(),numbers_->floats.size());
+        }
+
+        /**
+         * @brief Returns true if the item at index of packed_floats() was an
+         * integer.
+         */
+        bool packed_is_integer(std::size_t index) const {
+          return numbers_ && numbers_->is_integer(index);
+        }
+
+        /**
+         * @brief Reserves memory for the given number of items.
+         *
+         * @param size The number of items the array will hold.
+         */
+        void reserve(std::size_t size) {
+          vec_.reserve(size);
+        }
+
+        /**
+         * @brief Returns the json at the given index without a virtual call,
+         * does not perform any boundary checking!! The item may be changed
+         * through the reference, so packed numbers are unpacked, value(...)
+         * reads them in place.
+         *
+         * @param index The index of the item.
+         *
+         * @return The item at the given index, the reference is valid until
+         * the next insertion.
+         */
+        JsonBase &at(int index) {
+          unpack();
+          return vec_[index];
+        }
+
+        /**
+         * @brief Returns the item at the given index without unpacking, only
+         * valid for arrays whose numbers are not packed. Does not perform any
+         * boundary checking!!
+         *
+         * @param index The index of the item.
+         */
+        const JsonBase &item(int index) const {
+          return vec_[index];
+        }
+
+        /**
+         * @brief Returns a copy of the item at the given index without
+         * unpacking, packed numbers are materialized from their buffer and
+         * other items are copied like JsonBase(const JsonBase&). Does not
+         * perform any boundary checking!!
+         *
+         * @param index The index of the item.
+         */
+        JsonBase value(int index) const {
+          if (!numbers_)
+            return JsonBase(vec_[index]);
+          if (!numbers_->is_float)
+            return JsonBase(numbers_->integers[index]);
+          if (numbers_->is_integer(index))
+            return JsonBase((long long)numbers_->floats[index]);
+          return JsonBase(numbers_->floats[index]);
+        }
+
+        /**
+         * @brief Returns the json object at the given index, does not perform
+         * any boundary checking!! Unpacks packed numbers like at(...).
+         *
+         * @param index Accesses the index at the given position.
+         * @param err Never sets the error to any value
+         *
+         * @return Returns the Json object at the given index
+         */
+        JsonBase* get(const int index, JsonError &err) override {
+          unpack();
+          return &vec_[index];
+        }
+
+        /**
+         * @brief Returns the array converted to a string, also converts all
+         * objects in the array to a string 
+         *
+         * @return Creates a string out of the given Json array 
+         */
+        std::string dump() override {
+          return this->dump_string();
+        }
+
+        /**
+         * @brief Writes the array into the sink, every member writes itself
+         * directly behind the previous one.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.put('[');
+          if (numbers_) {
+            for (int i = 0; i < size(); i++) {
+              if (i)
+                sink.put(',');
+              if (!numbers_->is_float)
+                sink.commit(json_format_integer(numbers_->integers[i],sink.reserve(20)));
+              else if (numbers_->is_integer(i))
+                sink.commit(json_format_integer((long long)numbers_->floats[i],sink.reserve(20)));
+              else
+                sink.commit(json_format_double(numbers_->floats[i],sink.reserve(32)));
+            }
+          }
+          bool first = true;
+          for (auto &it : vec_) {
+            if (!first)
+              sink.put(',');
+            first = false;
+            it.write(sink);
+          }
+          sink.put(']');
+        }
+
+        /**
+         * @brief Sums the estimates of all members.
+         *
+         * @return The estimated length of the dump.
+         */
+        std::size_t dump_size_estimate() override {
+          std::size_t size = 2;
+          if (numbers_ && !numbers_->is_float) {
+            for (long long value : numbers_->integers)
+              size += 1 + json_integer_length(value);
+          }
+          else if (numbers_)
+            size += 25 * numbers_->floats.size();
+          for (auto &it : vec_)
+            size += 1 + it.size_estimate();
+          return size;
+        }
+
+      private:
+        /**
+         * @brief The items of an array holding only numbers. Integers are
+         * kept as they are until the first floating point number, then all
+         * items are stored as double and the integers are marked.
+         */
+        struct Numbers {
+          Numbers(json_allocator &alloc, bool floating) : is_float(floating), integers(alloc.template stl<long long>()), floats(alloc.template stl<double>()), integer_items(alloc.template stl<bool>()) {
+          }
+
+          /**
+           * @brief Returns true if the item at index was parsed as integer.
+           */
+          bool is_integer(std::size_t index) const {
+            return index < integer_items.size() && integer_items[index];
+          }
+
+          bool is_float;  ///< True if the items are stored in floats
+          std::vector<long long, stl_allocator<long long>> integers;  ///< The items as long as they are all integers
+          std::vector<double, stl_allocator<double>> floats;          ///< The items once there is a floating point number
+          std::vector<bool, stl_allocator<bool>> integer_items;       ///< For every item in floats true if it was an integer, empty if there are none
+        };
+
+        /**
+         * @brief Integers up to this magnitude are stored exactly as double.
+         */
+        static constexpr long long max_exact_double = 1ll << 53;
+
+        /**
+         * @brief Appends the number to the packed numbers. Returns false and
+         * switches to the generic items if the value is no number or an
+         * integer which can not be stored as double.
+         */
+        bool pack(JsonBase &value) {
+          bool floating = value.storage_ == Storage::floating;
+          if (!floating && value.storage_ != Storage::integer) {
+            unpack();
+            return false;
+          }
+          if (!numbers_)
+            numbers_ = allocator_.template create<Numbers>(allocator_,floating);
+          if (!numbers_->is_float && !floating) {
+            numbers_->integers.push_back(value.integer_);
+            return true;
+          }
+          if (!numbers_->is_float) {
+            // The first floating point number, convert the integers.
+            for (long long item : numbers_->integers) {
+              if (item > max_exact_double || item < -max_exact_double) {
+                unpack();
+                return false;
+              }
+            }
+            numbers_->floats.reserve(numbers_->integers.size() + 1);
+            for (long long item : numbers_->integers)
+              numbers_->floats.push_back((double)item);
+            numbers_->integer_items.assign(numbers_->integers.size(),true);
+            numbers_->integers = std::vector<long long, stl_allocator<long long>>(allocator_.template stl<long long>());
+            numbers_->is_float = true;
+          }
+          if (floating) {
+            numbers_->floats.push_back(value.floating_);
+            if (!numbers_->integer_items.empty())
+              numbers_->integer_items.push_back(false);
+            return true;
+          }
+          if (value.integer_ > max_exact_double || value.integer_ < -max_exact_double) {
+            unpack();
+            return false;
+          }
+          if (numbers_->integer_items.empty())
+            numbers_->integer_items.assign(numbers_->floats.size(),false);
+          numbers_->floats.push_back((double)value.integer_);
+          numbers_->integer_items.push_back(true);
+          return true;
+        }
+
+        /**
+         * @brief Moves the packed numbers into generic items, called before
+         * an item is accessed by reference or the array stops holding only
+         * numbers.
+         */
+        void unpack() {
+          if (!numbers_)
+            return;
+          std::size_t count = size();
+          vec_.reserve(count);
+          for (std::size_t i = 0; i < count; i++) {
+            if (!numbers_->is_float)
+              vec_.emplace_back(allocator_.child(),numbers_->integers[i]);
+            else if (numbers_->is_integer(i))
+              vec_.emplace_back(allocator_.child(),(long long)numbers_->floats[i]);
+            else
+              vec_.emplace_back(allocator_.child(),numbers_->floats[i]);
+          }
+          allocator_.destroy(numbers_);
+          numbers_ = nullptr;
+        }
+
+        json_allocator allocator_;  ///< The allocator of the inserted items
+        std::vector<JsonBase, stl_allocator<JsonBase>> vec_; ///< Saves all the different jsons inside the list next to each other
+        Numbers *numbers_;          ///< The packed items while the array only holds numbers, vec_ is empty then
+    };
+
+    /**
+     * @brief Represents a simple json integer.
+     */
+  class JsonImplInteger : public JsonInterface  {
+      public:
+        /**
+         * @brief Initialises the JsonInteger with the given value
+         *
+         * @param value The value to set the json integer to.
+         */
+        JsonImplInteger(long long value) : value_(value) {
+        }
+
+        /**
+         * @brief Return the type of integer back to the callee.
+         *
+         * @return Always return JsonType::integer
+         */
+        JsonType type() override {
+          return JsonType::integer;
+        }
+
+        /**
+         * @brief As this is an primitive type always return 1.
+         *
+         * @return Always returns 1
+         */
+        int size() override {
+          return 1;
+        }
+
+        /**
+         * @brief Converts the integer to a string.
+         *
+         * @return Returns the integer as an string.
+         */
+        std::string dump() override {
+          char buffer[20];
+          return std::string(buffer,json_format_integer(value_,buffer));
+        }
+
+        /**
+         * @brief Formats the integer directly into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          sink.commit(json_format_integer(value_,sink.reserve(20)));
+        }
+
+        /**
+         * @brief Counts the digits of the integer.
+         */
+        std::size_t dump_size_estimate() override {
+          return json_integer_length(value_);
+        }
+
+        /**
+         * @brief Returns the saved integer back to the callee, never sets the
+         * error field in this function.
+         *
+         * @param err Never sets the error.
+         *
+         * @return Returns the saved integer value.
+         */
+        long long to_int(JsonError &err) override {
+          return value_;
+        }
+
+        JsonInterface *clone(json_allocator &alloc) override {
+          return alloc.template create<JsonImplInteger>(value_);
+        }
+
+      private:
+        long long value_; ///< The saved integer value
+    };
+
+  /**
+   * @brief The basic implementation of a json boolean.
+   */
+    class JsonImplBoolean : public JsonInterface  {
+      public:
+        /**
+         * @brief Initialises the json boolean to the given value
+         *
+         * @param value The value to set the underlying boolean to.
+         */
+        JsonImplBoolean(bool value) : value_(value) {
+        }
+
+        /**
+         * @brief Returns the type of the Json Boolean.
+         *
+         * @return Always returns JsonType::boolean.
+         */
+        JsonType type() override {
+          return JsonType::boolean;
+        }
+
+        /**
+         * @brief As this is an primitive type always return 1.
+         *
+         * @return Always returns 1.
+         */
+        int size() override {
+          return 1;
+        }
+
+        /**
+         * @brief Converts the underlying boolean to a string
+         *
+         * @return Returns "true" or "false" depending on the underlying value
+         */
+        std::string dump() override {
+          if(value_)
+            return "true";
+          return "false";
+        }
+
+        /**
+         * @brief Writes true or false into the sink.
+         *
+         * @param sink The sink to write to.
+         */
+        void dump_to(JsonSink &sink) override {
+          if(value_)
+            sink.append("true",4);
+          else
+            sink.append("false",5);
+        }
+
+        /**
+         * @brief Returns the exact length of the dump.
+         */
+        std::size_t dump_size_estimate() override {
+          return value_ ? 4 : 5;
+        }
+        
+        /**
+         * @brief Returns the saved boolean value and never sets the error
+         * field.
+         *
+         * @param err Never sets the error field in this method.
+         *
+         * @return Returns the underlying boolean value
+         */
+        bool to_bool(JsonError &err) override {
+          return value_;
+        }
+
+        JsonInterface *clone(json_allocator &alloc) override {
+          return alloc.template create<JsonImplBoolean>(value_);
+        }
+      private:
+        bool value_;  ///< Returns the saved bool.
+    };
+
+
+    /**
+     * @brief Create the default JsonBase, the default json is always an json
+     * object
+     */
+    JsonBase() : JsonBase(json_allocator()) {
+    }
+
+    /**
+     * @brief Create the default JsonBase which allocates its nodes with the
+     * given allocator, the default json is always an json object
+     *
+     * @param alloc The allocator to create the object and all children with.
+     */
+    JsonBase(json_allocator alloc) : storage_(Storage::object), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+      interface_ = allocator_.template create<JsonImplObject>(allocator_);
+    }
+
+    /**
+     * @brief Copies the json in constant time, the nodes are shared with a
+     * reference count until one of the jsons changes them. Every change, and
+     * every access handing out a child by reference like get(...) or
+     * map_array(...), first copies the shared containers on its path, their
+     * children stay shared. Containers whose children were handed out by
+     * reference are copied right away instead, so changes through references
+     * taken before the copy do not reach it. Copying after navigating a json
+     * therefore copies the navigated containers.
+     *
+     * The non-const get(...) and map_array(...) are accessors for changes and
+     * may copy nodes, a json shared between threads is only read with the
+     * const overloads or reader(). It may be copied from many threads at once
+     * as long as none of them accesses it otherwise.
+     *
+     * With an arena allocator the nodes can not outlive their arena, the
+     * copy is a deep copy into a new arena instead.
+     *
+     * @param base The json to copy.
+     */
+    JsonBase(const JsonBase &base) : JsonBase(json_allocator(), base) {
+    }
+
+    /**
+     * @brief Replaces the value by a copy of x like the copy constructor.
+     *
+     * @param x The json to copy.
+     *
+     * @return Returns a reference to itself.
+     */
+    JsonBase &operator=(const JsonBase &x) {
+      if (this != &x)
+        *this = JsonBase(x);
+      return *this;
+    }
+
+    /**
+     * @brief Copies the json with the given allocator, see
+     * JsonBase(const JsonBase&). Used for the children of copied containers.
+     *
+     * @param alloc The allocator of the copy.
+     * @param other The json to copy.
+     */
+    JsonBase(json_allocator alloc, const JsonBase &other) : storage_(other.storage_), allocator_(std::move(alloc)), last_error_(other.last_error_) {
+      switch (storage_) {
+        case Storage::boolean:    boolean_ = other.boolean_; return;
+        case Storage::integer:    integer_ = other.integer_; return;
+        case Storage::floating:   floating_ = other.floating_; return;
+        default:                  interface_ = other.interface_; break;
+      }
+      if (storage_ < Storage::interface || !interface_)
+        return;
+      // References to the children of an exposed node may still be used to
+      // change them, the copy must not see these changes.
+      if (json_has_arena<json_allocator>::value || interface_->exposed_.load(std::memory_order_relaxed)) {
+        if (JsonInterface *copy = interface_->clone(allocator_)) {
+          interface_ = copy;
+          return;
+        }
+      }
+      interface_->references_.fetch_add(1,std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Implement the move constructor, no ownership problems as the
+     * value is moved away from the other base. The remaining JsonBase is of
+     * type JsonType::null.
+     *
+     * @param base The other Json to move the interface from.
+     */
+    JsonBase(JsonBase &&base) noexcept : storage_(base.storage_), allocator_(std::move(base.allocator_)), last_error_(base.last_error_) {
+      take_value(base);
+      base.last_error_ = JsonError::ok;
+    }
+
+    /**
+     * @brief Create the JsonBase with the given interface, one can provide any
+     * class that is derive from JsonInterface. The basic types to provide this
+     * function with are JsonImplObject, JsonImplBoolean, JsonImplInteger,
+     * JsonImplArray
+     *
+     * @param inter The interface to provide to the json base
+     */
+    JsonBase(JsonInterface *inter) : JsonBase(json_allocator(), inter) {
+    }
+
+    /**
+     * @brief Create the JsonBase with the given interface and allocator. The
+     * interface must be created with the same allocator as it is released
+     * through it.
+     *
+     * @param alloc The allocator the interface was created with.
+     * @param inter The interface to provide to the json base
+     */
+    JsonBase(json_allocator alloc, JsonInterface *inter) : interface_(inter), storage_(Storage::interface), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+    }
+
+    /**
+     * @brief Creates the Json from a given string. This does not PARSE the
+     * string but creates a json object of type string. 
+     *
+     * For example:
+     * ```
+     * {"hallo": "This is a Json object of type string"}
+     *           ______________________________________
+     * ```
+     *
+     * @param x The string to create the json from.
+     */
+    JsonBase(std::string &&x) : JsonBase(json_allocator(), std::move(x)) {
+    }
+
+    /**
+     * @brief Creates the Json of type string inside the given allocator.
+     *
+     * @param alloc The allocator to create the string with.
+     * @param x The string to create the json from.
+     */
+    JsonBase(json_allocator alloc, std::string &&x) : storage_(Storage::interface), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+      interface_ = allocator_.template create<JsonImplString>(string_type(x.begin(),x.end(),allocator_.template stl<char>()));
+    }
+
+    /**
+     * @brief Creates a new Json object of type integer, this just describes an
+     * integer inside of a json.
+     * For example:
+     * ```
+     * {"attribute_key": 10240}
+     *                   _____  This is an json object of type integer
+     * ```
+     *
+     * @param x Integer to initialise the json with
+     */
+    JsonBase(long long x) : JsonBase(json_allocator(), x) {
+    }
+
+    /**
+     * @brief Creates the Json of type integer inside the given allocator.
+     *
+     * @param alloc The allocator to create the integer with.
+     * @param x Integer to initialise the json with
+     */
+    JsonBase(json_allocator alloc, long long x) : integer_(x), storage_(Storage::integer), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+    }
+
+    JsonBase(double x) : JsonBase(json_allocator(), x) {
+    }
+
+    /**
+     * @brief Creates the Json of type double inside the given allocator.
+     *
+     * @param alloc The allocator to create the double with.
+     * @param x Double to initialise the json with
+     */
+    JsonBase(json_allocator alloc, double x) : floating_(x), storage_(Storage::floating), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+    }
+
+    /**
+     * @brief Creates a new Json object of type boolean.
+     * For example:
+     * ```
+     * {"attribute_key": true}
+     *                   ____   This is an json object of type boolean
+     * ```
+     *
+     * @param b The boolean to set the json object to.
+     */
+    JsonBase(bool b) : JsonBase(json_allocator(), b) {
+    }
+
+    /**
+     * @brief Creates the Json of type boolean inside the given allocator.
+     *
+     * @param alloc The allocator to create the boolean with.
+     * @param b The boolean to set the json object to.
+     */
+    JsonBase(json_allocator alloc, bool b) : boolean_(b), storage_(Storage::boolean), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+    }
+
+    /**
+     * @brief Creates a new Json object of type null.
+     * For example:
+     * ```
+     * {"attribute_key": null}
+     *                   ____   This is an json object of type null
+     * ```
+     */
+    JsonBase(std::nullptr_t) : JsonBase(json_allocator(), nullptr) {
+    }
+
+    /**
+     * @brief Creates the Json of type null with the given allocator.
+     *
+     * @param alloc The allocator of the children, null has none.
+     */
+    JsonBase(json_allocator alloc, std::nullptr_t) : interface_(nullptr), storage_(Storage::null), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+    }
+    
+    /**
+     * @brief Destroys the current interface by setting the current interface
+     * to nullptr. The function set_interface(...) cleans up dangling pointers.
+     */
+    ~JsonBase() {
+      release();
+    }
+
+    /**
+     * @brief Sets the Json move assignment operator. This is implemented as the
+     * move operator avoids ownership conflicts.
+     *
+     * @param x The Json to move the interface and the error from.
+     *
+     * @return Returns a reference to itself to enable chain moving.
+     */
+    JsonBase &operator=(JsonBase &&x) {
+      // Releases the old value and takes the value away from x.
+      release();
+      storage_ = x.storage_;
+      take_value(x);
+      last_error_ = x.last_error_;
+      // If x owns its memory the ownership moves to this instance so the
+      // interface lives as long as this json.
+      allocator_.adopt(x.allocator_);
+      return *this;
+    }
+    
+    /**
+     * @brief Sets a new interface and cleans up dangling pointers.
+     *
+     * @param interface The new interface to set the pointer to.
+     */
+    void set_interface(JsonInterface *interface) {
+      release();
+      storage_ = Storage::interface;
+      interface_ = interface;
+    }
+
+    /**
+     * @brief Returns the underlying type of the current interface.
+     *
+     * @return The type of the current interface.
+     */
+    JsonType type() {
+      switch (storage_) {
+        case Storage::null:       return JsonType::null;
+        case Storage::boolean:    return JsonType::boolean;
+        case Storage::integer:    return JsonType::integer;
+        case Storage::floating:   return JsonType::floating_point;
+        case Storage::array:      return JsonType::array;
+        case Storage::object:     return JsonType::object;
+        default:                  return interface_->type();
+      }
+    }
+
+    /**
+     * @brief Returns the error if there is one.
+     *
+     * @return The current eror there is.
+     */
+    JsonError error() {
+      return last_error_;
+    }
+
+    /**
+     * @brief Returns the size of the underlying interface.
+     *
+     * @return Returns the size of the current interface, for json objects, the
+     * number of key:value pairs, for json arrays the number of items in the
+     * array.
+     */
+    int size() {
+      if (storage_ == Storage::array)
+        return static_cast<JsonImplArray*>(interface_)->size();
+      if (storage_ == Storage::object)
+        return static_cast<JsonImplObject*>(interface_)->size();
+      if (storage_ == Storage::interface)
+        return interface_->size();
+      return 1;
+    }
+
+    /**
+     * @brief Returns the items of a json array which only holds integers.
+     * Such arrays store their items next to each other until an item is
+     * accessed by reference, e.g. with get(index) or map_array(...) on a non
+     * const json, or something else than a number is appended. The const
+     * get(index) and reader() read the items in place.
+     *
+     * @return The integers or an empty view if this is not such an array.
+     */
+    JsonSpan<const long long> packed_integers() {
+      if (storage_ != Storage::array)
+        return JsonSpan<const long long>();
+      return static_cast<JsonImplArray*>(interface_)->packed_integers();
+    }
+
+    /**
+     * @brief Returns the items of a json array which holds floating point
+     * numbers and maybe integers, all converted to double, like
+     * packed_integers().
+     *
+     * @return The numbers or an empty view if this is not such an array.
+     */
+    JsonSpan<const double> packed_floats() {
+      if (storage_ != Storage::array)
+        return JsonSpan<const double>();
+      return static_cast<JsonImplArray*>(interface_)->packed_floats();
+    }
+
+    /**
+     * @brief Convertes the json type to a string format. 
+     *
+     * @return Returns the json type as string. For example JsonType::object to
+     * "JsonType::object".
+     */
+    std::string type_as_string() {
+      // Do a direct mapping of type name to string
+      switch(type()) {
+        case JsonType::object:      return "JsonType::object";
+        case JsonType::array:       return "JsonType::array";
+        case JsonType::integer:     return "JsonType::integer";
+        case JsonType::string:      return "JsonType::string";
+        case JsonType::boolean:     return "JsonType::boolean";
+        default:                    return "JsonType::unknown";
+      }
+      // This should never happen, but some compilers complain without it.
+      return "";
+    }
+
+    /**
+     * @brief Creates a dump of the given Json
+     *
+     * @return Returns a string of the underlying json interface.
+     */
+    std::string dump() {
+      std::string ret;
+      ret.reserve(size_estimate());
+      {
+        JsonStringSink sink(ret);
+        write(sink);
+      }
+      return ret;
+    }
+
+    /**
+     * @brief Writes the dump of the json into the sink, nothing is buffered
+     * in between.
+     *
+     * @param sink The sink to write to, the caller decides when to flush it.
+     */
+    void dump(JsonSink &sink) {
+      write(sink);
+    }
+
+    /**
+     * @brief Writes the dump of the json into the stream.
+     *
+     * @param stream The stream to write to.
+     */
+    void dump(std::ostream &stream) {
+      JsonOstreamSink sink(stream);
+      write(sink);
+    }
+
+    /**
+     * @brief Creates a dump of the given Json on several threads, see
+     * dump_stream(...).
+     *
+     * @param threads The number of worker threads, 0 uses one per hardware
+     * thread.
+     *
+     * @return Returns the same string as dump().
+     */
+    std::string dump_parallel(unsigned threads=0) {
+      std::string ret;
+      ret.reserve(size_estimate());
+      dump_stream([&ret](std::string_view part){ret.append(part.data(),part.size());},threads);
+      return ret;
+    }
+
+    /**
+     * @brief Writes the dump of the json into the sink on several threads,
+     * see dump_stream(...).
+     *
+     * @param sink The sink to write to, the caller decides when to flush it.
+     * @param threads The number of worker threads, 0 uses one per hardware
+     * thread.
+     */
+    void dump_parallel(JsonSink &sink, unsigned threads=0) {
+      dump_stream([&sink](std::string_view part){sink.append(part);},threads);
+    }
+
+    /**
+     * @brief Dumps the json in parts and passes every part to the writer in
+     * order as soon as it is finished, so sending can start before the dump
+     * is complete. The items of a root array or the attributes of a root
+     * object are split into ranges which the worker threads serialize into
+     * their own buffers, only a few parts ahead of the writer are kept in
+     * memory. Only the root is split, a root with one large child is dumped
+     * by one thread. Define GC_JSON_NO_THREADS to dump on the calling thread
+     * only.
+     *
+     * @param writer Called with every part, the concatenation of all parts
+     * is the same as dump(). If it throws the workers are stopped and joined
+     * before the exception is passed on.
+     * @param threads The number of worker threads, 0 uses one per hardware
+     * thread. The calling thread only writes the parts.
+     */
+    template<typename Writer>
+    void dump_stream(Writer &&writer, unsigned threads=0) {
+      std::vector<JsonBase*> items;
+      std::vector<std::string_view> keys;
+      // Packed numbers are dumped at once, splitting them would need items.
+      if (storage_ == Storage::array && packed_integers().empty() && packed_floats().empty()) {
+        auto array = static_cast<JsonImplArray*>(interface_);
+        items.reserve(array->size());
+        for (int i = 0; i < array->size(); i++)
+          items.push_back(&array->at(i));
+      }
+      else if (storage_ == Storage::object) {
+        auto object = static_cast<JsonImplObject*>(interface_);
+        items.reserve(object->size());
+        keys.reserve(object->size());
+        object->for_each_attribute([&items,&keys](std::string_view key, JsonBase &value){
+          keys.push_back(key);
+          items.push_back(&value);
+        });
+      }
+      if (items.empty()) {
+        std::string part = dump();
+        writer(std::string_view(part));
+        return;
+      }
+
+#if defined(GC_JSON_NO_THREADS)
+      threads = 1;
+#else
+      if (threads == 0)
+        threads = std::max(1u,std::thread::hardware_concurrency());
+#endif
+      // Parts are small enough to start writing early and large enough to
+      // keep the synchronization cheap.
+      const std::size_t chunk = std::max<std::size_t>(1,std::min<std::size_t>(4096,items.size()/((std::size_t)threads*8)));
+      const std::size_t count = (items.size()+chunk-1)/chunk;
+      const bool is_object = storage_ == Storage::object;
+
+      // Serializes the part with all separators and the brackets of the root.
+      auto serialize = [&](std::size_t part, std::string &out) {
+        JsonStringSink sink(out);
+        sink.put(part == 0 ? (is_object ? '{' : '[') : ',');
+        std::size_t last = std::min(items.size(),(part+1)*chunk);
+        for (std::size_t i = part*chunk; i < last; i++) {
+          if (i != part*chunk)
+            sink.put(',');
+          if (is_object) {
+            sink.put('"');
+            json_escape(keys[i],sink);
+            sink.append("\":",2);
+          }
+          items[i]->write(sink);
+        }
+        if (part+1 == count)
+          sink.put(is_object ? '}' : ']');
+      };
+
+#if !defined(GC_JSON_NO_THREADS)
+      if (threads > 1 && count > 1) {
+        const std::size_t window = (std::size_t)threads*4;
+        std::vector<std::string> parts(count);
+        std::vector<char> done(count,0);
+        std::size_t next = 0;
+        std::size_t written = 0;
+        bool stop = false;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::condition_variable room;
+
+        auto worker = [&]() {
+          std::string out;
+          for (;;) {
+            std::size_t part;
+            {
+              std::unique_lock<std::mutex> lock(mutex);
+              room.wait(lock,[&]{return stop || next >= count || next < written+window;});
+              if (stop || next >= count)
+                return;
+              part = next++;
+            }
+            out.clear();
+            serialize(part,out);
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              parts[part].swap(out);
+              done[part] = 1;
+            }
+            finished.notify_all();
+          }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned i = 0; i < std::min<std::size_t>(threads,count); i++)
+          pool.emplace_back(worker);
+        std::string part;
+        try {
+          for (std::size_t i = 0; i < count; i++) {
+            {
+              std::unique_lock<std::mutex> lock(mutex);
+              finished.wait(lock,[&]{return done[i] != 0;});
+              part = std::move(parts[i]);
+              written = i+1;
+            }
+            room.notify_all();
+            writer(std::string_view(part));
+          }
+        }
+        catch (...) {
+          // The workers finish their current part and return.
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+          }
+          room.notify_all();
+          for (auto &thread : pool)
+            thread.join();
+          throw;
+        }
+        for (auto &thread : pool)
+          thread.join();
+        return;
+      }
+#endif
+      std::string part;
+      for (std::size_t i = 0; i < count; i++) {
+        part.clear();
+        serialize(i,part);
+        writer(std::string_view(part));
+      }
+    }
+
+    /**
+     * @brief Encodes the json as CBOR (RFC 8949).
+     *
+     * @return Returns the encoded bytes.
+     */
+    std::string dump_cbor() {
+      std::string ret;
+      ret.reserve(size_estimate());
+      {
+        JsonStringSink sink(ret);
+        JsonCborWriter writer(sink);
+        write_events(writer);
+      }
+      return ret;
+    }
+
+    /**
+     * @brief Encodes the json as CBOR into the sink.
+     *
+     * @param sink The sink to write to, the caller decides when to flush it.
+     */
+    void dump_cbor(JsonSink &sink) {
+      JsonCborWriter writer(sink);
+      write_events(writer);
+    }
+
+    /**
+     * @brief Writes the json as tape (see JsonTapeFormat) which JsonTape
+     * queries without parsing.
+     *
+     * @return Returns the tape.
+     */
+    std::string dump_tape() {
+      JsonTapeWriter writer;
+      write_events(writer);
+      return writer.finish();
+    }
+
+    /**
+     * @brief Writes the json as tape into the sink, e.g. a file.
+     *
+     * @param sink The sink to write to, the caller decides when to flush it.
+     */
+    void dump_tape(JsonSink &sink) {
+      JsonTapeWriter writer;
+      write_events(writer);
+      writer.write(sink);
+    }
+
+    /**
+     * @brief Executes the given function if the type is JsonType::string
+     *
+     * @param func Call the function with the string inside if the object is of
+     * type string, either with a std::string& to a copy or with a
+     * std::string_view if it accepts one.
+     *
+     * @return Returns a reference to itself for function chaining
+     */
+    template<typename Func>
+    JsonBase& map_string(Func &&func) {
+      // Callables taking a std::string_view get the stored characters
+      // whenever there is nothing to unescape.
+      if constexpr (std::is_invocable<Func&,std::string_view>::value) {
+        std::string_view view;
+        if (storage_ >= Storage::interface && interface_ && interface_->to_string_view(view)) {
+          func(view);
+          return *this;
+        }
+      }
+      std::string tmp = value_interface()->to_string(last_error_);
+      if (last_error_ == JsonError::ok)
+        func(tmp);
+      return *this;
+    }
+
+    /**
+     * @brief Executes the given function if the type is JsonType::int
+     *
+     * @param func The function to execute when the type is int
+     *
+     * @return Returns a reference to itself for function chaining
+     */
+    template<typename Func>
+    JsonBase& map_int(Func &&func) {
+      int tmp = storage_ == Storage::integer ? integer_ : value_interface()->to_int(last_error_);
+      if (last_error_ == JsonError::ok)
+        func(tmp);
+      return *this;
+    }
+
+    /**
+     * @brief Executes the given function if the type is JsonType::bool
+     *
+     * @param func The function to execute when the type fits
+     *
+     * @return Returns a reference to the instance for function chaining
+     */
+    template<typename Func>
+    JsonBase& map_bool(Func &&func) {
+      bool tmp = storage_ == Storage::boolean ? boolean_ : value_interface()->to_bool(last_error_);
+      if (last_error_ == JsonError::ok)
+        func(tmp);
+      return *this;
+    }
+
+    /**
+     * @brief Calls the given function for every object in the array if the
+     * instance is an object
+     *
+     * @param func The function to execute on every member of the array
+     *
+     * @return Returns a reference to the instance for function chaining
+     */
+    template<typename Func>
+    JsonBase &map_array(Func &&func) {
+      expose();
+      if (storage_ == Storage::array) {
+        auto arr = static_cast<JsonImplArray*>(interface_);
+        for (int i = 0; i < arr->size(); i++)
+          func(arr->at(i));
+        return *this;
+      }
+      for (int i = 0; i < size(); i++) {
+        JsonBase *val = value_interface()->get(i,last_error_);
+        if(last_error_ == JsonError::ok) {
+          func(*val);
+        }
+        else
+          break;
+      }
+      return *this;
+    }
+
+/**
+ * @brief Calls the given function on every pair (key,value) in the json object
+ *
+ * @param func The function to execute on a value pair, called with the key as
+ * std::string_view if it accepts one and otherwise as const std::string&.
+ *
+ * @return Returns a reference to itself for easier function chaining
+ */
+    template<typename Func>
+    JsonBase &map_object(Func &&func) {
+      expose();
+      if (storage_ == Storage::object && last_error_ == JsonError::ok) {
+        auto obj = static_cast<JsonImplObject*>(interface_);
+        if constexpr (std::is_invocable<Func&,std::string_view,JsonBase&>::value)
+          obj->for_each_attribute(func);
+        else {
+          std::string key;
+          obj->for_each_attribute([&func,&key](std::string_view view, JsonBase &value){
+            key.assign(view.data(),view.size());
+            func(static_cast<const std::string&>(key),value);
+          });
+        }
+      }
+      else
+        last_error_ = JsonError::not_implemented;
+      return *this;
+    }
+
+    /**
+     * @brief Call the given function if no error occured while accessing the
+     * array
+     *
+     * @param func The function to execute.
+     *
+     * @return Returns a reference to itself for easier function chaining
+     */
+    template<typename Func>
+    JsonBase &map(Func &&func) {
+      if (!has_error())
+        func();
+      return *this;
+    }
+
+
+    /**
+      * @brief Returns a copy of the item at the given index without changing
+      * this json. Packed numbers are read from their buffer and stay packed,
+      * containers are copied like JsonBase(const JsonBase&) and are viewed
+      * without a copy by reader().
+      *
+      * @param index The index of the item.
+      *
+      * @return The item, or null with JsonError::does_not_exist if the index
+      * is out of range or JsonError::not_implemented if this is no array.
+    */
+    JsonBase get(int index) const {
+      JsonBase ret(nullptr);
+      if (storage_ != Storage::array)
+        ret.set_error(JsonError::not_implemented);
+      else if (index < 0 || index >= static_cast<JsonImplArray*>(interface_)->size())
+        ret.set_error(JsonError::does_not_exist);
+      else
+        return static_cast<JsonImplArray*>(interface_)->value(index);
+      return ret;
+    }
+
+    /**
+      * @brief Returns a copy of the value of the given key without changing
+      * this json, so it may be called from many threads at once like
+      * reader().
+      *
+      * @param x The key to search for in the json object.
+      *
+      * @return The value, or null with JsonError::does_not_exist if the key
+      * does not exist or JsonError::not_implemented if this is no object.
+    */
+    JsonBase get(const std::string &x) const {
+      JsonBase ret(nullptr);
+      JsonError err = JsonError::not_implemented;
+      if (storage_ == Storage::object) {
+        err = JsonError::ok;
+        auto value = static_cast<JsonImplObject*>(interface_)->get(x,err);
+        if (err == JsonError::ok)
+          return *value;
+      }
+      ret.set_error(err);
+      return ret;
+    }
+
+    /**
+      * @brief Returns the JsonObject at the given index. This function only
+      * works if the underlying type is JsonType::array. The item may be
+      * changed through the reference, so packed numbers are unpacked. The
+      * items are stored next to each other, appending to this array may move
+      * them and invalidates the reference like with std::vector.
+      *
+      * @param index The index to return the object from.
+      *
+      * @return Returns on success the given json object or an instance of this
+      * class with an error code set.
+    */
+    JsonBase &get(int index) {
+      expose();
+      if (storage_ == Storage::array)
+        return static_cast<JsonImplArray*>(interface_)->at(index);
+      auto ret = value_interface()->get(index,last_error_);
+      if (last_error_!=JsonError::ok)
+        return *this;
+      return *ret;
+    }
+
+    /**
+      * @brief Returns the json object associated with the given key, if the
+      * object does not exist or the key does not exist returns this instance
+      * and sets an error code.
+      *
+      * @param x The key to search for in the json object.
+      *
+      * @return Either the found JsonBase or this instance depending on the
+      * operation outcome.
+      */
+    JsonBase &get(const std::string &&x) {
+      return get(x);
+    }
+
+    /**
+      * @brief Returns the json object associated with the given key, if the
+      * object does not exist or the key does not exist returns this instance
+      * and sets an error code. Flat and shaped objects store their values
+      * next to each other, adding a key to this object invalidates the
+      * reference. The values of hashed objects keep their place.
+      *
+      * @param x The key to search for in the json object.
+      *
+      * @return Either the found JsonBase or this instance depending on the
+      * operation outcome.
+      */
+    JsonBase &get(const std::string &x) {
+      expose();
+      auto ret = storage_ == Storage::object ? static_cast<JsonImplObject*>(interface_)->get(x,last_error_) : value_interface()->get(x,last_error_);
+      if (last_error_==JsonError::ok)
+        return *ret;
+      return *this;
+    }
+
+    /**
+      * @brief Returns the json object associated with the key like
+      * get(const std::string&), the hash of the key is not computed again and
+      * keys interned with the same JsonKeyInterner as the document are
+      * compared by pointer.
+      *
+      * @param x The key, e.g. from JsonKeyInterner::intern(...).
+      *
+      * @return Either the found JsonBase or this instance depending on the
+      * operation outcome.
+      */
+    JsonBase &get(const JsonKey &x) {
+      expose();
+      if (storage_ != Storage::object) {
+        last_error_ = JsonError::not_implemented;
+        return *this;
+      }
+      auto ret = static_cast<JsonImplObject*>(interface_)->get(x,last_error_);
+      if (last_error_==JsonError::ok)
+        return *ret;
+      return *this;
+    }
+
+    /**
+      * @brief Returns the json object associated with the key like
+      * get(const JsonKey&). With JsonShapedObjectStorage the key remembers
+      * its position inside the shape of the object, objects with the same
+      * shape are then accessed without any search.
+      *
+      * @param x The key, reused for many objects of the same kind.
+      *
+      * @return Either the found JsonBase or this instance depending on the
+      * operation outcome.
+      */
+    JsonBase &get(JsonCachedKey &x) {
+      if constexpr (!std::is_same<object_storage, JsonShapedObjectStorage>::value)
+        return get(x.key());
+      else {
+        expose();
+        if (storage_ != Storage::object) {
+          last_error_ = JsonError::not_implemented;
+          return *this;
+        }
+        auto ret = static_cast<JsonImplObject*>(interface_)->get(x,last_error_);
+        if (last_error_==JsonError::ok)
+          return *ret;
+        return *this;
+      }
+    }
+
+    /**
+      * @brief Returns the json referenced by the json pointer. If any token
+      * does not exist returns this instance and sets an error code like
+      * get(key), the reference is invalidated like the ones of get(index)
+      * and get(key).
+      *
+      * @param path The compiled json pointer.
+      *
+      * @return Either the referenced JsonBase or this instance.
+      */
+    JsonBase &get(const JsonPath &path) {
+      if (!path.valid()) {
+        last_error_ = JsonError::does_not_exist;
+        return *this;
+      }
+      JsonBase *current = this;
+      JsonError err = JsonError::ok;
+      for (std::size_t i = 0; i < path.size(); i++) {
+        const JsonPath::Token &token = path[i];
+        current->expose();
+        if (current->storage_ == Storage::array) {
+          auto array = static_cast<JsonImplArray*>(current->interface_);
+          if (token.index < 0 || token.index >= array->size()) {
+            last_error_ = JsonError::does_not_exist;
+            return *this;
+          }
+          current = &array->at(token.index);
+          continue;
+        }
+        current = current->storage_ == Storage::object ? static_cast<JsonImplObject*>(current->interface_)->get(token.key,err) : current->value_interface()->get(token.key,err);
+        if (err != JsonError::ok) {
+          last_error_ = err;
+          return *this;
+        }
+      }
+      return *current;
+    }
+
+/**
+ * @brief Tries to insert a new (key,value) pair into an json object
+ *
+ * @tparam T The type of the inserted value
+ * @param x The key to insert into the json object.
+ * @param t The value to insert into the Json object.
+ *
+ * @return Returns an instance to itself. Sets an error code in the class if the
+ * object is not of type JsonType::object.
+ */
+    template<typename T>
+    JsonBase &set(const std::string &&x, T t) {
+      insert_node(x,allocator_.template create<JsonBase>(allocator_.child(),t));
+      return *this;
+    }
+
+
+/**
+ * @brief Tries to insert a new (key,const char *) pair. This overload is
+ * provided to distinguish between bool and const char* as casting to bool is
+ * nearer than casting to const char*
+ *
+ * @param x The key of the inserted pair
+ * @param str The value of the inserted pair, will get inserted as
+ * JsonType::string.
+ *
+ * @return Returns this instance for easier function chaining.
+ */
+    JsonBase &set(const std::string &&x, const char *str) {
+      insert_node(x,allocator_.template create<JsonBase>(allocator_.child(),std::string(str)));
+      return *this;
+    }
+
+
+/**
+ * @brief Tries to insert a new (key,JsonBase*) pair into a json object. The
+ * function sets an error code when the object is not of type json object.
+ *
+ * @param x The key to insert into the JsonObject.
+ * @param js The Interface to insert into the JsonObject.
+ *
+ * @return Returns an instance of itself for easier function chaining.
+ */
+    JsonBase &set(const std::string &&x, JsonBase *js) {
+      insert_node(x,take_node(js));
+      return *this;
+    }
+
+/**
+ * @brief Tries to insert a new value into the json array. Sets an error code if
+ * the JsonBase is not of type JsonType::array
+ *
+ * @tparam T The type to insert into the json object. Every type is insertable
+ * which can be constructed by JsonBase(T);
+ * @param t The value to call the constructor with.
+ *
+ * @return An instance of itself for easier function chaining
+ */
+    template<typename T>
+    JsonBase &push_back(T t) {
+      insert_node("",allocator_.template create<JsonBase>(allocator_.child(),t));
+      return *this;
+    }
+
+/**
+ * @brief Tries to insert a string into the json array. If the JsonBase is not
+ * of type JsonType::array then an error code is set.
+ *
+ * @param str The string to insert into the array.
+ *
+ * @return Returns an instance to itself for easier function chaining
+ */
+    JsonBase &push_back(const char *str) {
+      insert_node("",allocator_.template create<JsonBase>(allocator_.child(),std::string(str)));
+      return *this;
+    }
+
+/**
+ * @brief Inserts an interface into the json array. An error code is set if the
+ * underlying type is not JsonType::array.
+ *
+ * @param js The interface to include into the json array.
+ *
+ * @return Returns an instance to itself for easier function chaining.
+ */
+    JsonBase &push_back(JsonBase *js) {
+      insert_node("",take_node(js));
+      return *this;
+    }
+
+/**
+ * @brief Sets the internal error state to the given error code. If there is
+ * already an error code set this function will just silently overwrite it.
+ *
+ * @param err The error code to set the last_error to.
+ */
+    void set_error(JsonError err) {
+      last_error_ = err;
+    }
+
+/**
+ * @brief Checks if there was an illegal call or cast using this instance.
+ *
+ * @return True if there happened an illegal action.
+ */
+    bool has_error() {
+      return last_error_ != JsonError::ok;
+    }
+
+/**
+ * @brief Calls the callback function if there was an illegal operation or an
+ * error in this instance.
+ *
+ * @param func The function to call when there is an error inside.
+ */
+    template<typename Func>
+    void error(Func &&func) {
+      if (last_error_ != JsonError::ok) {
+        func(last_error_);
+        last_error_ = JsonError::ok;
+      }
+    }
+
+/**
+ * @brief The JsonParser used to parse large json strings.
+ */
+    struct JsonParser {
+
+
+      /**
+       * @brief Possible json parse errors while parsing.
+       */
+      enum class JsonParserError {
+        ok,
+        expected_comma_before_next_attribute,
+        expected_comma_before_next_array_item,
+        expected_attribute_but_got_comma,
+        expected_string_attribute_key,
+        expected_closing_quote_but_got_eos,
+        expected_beginning_of_string_int_object_or_array_null_float,
+        expected_colon_but_got_different_character_instead,
+        expected_int_or_double,
+        unexpected_end_of_json,
+        unexpected_character_after_json,
+        aborted_by_handler,
+        exceeded_max_depth,
+        unexpected_type,
+        exceeded_max_length,
+      };
+      
+      int abs_pos_;   ///< The current absolute position in the underlying_json_ string view.
+      JsonParserError error_;   ///< The current state, everything other than JsonParserError::ok means abort parsing.
+      std::string_view underlying_json_;  ///< The json to parse.
+      json_allocator allocator_;  ///< Owns the memory of all parsed nodes until it is handed to the resulting json.
+      JsonParseOptions options_;  ///< The options the json is parsed with.
+      const std::vector<std::uint32_t> *index_;  ///< The structural positions of the json or nullptr to scan every character
+      std::size_t index_pos_;     ///< The first structural position which might not be consumed yet
+
+      static constexpr bool collect_stats = log_level >= JsonLogLevel::log_stats;  ///< True if stats_ is filled
+      using PhaseTimer = typename std::conditional<collect_stats, JsonPhaseTimer, JsonNoPhaseTimer>::type;
+
+      JsonParseStats stats_;      ///< The statistics of the parse if collect_stats is set
+      std::size_t depth_;         ///< The number of open objects and arrays
+
+      static constexpr std::size_t inline_words = 4;  ///< The open containers up to 256 levels are kept inside the parser
+      std::uint64_t containers_[inline_words];        ///< One bit per open container, set for objects, the outermost first
+      std::vector<std::uint64_t> deep_containers_;    ///< The bits of the containers below 256 levels
+
+      
+      /**
+       * @brief Parses the given json starting at startpos
+       *
+       * @param view The string to parse, using a string view to save
+       * ressources.
+       * @param startpos The starting position.
+       * @param options The options to parse the json with.
+       * @param allocator The allocator to create the nodes with.
+       */
+      JsonParser(std::string_view view,int startpos=0,JsonParseOptions options=JsonParseOptions(),json_allocator allocator=json_allocator()) : allocator_(std::move(allocator)) {
+        underlying_json_ = view;
+        abs_pos_ = startpos;
+        options_ = options;
+        index_ = nullptr;
+        index_pos_ = 0;
+        depth_ = 0;
+        // No error at the beginning
+        error_ = JsonParserError::ok;
+      }
+
+      /**
+       * @brief Uses the structural positions of the given index to skip
+       * whitespace, the index must be built from the parsed json and outlive
+       * the parser. An index which could not be built is ignored. Only worth
+       * it when the index is needed anyway, like in parse_parallel(...),
+       * building it costs more than scanning the whitespace.
+       *
+       * @param index The index of the json to parse.
+       */
+      void use_index(const JsonStructuralIndex &index) {
+        index_ = index.built() ? &index.positions() : nullptr;
+        index_pos_ = 0;
+      }
+
+      /**
+       * @brief Returns the statistics of the parse, all zero below
+       * JsonLogLevel::log_stats.
+       */
+      const JsonParseStats &stats() const {
+        return stats_;
+      }
+
+      /**
+       * @brief Checks if there has been a parse error.
+       *
+       * @return True if there has been a parse error false otherwise.
+       */
+      bool parse_error() {
+        return error_ != JsonParserError::ok;
+      }
+
+      /**
+       * @brief Sets the current parse error to the given value.
+       *
+       * @param err Sets the parse error to the given parse error.
+       */
+      void set_error(JsonParserError err) {
+        error_ = err;
+      }
+
+      /**
+       * @brief Tries to find the error by taking a substr arround the last
+       * parsed position to show the user the error.
+       *
+       * @param dist The distance in both directions to cut out of the json.
+       *
+       * @return The substr arround the parse error to show the user the error.
+       */
+      std::string get_error_surroundings(int dist) {
+        int start = (abs_pos_-dist<0)?0:abs_pos_-dist;
+        int end = (abs_pos_+dist>=underlying_json_.length())?underlying_json_.length():abs_pos_+dist;
+        return std::string(underlying_json_.substr(start,end-start));
+      }
+
+      /**
+       * @brief Converts the current parse error into a string
+       *
+       * @return The string version of the error code.
+       */
+      std::string get_error_string() {
+        return error_string(error_);
+      }
+
+      /**
+       * @brief Converts the given parse error into a string
+       *
+       * @param error The error to convert.
+       *
+       * @return The string version of the error code.
+       */
+      static std::string error_string(JsonParserError error) {
+        switch(error) {
+          case JsonParserError::ok:
+            return "No error.";
+          case JsonParserError::expected_comma_before_next_attribute:
+            return "Expected ',' before the next attribute in Json::object.";
+          case JsonParserError::expected_comma_before_next_array_item:
+            return "Expected ',' before next item in the Json::array";
+          case JsonParserError::expected_attribute_but_got_comma:
+            return "Expected next attribute but got ',' instead.";
+          case JsonParserError::expected_string_attribute_key:
+            return "Expected string attribute key but could not find string or the string was empty.";
+          case JsonParserError::expected_closing_quote_but_got_eos:
+            return "Expected closing quotes but got end of string instead.";
+          case JsonParserError::expected_beginning_of_string_int_object_or_array_null_float:
+            return "Expected beginning of new json type either, string, int, bool, array, null, float or object, but got something else.";
+          case JsonParserError::expected_colon_but_got_different_character_instead:
+            return "Expected colon after Json::object attribute key but got different character instead.";
+          case JsonParserError::expected_int_or_double:
+            return "Expected double or integer but got different character.";
+          case JsonParserError::unexpected_end_of_json:
+            return "Expected more input but the json ended.";
+          case JsonParserError::unexpected_character_after_json:
+            return "Expected only whitespace after the end of the json.";
+          case JsonParserError::aborted_by_handler:
+            return "The handler stopped parsing.";
+          case JsonParserError::exceeded_max_depth:
+            return "The json is nested deeper than the maximum depth.";
+          case JsonParserError::unexpected_type:
+            return "The json value does not match the type of the bound member.";
+          case JsonParserError::exceeded_max_length:
+            return "The json is larger than 2GB, positions are stored as int.";
+        }
+        return "Unknown error.";
+      }
+
+      /**
+       * @brief Parses one json value and reports it to the handler, see
+       * JsonBase::parse_events(...) for the calls the handler must provide.
+       *
+       * @param handler Receives the events.
+       *
+       * @return False if there has been a parse error or the handler aborted.
+       */
+      template<typename Handler>
+      bool parse_events(Handler &handler) {
+        if (underlying_json_.length() > (std::size_t)INT_MAX) {
+          set_error(JsonParserError::exceeded_max_length);
+          return false;
+        }
+        if constexpr (collect_stats) {
+          bool ret;
+          {
+            JsonPhaseTimer timer(stats_.total_ns);
+            ret = parse_value(handler);
+          }
+          stats_.bytes_scanned = std::min<std::size_t>(abs_pos_+1,underlying_json_.length());
+          stats_.structural_ns = stats_.total_ns - std::min(stats_.total_ns,stats_.string_ns + stats_.number_ns);
+          return ret;
+        }
+        else
+          return parse_value(handler);
+      }
+
+      /**
+       * @brief Parses a json.
+       *
+       * @return The parsed in DOM format.
+       */
+      JsonBase parse() {
+        JsonDomBuilder builder(allocator_,options_);
+        parse_events(builder);
+        if constexpr (collect_stats)
+          stats_.allocations = builder.created();
+        return builder.take();
+      }
+
+      /**
+       * @brief Parses the next value of any type. Objects and arrays do not
+       * recurse, the open containers are kept as one bit each in an explicit
+       * stack so the call depth stays the same for any nesting.
+       *
+       * @return False if parsing must stop.
+       */
+      template<typename Handler>
+      bool parse_value(Handler &handler) {
+        const std::size_t base = depth_;
+        for (;;) {
+          skip_whitespace_tab_newline();
+          if (abs_pos_ >= (int)underlying_json_.length()) {
+            set_error(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
+            return false;
+          }
+
+          // Check the type of the comming object.
+          bool after_value = true;
+          switch (underlying_json_[abs_pos_]) {
+            case '{':
+            case '[':
+              if (!open_container(handler,underlying_json_[abs_pos_] == '{'))
+                return false;
+              after_value = false;
+              break;
+            case '"':
+              if (!parse_string(handler,false))
+                return false;
+              break;
+            case 't':
+            case 'f':
+              if (!parse_boolean(handler))
+                return false;
+              break;
+            case 'n':
+              if (!parse_null(handler))
+                return false;
+              break;
+            default:
+              if ((underlying_json_[abs_pos_] <= '9' && underlying_json_[abs_pos_] >= '0') || underlying_json_[abs_pos_] == '-') {
+                if (!parse_integer_or_double(handler))
+                  return false;
+                break;
+              }
+              set_error(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
+              return false;
+          }
+
+          // Continue the innermost container until it expects the next value,
+          // a closed container is a completed value of its parent.
+          for (;;) {
+            if (depth_ == base)
+              return true;
+            if (after_value)
+              ++abs_pos_;
+            Step step = innermost_is_object() ? continue_object(handler,after_value) : continue_array(handler,after_value);
+            if (step == Step::failed)
+              return false;
+            if (step == Step::value)
+              break;
+            after_value = true;
+          }
+        }
+      }
+
+      /**
+       * @brief The result of continuing an open container.
+       */
+      enum class Step {
+        value,   ///< The next value starts at the current position
+        closed,  ///< The container is closed and reported to the handler
+        failed,  ///< Parsing must stop
+      };
+
+      /**
+       * @brief Opens an object or array at the current position.
+       *
+       * @param is_object True for an object.
+       *
+       * @return False if parsing must stop.
+       */
+      template<typename Handler>
+      bool open_container(Handler &handler, bool is_object) {
+        if (depth_ >= options_.max_depth) {
+          set_error(JsonParserError::exceeded_max_depth);
+          return false;
+        }
+        //Skip the first character which we know is { or [
+        ++abs_pos_;
+        if constexpr (collect_stats) {
+          ++(is_object ? stats_.objects : stats_.arrays);
+          stats_.max_depth = std::max(stats_.max_depth,depth_+1);
+        }
+        if (!(is_object ? handler.start_object() : handler.start_array()))
+          return abort();
+
+        // Remember the kind of the container at its depth.
+        std::size_t word = depth_/64;
+        if (word >= inline_words && deep_containers_.size() <= word-inline_words)
+          deep_containers_.push_back(0);
+        std::uint64_t &bits = word < inline_words ? containers_[word] : deep_containers_[word-inline_words];
+        std::uint64_t mask = std::uint64_t(1) << (depth_%64);
+        bits = is_object ? (bits | mask) : (bits & ~mask);
+        ++depth_;
+        return true;
+      }
+
+      /**
+       * @brief Returns true if the innermost open container is an object.
+       */
+      bool innermost_is_object() const {
+        std::size_t word = (depth_-1)/64;
+        std::uint64_t bits = word < inline_words ? containers_[word] : deep_containers_[word-inline_words];
+        return (bits >> ((depth_-1)%64)) & 1;
+      }
+
+      /**
+       * @brief Continues the innermost object until the next attribute value
+       * starts or the object is closed.
+       *
+       * @param after_value True if a value has just been parsed.
+       */
+      template<typename Handler>
+      Step continue_object(Handler &handler, bool after_value) {
+        bool has_key = false;
+        //No comma expected yet first we need a key, after a value a comma.
+        bool expect_comma = after_value;
+
+        for (;abs_pos_ < (int)underlying_json_.length(); abs_pos_++) {
+          //Skip all trailing characters as we are not in a string this can be
+          //skipped safely
+          skip_whitespace_tab_newline();
+          if (abs_pos_ >= (int)underlying_json_.length())
+            break;
+          // Check the finish tag if we find this the object is finished.
+          else if (underlying_json_[abs_pos_] == '}')
+            break;
+
+          // Check the comma, if there is one the next (key,value) pair can
+          // start.
+          else if (underlying_json_[abs_pos_] == ',') {
+            // Ok we did not have (key,value) pair before , set error and exit
+            if (!expect_comma) {
+              set_error(JsonParserError::expected_attribute_but_got_comma);
+              return Step::failed;
+            }
+            //Ok we just got a comma, we dont expect another one yet.
+            expect_comma = false;
+          }
+          // No key yet? Expect JsonString then.
+          else if (!has_key) {
+
+            // If we expect a comma now there is a missing comma between
+            // (key,value) and (key1,value1)
+            if (expect_comma) {
+              set_error(JsonParserError::expected_comma_before_next_attribute);
+              return Step::failed;
+            }
+
+            //Parse the next json should be a string.
+            if (underlying_json_[abs_pos_] != '"') {
+              set_error(JsonParserError::expected_string_attribute_key);
+              return Step::failed;
+            }
+            if (!parse_string(handler,true))
+              return Step::failed;
+            has_key = true;
+          }
+          else {
+            // Ok we have a key already expect a double colon now. The first if
+            // should filter all filling characters therefore the next one needs
+            // to be a double colon.
+            if (underlying_json_[abs_pos_++]!=':') {
+              set_error(JsonParserError::expected_colon_but_got_different_character_instead);
+              return Step::failed;
+            }
+            // The value is parsed next, either string, null ....
+            return Step::value;
+          }
+        }
+        --depth_;
+        if (!handler.end_object()) {
+          abort();
+          return Step::failed;
+        }
+        return Step::closed;
+      }
+
+      /**
+       * @brief Searches the closing quote of the json string, skips all
+       * escaped characters.
+       *
+       * @param pos The position of the first character after the opening
+       * quote.
+       * @param has_escapes Set to true if the string contains escape
+       * sequences.
+       *
+       * @return The position of the closing quote or the length of the json
+       * if there is none.
+       */
+      std::size_t find_string_end(std::size_t pos, bool &has_escapes) {
+        has_escapes = false;
+        const char *begin = underlying_json_.data();
+        const char *end = begin + underlying_json_.length();
+        const char *it = begin + std::min(pos,underlying_json_.length());
+        for (;;) {
+          it = json_find_quote_or_backslash(it,end);
+          if (it == end)
+            return underlying_json_.length();
+          if (*it == '"')
+            return it - begin;
+          // Skip the backslash and the escaped character.
+          has_escapes = true;
+          it += (end - it >= 2) ? 2 : 1;
+        }
+      }
+
+      /**
+       * @brief Checks if the character is a filling character.
+       */
+      static bool is_whitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+      }
+
+      /**
+       * @brief Skips all filling characters in the underlying json must not be
+       * called from inside json string! With a structural index the parser
+       * jumps directly to the next structural position.
+       */
+      void skip_whitespace_tab_newline() {
+        if (abs_pos_ < (int)underlying_json_.length() && !is_whitespace(underlying_json_[abs_pos_]))
+          return;
+
+        if (index_) {
+          while (index_pos_ < index_->size() && (*index_)[index_pos_] < (std::uint32_t)abs_pos_)
+            ++index_pos_;
+          abs_pos_ = index_pos_ < index_->size() ? (int)(*index_)[index_pos_] : (int)underlying_json_.length();
+          return;
+        }
+
+        while(abs_pos_ < (int)underlying_json_.length() && is_whitespace(underlying_json_[abs_pos_]))
+          ++abs_pos_;
+      }
+
+      /**
+       * @brief Continues the innermost array until the next item starts or
+       * the array is closed.
+       *
+       * @param after_value True if an item has just been parsed.
+       */
+      template<typename Handler>
+      Step continue_array(Handler &handler, bool after_value) {
+        // A comma is only expected after an item.
+        bool expect_comma = after_value;
+
+        for (;abs_pos_< (int)underlying_json_.length(); abs_pos_++) {
+          // Skip all filling characters.
+          skip_whitespace_tab_newline();
+          if (abs_pos_ >= (int)underlying_json_.length())
+            break;
+          // We are finished on the closing character.
+          if (underlying_json_[abs_pos_] == ']')
+            break;
+          // If there is an comma set the expected comma or error depending on
+          // the expected value.
+          else if (underlying_json_[abs_pos_] == ',') {
+            if (!expect_comma) {
+              set_error(JsonParserError::expected_comma_before_next_array_item);
+              return Step::failed;
+            }
+            expect_comma = false;
+          }
+          else
+            // The item is parsed next.
+            return Step::value;
+        }
+        --depth_;
+        if (!handler.end_array()) {
+          abort();
+          return Step::failed;
+        }
+        return Step::closed;
+      }
+
+      /**
+       * @brief Parses the next json string or attribute key. Handlers with
+       * raw_string(...) and raw_key(...) receive the escaped string, all
+       * others the unescaped one.
+       *
+       * @param is_key True if the string is an attribute key.
+       *
+       * @return False if parsing must stop.
+       */
+      template<typename Handler>
+      bool parse_string(Handler &handler, bool is_key) {
+        PhaseTimer timer(stats_.string_ns);
+        if constexpr (collect_stats)
+          ++(is_key ? stats_.keys : stats_.strings);
+        //Skip the first character which we know is "
+        bool has_escapes;
+        std::size_t end = find_string_end(abs_pos_+1,has_escapes);
+        std::string_view raw = underlying_json_.substr(abs_pos_+1,end-abs_pos_-1);
+        abs_pos_ = end;
+
+        //Something went wrong no closing quote until json end.
+        if (end == underlying_json_.length()) {
+          set_error(JsonParserError::expected_closing_quote_but_got_eos);
+          return false;
+        }
+        // Empty keys are invalid in the Json standard, every escape sequence
+        // results in at least one character.
+        if (is_key && raw.empty()) {
+          set_error(JsonParserError::expected_string_attribute_key);
+          return false;
+        }
+
+        if constexpr (json_has_raw_strings<Handler>::value) {
+          if (is_key)
+            return handler.raw_key(raw,has_escapes) || abort();
+          return handler.raw_string(raw,has_escapes) || abort();
+        }
+        else {
+          std::string_view value = raw;
+          if (has_escapes) {
+            scratch_.clear();
+            json_unescape(raw,scratch_);
+            value = scratch_;
+          }
+          if (is_key)
+            return handler.key(value) || abort();
+          return handler.string(value) || abort();
+        }
+      }
+
+
+      /**
+       * @brief Parses either an json integer or an json double
+       *
+       * @return False if parsing must stop.
+       */
+      template<typename Handler>
+      bool parse_integer_or_double(Handler &handler) {
+        PhaseTimer timer(stats_.number_ns);
+        const char *begin = underlying_json_.data() + abs_pos_;
+        JsonNumber number;
+        const char *end = json_parse_number(begin,underlying_json_.data()+underlying_json_.length(),number);
+
+        //Cast error
+        if (begin == end) {
+          set_error(JsonParserError::expected_int_or_double);
+          return false;
+        }
+
+        // The end should be the last valid character
+        abs_pos_ += (end - begin) - 1;
+
+        if constexpr (collect_stats)
+          ++(number.is_float ? stats_.floats : stats_.integers);
+        if (number.is_float)
+          return handler.floating(number.floating) || abort();
+        return handler.integer(number.integer) || abort();
+      }
+
+      /**
+       * @brief Parse boolean value.
+       *
+       * @return False if parsing must stop.
+       */
+      template<typename Handler>
+      bool parse_boolean(Handler &handler) {
+        bool value;
+
+        if (underlying_json_.substr(abs_pos_,4) == "true") {
+          abs_pos_ = abs_pos_+3;
+          value = true;
+        }
+        else {
+          abs_pos_ = abs_pos_+4;
+          value = false;
+        }
+        if constexpr (collect_stats)
+          stats_.booleans++;
+        return handler.boolean(value) || abort();
+      }
+
+      /**
+       * @brief Check the json null value.
+       *
+       * @return False if parsing must stop.
+       */
+      template<typename Handler>
+      bool parse_null(Handler &handler) {
+        if(underlying_json_.substr(abs_pos_,4) != "null") {
+          set_error(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
+          return false;
+        }
+        abs_pos_+=3;
+        if constexpr (collect_stats)
+          stats_.nulls++;
+        return handler.null() || abort();
+      }
+
+      /**
+       * @brief Parses the next value directly into the given variable without
+       * creating any json. Supported are bool, integers, floating point
+       * numbers, std::string, std::vector and std::optional of supported
+       * types and structs bound with JsonFields, unknown attributes are
+       * skipped and null leaves the value untouched. Integers outside of the
+       * range of an integral member and doubles read into one stop with
+       * JsonParserError::unexpected_type.
+       *
+       * @param value The variable to parse into.
+       *
+       * @return False if parsing must stop.
+       */
+      template<typename T>
+      bool read(T &value) {
+        skip_whitespace_tab_newline();
+        if (abs_pos_ >= (int)underlying_json_.length()) {
+          set_error(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
+          return false;
+        }
+        const char c = underlying_json_[abs_pos_];
+        JsonScalarEvent event;
+        if (c == 'n') {
+          if constexpr (json_is_optional<T>::value)
+            value.reset();
+          return parse_null(event);
+        }
+
+        if constexpr (json_is_optional<T>::value) {
+          if (!value)
+            value.emplace();
+          return read(*value);
+        }
+        else if constexpr (json_is_bound<T>::value) {
+          if (c != '{')
+            return mismatch();
+          return read_object(value);
+        }
+        else if constexpr (json_is_vector<T>::value) {
+          if (c != '[')
+            return mismatch();
+          return read_array(value);
+        }
+        else if constexpr (std::is_same<T,std::string>::value) {
+          if (c != '"')
+            return mismatch();
+          if (!parse_string(event,false))
+            return false;
+          value.clear();
+          if (event.has_escapes)
+            json_unescape(event.raw,value);
+          else
+            value.assign(event.raw.data(),event.raw.size());
+          return true;
+        }
+        else if constexpr (std::is_same<T,bool>::value) {
+          if (c != 't' && c != 'f')
+            return mismatch();
+          if (!parse_boolean(event))
+            return false;
+          value = event.boolean_value;
+          return true;
+        }
+        else if constexpr (std::is_arithmetic<T>::value) {
+          if ((c < '0' || c > '9') && c != '-')
+            return mismatch();
+          if (!parse_integer_or_double(event))
+            return false;
+          if (!event.is_float) {
+            // Integers outside of the range of the member are not wrapped.
+            if constexpr (std::is_integral<T>::value && std::is_unsigned<T>::value) {
+              if (event.integer_value < 0 || (unsigned long long)event.integer_value > (unsigned long long)std::numeric_limits<T>::max())
+                return mismatch();
+            }
+            else if constexpr (std::is_integral<T>::value) {
+              if (event.integer_value < (long long)std::numeric_limits<T>::min() || event.integer_value > (long long)std::numeric_limits<T>::max())
+                return mismatch();
+            }
+            value = (T)event.integer_value;
+          }
+          else if constexpr (std::is_floating_point<T>::value)
+            value = (T)event.floating_value;
+          else
+            return mismatch();
+          return true;
+        }
+        else {
+          static_assert(json_is_bound<T>::value, "The type can not be parsed, bind it with JsonFields");
+          return false;
+        }
+      }
+
+      /**
+       * @brief Parses an object into a bound struct, the members are found
+       * with the perfect hash of their keys.
+       */
+      template<typename T>
+      bool read_object(T &value) {
+        if (!enter())
+          return false;
+        bool expect_comma = false;
+        for (;; abs_pos_++) {
+          skip_whitespace_tab_newline();
+          if (abs_pos_ >= (int)underlying_json_.length()) {
+            set_error(JsonParserError::unexpected_end_of_json);
+            return false;
+          }
+          const char c = underlying_json_[abs_pos_];
+          if (c == '}')
+            break;
+          if (c == ',') {
+            if (!expect_comma) {
+              set_error(JsonParserError::expected_attribute_but_got_comma);
+              return false;
+            }
+            expect_comma = false;
+            continue;
+          }
+          if (expect_comma) {
+            set_error(JsonParserError::expected_comma_before_next_attribute);
+            return false;
+          }
+          if (c != '"') {
+            set_error(JsonParserError::expected_string_attribute_key);
+            return false;
+          }
+
+          JsonScalarEvent key;
+          if (!parse_string(key,true))
+            return false;
+          std::string_view name = key.raw;
+          if (key.has_escapes) {
+            scratch_.clear();
+            json_unescape(key.raw,scratch_);
+            name = scratch_;
+          }
+          std::size_t index = JsonBinding<T>::table.find(name);
+
+          ++abs_pos_;
+          skip_whitespace_tab_newline();
+          if (abs_pos_ >= (int)underlying_json_.length() || underlying_json_[abs_pos_] != ':') {
+            set_error(JsonParserError::expected_colon_but_got_different_character_instead);
+            return false;
+          }
+          ++abs_pos_;
+          if (index < JsonBinding<T>::size) {
+            if (!read_member(value,index,std::make_index_sequence<JsonBinding<T>::size>()))
+              return false;
+          }
+          // Unknown attributes are parsed without creating anything.
+          else if (!parse_value(key))
+            return false;
+          expect_comma = true;
+        }
+        --depth_;
+        return true;
+      }
+
+      /**
+       * @brief Parses the value of the member with the given index, the
+       * member is selected with a table of functions instead of a search.
+       */
+      template<typename T, std::size_t... Is>
+      bool read_member(T &value, std::size_t index, std::index_sequence<Is...>) {
+        using Reader = bool (JsonParser::*)(T&);
+        static constexpr Reader readers[] = {&JsonParser::template read_member<T,Is>...};
+        return (this->*readers[index])(value);
+      }
+
+      /**
+       * @brief Parses the value of the member I.
+       */
+      template<typename T, std::size_t I>
+      bool read_member(T &value) {
+        return read(value.*(std::get<I>(JsonFields<T>::fields).member));
+      }
+
+      /**
+       * @brief Parses an array into a vector, the items are appended to the
+       * cleared vector.
+       */
+      template<typename T>
+      bool read_array(T &value) {
+        if (!enter())
+          return false;
+        value.clear();
+        bool expect_comma = false;
+        for (;; abs_pos_++) {
+          skip_whitespace_tab_newline();
+          if (abs_pos_ >= (int)underlying_json_.length()) {
+            set_error(JsonParserError::unexpected_end_of_json);
+            return false;
+          }
+          const char c = underlying_json_[abs_pos_];
+          if (c == ']')
+            break;
+          if (c == ',') {
+            if (!expect_comma) {
+              set_error(JsonParserError::expected_comma_before_next_array_item);
+              return false;
+            }
+            expect_comma = false;
+            continue;
+          }
+          if (expect_comma) {
+            set_error(JsonParserError::expected_comma_before_next_array_item);
+            return false;
+          }
+          typename T::value_type item{};
+          if (!read(item))
+            return false;
+          value.push_back(std::move(item));
+          expect_comma = true;
+        }
+        --depth_;
+        return true;
+      }
+
+      /**
+       * @brief Opens the object or array at the current position while
+       * reading into variables.
+       *
+       * @return False if the maximum depth is exceeded.
+       */
+      bool enter() {
+        if (depth_ >= options_.max_depth) {
+          set_error(JsonParserError::exceeded_max_depth);
+          return false;
+        }
+        ++depth_;
+        ++abs_pos_;
+        return true;
+      }
+
+      /**
+       * @brief Stops parsing because the value has another type than the
+       * variable to parse into.
+       *
+       * @return Always false.
+       */
+      bool mismatch() {
+        set_error(JsonParserError::unexpected_type);
+        return false;
+      }
+
+      /**
+       * @brief Stops parsing because the handler returned false.
+       *
+       * @return Always false.
+       */
+      bool abort() {
+        set_error(JsonParserError::aborted_by_handler);
+        return false;
+      }
+
+      std::string scratch_;  ///< Holds the unescaped string passed to handlers without raw strings
+    };
+
+    /**
+     * @brief The handler of JsonParser::parse_events(...) which builds the
+     * DOM, used by JsonBase::parse(...).
+     */
+    class JsonDomBuilder {
+      public:
+        /**
+         * @brief Creates the builder, all values are created with the given
+         * allocator.
+         *
+         * @param allocator The allocator of the parser, must outlive the
+         * builder.
+         * @param options Decides if strings and keys are borrowed.
+         */
+        JsonDomBuilder(json_allocator &allocator, JsonParseOptions options) : allocator_(allocator), options_(options), depth_(0), root_(nullptr), created_(0), interner_(options.key_interner) {
+          // Keys interned for this document only must live as long as the
+          // document, i.e. in its arena. Without an arena every object would
+          // copy them again, so they are not interned at all.
+          if constexpr (json_has_arena<json_allocator>::value) {
+            if (!interner_ && options.intern_keys) {
+              own_interner_.reset(new JsonKeyInterner(false,&allocator.arena()));
+              interner_ = own_interner_.get();
+            }
+          }
+        }
+
+        JsonDomBuilder(const JsonDomBuilder &) = delete;
+        JsonDomBuilder &operator=(const JsonDomBuilder &) = delete;
+
+        /**
+         * @brief Releases everything which was not taken.
+         */
+        ~JsonDomBuilder() {
+          for (std::size_t i = 0; i < depth_; i++)
+            allocator_.destroy(frames_[i].container);
+          if (root_)
+            allocator_.destroy(root_);
+        }
+
+        bool null() {
+          return add(JsonBase(allocator_.child(),nullptr));
+        }
+
+        bool boolean(bool value) {
+          return add(JsonBase(allocator_.child(),value));
+        }
+
+        bool integer(long long value) {
+          return add(JsonBase(allocator_.child(),value));
+        }
+
+        bool floating(double value) {
+          return add(JsonBase(allocator_.child(),value));
+        }
+
+        /**
+         * @brief Creates a borrowed string or an unescaped copy depending on
+         * the options.
+         */
+        bool raw_string(std::string_view raw, bool has_escapes) {
+          // Reference the string inside the parsed buffer if allowed.
+          if (options_.borrow_strings)
+            return add(JsonBase(allocator_.child(),create<JsonImplBorrowedString>(raw,has_escapes)));
+
+          string_type content(allocator_.template stl<char>());
+          if (has_escapes)
+            json_unescape(raw,content);
+          else
+            content.assign(raw.data(),raw.size());
+          return add(JsonBase(allocator_.child(),create<JsonImplString>(std::move(content))));
+        }
+
+        /**
+         * @brief Remembers the key for the next value, keys without escapes
+         * are borrowed if the options allow it.
+         */
+        bool raw_key(std::string_view raw, bool has_escapes) {
+          Frame &frame = frames_[depth_-1];
+          frame.key_borrowed = options_.borrow_strings && !has_escapes;
+          if (frame.key_borrowed)
+            frame.key = raw;
+          else {
+            frame.key_buffer.clear();
+            json_unescape(raw,frame.key_buffer);
+          }
+          return true;
+        }
+
+        /**
+         * @brief Creates a copy of the unescaped string.
+         */
+        bool string(std::string_view value) {
+          string_type content(value.data(),value.size(),allocator_.template stl<char>());
+          return add(JsonBase(allocator_.child(),create<JsonImplString>(std::move(content))));
+        }
+
+        /**
+         * @brief Remembers a copy of the unescaped key for the next value.
+         */
+        bool key(std::string_view key) {
+          Frame &frame = frames_[depth_-1];
+          frame.key_borrowed = false;
+          frame.key_buffer.assign(key.data(),key.size());
+          return true;
+        }
+
+        bool start_object() {
+          JsonImplObject *object = create<JsonImplObject>(allocator_);
+          if constexpr (std::is_same<JsonImplObject, JsonImplShapedObject>::value) {
+            if (depth_ > 0 && !frames_[depth_-1].is_object)
+              frames_[depth_-1].shapes.start(object);
+          }
+          return push(object,true);
+        }
+
+        bool end_object() {
+          return close();
+        }
+
+        bool start_array() {
+          return push(create<JsonImplArray>(allocator_),false);
+        }
+
+        bool end_array() {
+          return close();
+        }
+
+        /**
+         * @brief Returns the parsed json. After a parse error all open
+         * containers are closed and the partial json is returned, an empty
+         * object if there is no value at all.
+         *
+         * @return The root value.
+         */
+        JsonBase take() {
+          while (depth_ > 0)
+            close();
+          if (!root_)
+            return JsonBase(allocator_.child());
+          JsonBase ret(std::move(*root_));
+          allocator_.destroy(root_);
+          root_ = nullptr;
+          return ret;
+        }
+
+        /**
+         * @brief Returns the number of nodes created with the allocator, only
+         * counted from JsonLogLevel::log_stats on.
+         */
+        std::size_t created() const {
+          return created_;
+        }
+
+      private:
+        /**
+         * @brief Creates a node with the allocator and counts it.
+         */
+        template<typename T, typename... Args>
+        T *create(Args&&... args) {
+          if constexpr (log_level >= JsonLogLevel::log_stats)
+            ++created_;
+          return allocator_.template create<T>(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief An open object or array.
+         */
+        struct Frame {
+          JsonInterface *container;  ///< The JsonImplObject or JsonImplArray
+          bool is_object;            ///< True for objects
+          bool key_borrowed;         ///< True if key references the parsed json
+          std::string_view key;      ///< The key of the next attribute if it is borrowed
+          std::string key_buffer;    ///< Holds the unescaped key otherwise, kept to reuse the memory
+          JsonShapeSharing shapes;   ///< Shares the keys of the objects of an array
+        };
+
+        /**
+         * @brief Opens a new container, the frames are reused to keep the
+         * memory of the key buffers.
+         */
+        bool push(JsonInterface *container, bool is_object) {
+          if (depth_ == frames_.size())
+            frames_.emplace_back();
+          frames_[depth_].container = container;
+          frames_[depth_].is_object = is_object;
+          frames_[depth_].shapes = JsonShapeSharing();
+          ++depth_;
+          return true;
+        }
+
+        /**
+         * @brief Closes the innermost container and adds it to its parent.
+         */
+        bool close() {
+          Frame &frame = frames_[--depth_];
+          if constexpr (std::is_same<JsonImplObject, JsonImplShapedObject>::value) {
+            if (frame.is_object && depth_ > 0 && !frames_[depth_-1].is_object)
+              frames_[depth_-1].shapes.end(static_cast<JsonImplObject*>(frame.container));
+          }
+          return add(JsonBase(allocator_.child(),frame.is_object ? Storage::object : Storage::array,frame.container));
+        }
+
+        /**
+         * @brief Adds the completed value to the innermost container or makes
+         * it the root.
+         */
+        bool add(JsonBase &&value) {
+          if (depth_ == 0) {
+            root_ = create<JsonBase>(std::move(value));
+            return true;
+          }
+          Frame &frame = frames_[depth_-1];
+          if (frame.is_object) {
+            // The buffer may have moved since the key was parsed, the view is
+            // therefore only taken now.
+            std::string_view key = frame.key_borrowed ? frame.key : std::string_view(frame.key_buffer);
+            if (interner_)
+              static_cast<JsonImplObject*>(frame.container)->insert_attribute(interner_->intern(key),true,std::move(value));
+            else
+              static_cast<JsonImplObject*>(frame.container)->insert_attribute(key,frame.key_borrowed,std::move(value));
+          }
+          else
+            static_cast<JsonImplArray*>(frame.container)->push(std::move(value));
+          return true;
+        }
+
+        json_allocator &allocator_;  ///< The allocator of all values
+        JsonParseOptions options_;   ///< The options of the parser
+        std::vector<Frame> frames_;  ///< The open containers up to depth_, the innermost last
+        std::size_t depth_;          ///< The number of open containers
+        JsonBase *root_;             ///< The completed root value or nullptr
+        std::size_t created_;        ///< The number of created nodes
+        JsonKeyInterner *interner_;  ///< Interns all keys or nullptr
+        std::unique_ptr<JsonKeyInterner> own_interner_;  ///< The interner of this document if none is shared
+    };
+
+    /**
+     * @brief Parses a json which arrives in chunks of arbitrary size. The
+     * parser keeps an explicit stack of the open objects and arrays instead of
+     * recursing and can suspend anywhere, also inside strings and numbers.
+     *
+     * For example:
+     * ```
+     * Json::JsonStreamParser parser;
+     * while (receive(chunk))
+     *   parser.feed(chunk);
+     * parser.finish();
+     * Json js = parser.result();
+     * ```
+     */
+    class JsonStreamParser {
+      public:
+        using JsonParserError = typename JsonParser::JsonParserError;
+
+        /**
+         * @brief Creates a parser waiting for the first chunk.
+         *
+         * @param max_depth Deeper nested objects and arrays stop parsing with
+         * JsonParserError::exceeded_max_depth.
+         */
+        explicit JsonStreamParser(std::size_t max_depth = JsonParseOptions().max_depth) : root_(nullptr), state_(State::value), error_(JsonParserError::ok), position_(0), escape_(false), has_escapes_(false), is_key_(false), max_depth_(max_depth) {
+        }
+
+        JsonStreamParser(const JsonStreamParser &) = delete;
+        JsonStreamParser &operator=(const JsonStreamParser &) = delete;
+
+        /**
+         * @brief Releases the parsed values which were not taken by result().
+         */
+        ~JsonStreamParser() {
+          for (auto &frame : frames_)
+            allocator_.destroy(frame.container);
+          if (root_)
+            allocator_.destroy(root_);
+        }
+
+        /**
+         * @brief Parses the next chunk of the json, the chunk may end anywhere
+         * and does not need to outlive this call.
+         *
+         * @param chunk The next bytes of the json.
+         *
+         * @return False if there has been a parse error.
+         */
+        bool feed(std::string_view chunk) {
+          const char *it = chunk.data();
+          const char *end = it + chunk.size();
+          while (it != end && error_ == JsonParserError::ok) {
+            switch (state_) {
+              case State::string:
+                it = feed_string(it,end);
+                break;
+              case State::number:
+                it = feed_number(it,end);
+                break;
+              case State::literal:
+                it = feed_literal(it,end);
+                break;
+              default:
+                if (JsonParser::is_whitespace(*it))
+                  ++it;
+                else if (structural(*it) && error_ == JsonParserError::ok)
+                  ++it;
+            }
+          }
+          position_ += it - chunk.data();
+          return error_ == JsonParserError::ok;
+        }
+
+        /**
+         * @brief Signals the end of the json, completes a number or literal at
+         * the very end and checks that the json is complete.
+         *
+         * @return False if there has been a parse error.
+         */
+        bool finish() {
+          if (error_ != JsonParserError::ok)
+            return false;
+          if (state_ == State::string)
+            error_ = JsonParserError::expected_closing_quote_but_got_eos;
+          else if (state_ == State::number)
+            finish_number();
+          else if (state_ == State::literal)
+            finish_literal();
+
+          if (error_ == JsonParserError::ok && state_ != State::done) {
+            if (state_ == State::value && frames_.empty())
+              error_ = JsonParserError::expected_beginning_of_string_int_object_or_array_null_float;
+            else
+              error_ = JsonParserError::unexpected_end_of_json;
+          }
+          return error_ == JsonParserError::ok;
+        }
+
+        /**
+         * @brief Checks if the root value is complete.
+         *
+         * @return True if the complete json has been parsed.
+         */
+        bool done() {
+          return state_ == State::done;
+        }
+
+        /**
+         * @brief Checks if there has been a parse error.
+         *
+         * @return True if there has been a parse error false otherwise.
+         */
+        bool parse_error() {
+          return error_ != JsonParserError::ok;
+        }
+
+        /**
+         * @brief Returns the current parse error.
+         */
+        JsonParserError error() {
+          return error_;
+        }
+
+        /**
+         * @brief Converts the current parse error into a string
+         *
+         * @return The string version of the error code.
+         */
+        std::string get_error_string() {
+          return JsonParser::error_string(error_);
+        }
+
+        /**
+         * @brief Returns the number of consumed bytes, on an error the position
+         * of the offending character.
+         */
+        std::size_t position() {
+          return position_;
+        }
+
+        /**
+         * @brief Moves the parsed json out of the parser. If the json is not
+         * complete or invalid an empty object with JsonError::parse_error set
+         * is returned.
+         *
+         * @return The parsed json, owns the memory of the whole document.
+         */
+        JsonBase result() {
+          if (error_ != JsonParserError::ok || !root_) {
+            JsonBase ret;
+            ret.set_error(JsonError::parse_error);
+            return ret;
+          }
+          JsonBase ret(std::move(*root_));
+          allocator_.destroy(root_);
+          root_ = nullptr;
+          ret.allocator_.adopt(allocator_);
+          return ret;
+        }
+
+      private:
+        /**
+         * @brief What the parser expects next.
+         */
+        enum class State : unsigned char {
+          value,          ///< Any value
+          array_value,    ///< A value or the end of the array
+          object_key,     ///< An attribute key or the end of the object
+          object_colon,   ///< The colon behind the key
+          after_value,    ///< A comma or the end of the container
+          string,         ///< Inside a string, token_ collects the raw characters
+          number,         ///< Inside a number, token_ collects the characters
+          literal,        ///< Inside true, false or null
+          done,           ///< The root value is complete
+        };
+
+        /**
+         * @brief An open object or array.
+         */
+        struct Frame {
+          JsonInterface *container;  ///< The JsonImplObject or JsonImplArray
+          bool is_object;            ///< True for objects
+          std::string key;           ///< The key of the next attribute of an object
+        };
+
+        /**
+         * @brief Handles a character outside of strings, numbers and literals.
+         *
+         * @return True if the character is consumed, false if it starts a
+         * number or a literal.
+         */
+        bool structural(char c) {
+          switch (state_) {
+            case State::object_key:
+              if (c == '}')
+                close();
+              else if (c == '"')
+                begin_string(true);
+              else if (c == ',')
+                error_ = JsonParserError::expected_attribute_but_got_comma;
+              else
+                error_ = JsonParserError::expected_string_attribute_key;
+              return true;
+            case State::object_colon:
+              if (c == ':')
+                state_ = State::value;
+              else
+                error_ = JsonParserError::expected_colon_but_got_different_character_instead;
+              return true;
+            case State::after_value:
+              if (frames_.back().is_object) {
+                if (c == ',')
+                  state_ = State::object_key;
+                else if (c == '}')
+                  close();
+                else
+                  error_ = JsonParserError::expected_comma_before_next_attribute;
+              }
+              else {
+                if (c == ',')
+                  state_ = State::array_value;
+                else if (c == ']')
+                  close();
+                else
+                  error_ = JsonParserError::expected_comma_before_next_array_item;
+              }
+              return true;
+            case State::done:
+              error_ = JsonParserError::unexpected_character_after_json;
+              return true;
+            case State::array_value:
+              if (c == ']') {
+                close();
+                return true;
+              }
+              if (c == ',') {
+                error_ = JsonParserError::expected_comma_before_next_array_item;
+                return true;
+              }
+              return begin_value(c);
+            default:
+              return begin_value(c);
+          }
+        }
+
+        /**
+         * @brief Starts the value beginning with c.
+         *
+         * @return True if the character is consumed.
+         */
+        bool begin_value(char c) {
+          if ((c == '{' || c == '[') && frames_.size() >= max_depth_) {
+            error_ = JsonParserError::exceeded_max_depth;
+            return true;
+          }
+          switch (c) {
+            case '{':
+              frames_.push_back(Frame{allocator_.template create<JsonImplObject>(allocator_),true,std::string()});
+              state_ = State::object_key;
+              return true;
+            case '[':
+              frames_.push_back(Frame{allocator_.template create<JsonImplArray>(allocator_),false,std::string()});
+              state_ = State::array_value;
+              return true;
+            case '"':
+              begin_string(false);
+              return true;
+            case 't':
+            case 'f':
+            case 'n':
+              token_.clear();
+              state_ = State::literal;
+              return false;
+            default:
+              if ((c >= '0' && c <= '9') || c == '-') {
+                token_.clear();
+                state_ = State::number;
+                return false;
+              }
+              error_ = JsonParserError::expected_beginning_of_string_int_object_or_array_null_float;
+              return true;
+          }
+        }
+
+        /**
+         * @brief Starts a string after the opening quote.
+         *
+         * @param is_key True if the string is an attribute key.
+         */
+        void begin_string(bool is_key) {
+          token_.clear();
+          escape_ = false;
+          has_escapes_ = false;
+          is_key_ = is_key;
+          state_ = State::string;
+        }
+
+        /**
+         * @brief Collects the characters of a string, runs without escapes
+         * are copied at once.
+         *
+         * @return The first character which is not consumed.
+         */
+        const char *feed_string(const char *it, const char *end) {
+          for (;;) {
+            if (escape_) {
+              if (it == end)
+                return it;
+              token_.push_back(*it++);
+              escape_ = false;
+            }
+            const char *stop = json_find_quote_or_backslash(it,end);
+            token_.append(it,stop-it);
+            it = stop;
+            if (it == end)
+              return it;
+            if (*it == '\\') {
+              token_.push_back(*it++);
+              escape_ = true;
+              has_escapes_ = true;
+              continue;
+            }
+            // The closing quote
+            finish_string();
+            return it+1;
+          }
+        }
+
+        /**
+         * @brief Completes the string value or key collected in token_.
+         */
+        void finish_string() {
+          std::string content;
+          if (has_escapes_)
+            json_unescape(std::string_view(token_),content);
+          else
+            content = token_;
+
+          if (is_key_) {
+            // Empty keys are invalid in the Json standard.
+            if (content.empty())
+              error_ = JsonParserError::expected_string_attribute_key;
+            frames_.back().key = std::move(content);
+            state_ = State::object_colon;
+          }
+          else
+            complete(JsonBase(allocator_.child(),std::move(content)));
+        }
+
+        /**
+         * @brief Collects the characters of a number.
+         *
+         * @return The first character which is not consumed.
+         */
+        const char *feed_number(const char *it, const char *end) {
+          while (it != end && ((*it >= '0' && *it <= '9') || *it == '-' || *it == '+' || *it == '.' || *it == 'e' || *it == 'E'))
+            token_.push_back(*it++);
+          if (it != end)
+            finish_number();
+          return it;
+        }
+
+        /**
+         * @brief Completes the number collected in token_.
+         */
+        void finish_number() {
+          const char *begin = token_.data();
+          const char *end = begin + token_.size();
+          JsonNumber number;
+          if (json_parse_number(begin,end,number) != end) {
+            error_ = JsonParserError::expected_int_or_double;
+            return;
+          }
+          if (number.is_float)
+            complete(JsonBase(allocator_.child(),number.floating));
+          else
+            complete(JsonBase(allocator_.child(),number.integer));
+        }
+
+        /**
+         * @brief Collects the letters of true, false or null.
+         *
+         * @return The first character which is not consumed.
+         */
+        const char *feed_literal(const char *it, const char *end) {
+          while (it != end && *it >= 'a' && *it <= 'z' && token_.size() < 5)
+            token_.push_back(*it++);
+          if (it != end)
+            finish_literal();
+          return it;
+        }
+
+        /**
+         * @brief Completes the literal collected in token_.
+         */
+        void finish_literal() {
+          if (token_ == "true")
+            complete(JsonBase(allocator_.child(),true));
+          else if (token_ == "false")
+            complete(JsonBase(allocator_.child(),false));
+          else if (token_ == "null")
+            complete(JsonBase(allocator_.child(),nullptr));
+          else
+            error_ = JsonParserError::expected_beginning_of_string_int_object_or_array_null_float;
+        }
+
+        /**
+         * @brief Closes the innermost object or array.
+         */
+        void close() {
+          Frame frame = std::move(frames_.back());
+          frames_.pop_back();
+          complete(JsonBase(allocator_.child(),frame.is_object ? Storage::object : Storage::array,frame.container));
+        }
+
+        /**
+         * @brief Adds the completed value to the innermost container or makes
+         * it the root.
+         *
+         * @param value The completed value.
+         */
+        void complete(JsonBase &&value) {
+          if (frames_.empty()) {
+            root_ = allocator_.template create<JsonBase>(std::move(value));
+            state_ = State::done;
+            return;
+          }
+          Frame &frame = frames_.back();
+          if (frame.is_object)
+            static_cast<JsonImplObject*>(frame.container)->insert_attribute(frame.key,false,std::move(value));
+          else
+            static_cast<JsonImplArray*>(frame.container)->push(std::move(value));
+          state_ = State::after_value;
+        }
+
+        json_allocator allocator_;   ///< Owns the memory of all parsed values until it is handed to the result
+        std::vector<Frame> frames_;  ///< The open objects and arrays, the innermost last
+        JsonBase *root_;             ///< The completed root value or nullptr
+        State state_;                ///< What the parser expects next
+        JsonParserError error_;      ///< The first parse error, stops the parser
+        std::size_t position_;       ///< The number of consumed bytes
+        std::string token_;          ///< The characters of the current string, number or literal
+        bool escape_;                ///< True if the last character of the string was a backslash
+        bool has_escapes_;           ///< True if the current string contains escape sequences
+        bool is_key_;                ///< True if the current string is an attribute key
+        std::size_t max_depth_;      ///< The maximum number of open objects and arrays
+    };
+
+
+
+    /**
+     * @brief Decodes CBOR (RFC 8949) and reports the items with the same calls
+     * as the json parser, e.g. to JsonDomBuilder. Numbers and strings are
+     * copied out of the binary data directly, nothing has to be parsed or
+     * unescaped. Tags are ignored, byte strings are treated as text strings,
+     * undefined as null and map keys must be strings.
+     */
+    class JsonCborParser {
+      public:
+        using JsonParserError = typename JsonParser::JsonParserError;
+
+        /**
+         * @brief Creates the parser for exactly one CBOR item.
+         *
+         * @param data The encoded item, must outlive the parser.
+         * @param max_depth Deeper nested arrays, maps and tags stop decoding
+         * with JsonParserError::exceeded_max_depth.
+         */
+        explicit JsonCborParser(std::string_view data, std::size_t max_depth = JsonParseOptions().max_depth) : data_(data), pos_(0), error_(JsonParserError::ok), depth_(0), max_depth_(max_depth) {
+        }
+
+        /**
+         * @brief Decodes the item and reports it to the handler. Contiguous
+         * strings go to raw_string/raw_key(view,false) if the handler has
+         * them, strings of several chunks and strings that need escaping in
+         * json always go to string/key.
+         *
+         * @return False if there has been an error or the handler aborted.
+         */
+        template<typename Handler>
+        bool parse_events(Handler &handler) {
+          if (!parse_item(handler))
+            return false;
+          if (pos_ != data_.size())
+            return fail(JsonParserError::unexpected_character_after_json);
+          return true;
+        }
+
+        /**
+         * @brief Returns true if decoding failed.
+         */
+        bool parse_error() {
+          return error_ != JsonParserError::ok;
+        }
+
+        /**
+         * @brief Returns the error which stopped decoding.
+         */
+        JsonParserError error() {
+          return error_;
+        }
+
+        /**
+         * @brief Returns the description of the error.
+         */
+        std::string get_error_string() {
+          return JsonParser::error_string(error_);
+        }
+
+        /**
+         * @brief Returns the number of consumed bytes.
+         */
+        std::size_t position() {
+          return pos_;
+        }
+
+      private:
+        bool fail(JsonParserError error) {
+          if (error_ == JsonParserError::ok)
+            error_ = error;
+          return false;
+        }
+
+        bool call(bool handler_result) {
+          return handler_result || fail(JsonParserError::aborted_by_handler);
+        }
+
+        /**
+         * @brief Reads the initial byte and the argument of the next item.
+         *
+         * @param info Set to the low five bits, 31 for indefinite lengths.
+         */
+        bool read_head(int &major, int &info, std::uint64_t &argument) {
+          if (pos_ >= data_.size())
+            return fail(JsonParserError::unexpected_end_of_json);
+          unsigned char initial = (unsigned char)data_[pos_++];
+          major = initial >> 5;
+          info = initial & 31;
+          argument = (std::uint64_t)info;
+          if (info < 24 || info == 31)
+            return true;
+          if (info > 27)
+            return fail(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
+          std::size_t bytes = std::size_t(1) << (info-24);
+          if (data_.size()-pos_ < bytes)
+            return fail(JsonParserError::unexpected_end_of_json);
+          argument = 0;
+          for (std::size_t i = 0; i < bytes; i++)
+            argument = (argument << 8) | (unsigned char)data_[pos_++];
+          return true;
+        }
+
+        /**
+         * @brief Returns true at the break byte of an indefinite container
+         * and consumes it.
+         */
+        bool at_break() {
+          if (pos_ < data_.size() && (unsigned char)data_[pos_] == 0xff) {
+            pos_++;
+            return true;
+          }
+          return false;
+        }
+
+        /**
+         * @brief Converts a half precision float.
+         */
+        static double half_to_double(std::uint64_t half) {
+          int exponent = (int)((half >> 10) & 0x1f);
+          double mantissa = (double)(half & 0x3ff);
+          double value;
+          if (exponent == 0)
+            value = std::ldexp(mantissa,-24);
+          else if (exponent == 31)
+            value = mantissa == 0 ? HUGE_VAL : NAN;
+          else
+            value = std::ldexp(mantissa+1024,exponent-25);
+          return (half & 0x8000) ? -value : value;
+        }
+
+        template<typename Handler>
+        bool parse_item(Handler &handler) {
+          int major, info;
+          std::uint64_t argument;
+          if (!read_head(major,info,argument))
+            return false;
+          if (info == 31 && (major < 2 || major == 6))
+            return fail(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
+
+          switch (major) {
+            case 0:
+              if (argument <= (std::uint64_t)LLONG_MAX)
+                return call(handler.integer((long long)argument));
+              return call(handler.floating((double)argument));
+            case 1:
+              if (argument <= (std::uint64_t)LLONG_MAX)
+                return call(handler.integer(-1-(long long)argument));
+              return call(handler.floating(-1.0-(double)argument));
+            case 2:
+            case 3:
+              return parse_string(handler,major,info,argument,false);
+            case 4:
+              if (depth_++ >= max_depth_)
+                return fail(JsonParserError::exceeded_max_depth);
+              if (!call(handler.start_array()))
+                return false;
+              if (info == 31) {
+                while (!at_break())
+                  if (!parse_item(handler))
+                    return false;
+              }
+              else {
+                for (std::uint64_t i = 0; i < argument; i++)
+                  if (!parse_item(handler))
+                    return false;
+              }
+              --depth_;
+              return call(handler.end_array());
+            case 5:
+              if (depth_++ >= max_depth_)
+                return fail(JsonParserError::exceeded_max_depth);
+              if (!call(handler.start_object()))
+                return false;
+              for (std::uint64_t i = 0; info == 31 ? !at_break() : i < argument; i++) {
+                int key_major, key_info;
+                std::uint64_t key_argument;
+                if (!read_head(key_major,key_info,key_argument))
+                  return false;
+                if (key_major != 2 && key_major != 3)
+                  return fail(JsonParserError::expected_string_attribute_key);
+                if (!parse_string(handler,key_major,key_info,key_argument,true) || !parse_item(handler))
+                  return false;
+              }
+              --depth_;
+              return call(handler.end_object());
+            case 6: {
+              // Tags are skipped but still recurse.
+              if (depth_++ >= max_depth_)
+                return fail(JsonParserError::exceeded_max_depth);
+              bool ret = parse_item(handler);
+              --depth_;
+              return ret;
+            }
+            default:
+              break;
+          }
+
+          switch (info) {
+            case 20:
+              return call(handler.boolean(false));
+            case 21:
+              return call(handler.boolean(true));
+            case 22:
+            case 23:
+              return call(handler.null());
+            case 25:
+              return call(handler.floating(half_to_double(argument)));
+            case 26: {
+              std::uint32_t bits = (std::uint32_t)argument;
+              float value;
+              std::memcpy(&value,&bits,4);
+              return call(handler.floating(value));
+            }
+            case 27: {
+              double value;
+              std::memcpy(&value,&argument,8);
+              return call(handler.floating(value));
+            }
+            default:
+              return fail(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
+          }
+        }
+
+        /**
+         * @brief Returns true if the string can be used as the content of a
+         * json string as is.
+         */
+        static bool is_json_safe(std::string_view view) {
+          for (char c : view)
+            if ((unsigned char)c < 0x20 || c == '"' || c == '\\')
+              return false;
+          return true;
+        }
+
+        template<typename Handler>
+        bool parse_string(Handler &handler, int major, int info, std::uint64_t argument, bool is_key) {
+          std::string_view view;
+          if (info != 31) {
+            if (argument > data_.size()-pos_)
+              return fail(JsonParserError::unexpected_end_of_json);
+            view = data_.substr(pos_,(std::size_t)argument);
+            pos_ += (std::size_t)argument;
+            if constexpr (json_has_raw_strings<Handler>::value) {
+              if (is_json_safe(view))
+                return call(is_key ? handler.raw_key(view,false) : handler.raw_string(view,false));
+            }
+          }
+          else {
+            // Indefinite strings are a sequence of definite chunks.
+            scratch_.clear();
+            while (!at_break()) {
+              int chunk_major, chunk_info;
+              std::uint64_t chunk_argument;
+              if (!read_head(chunk_major,chunk_info,chunk_argument))
+                return false;
+              if (chunk_major != major || chunk_info == 31)
+                return fail(JsonParserError::expected_closing_quote_but_got_eos);
+              if (chunk_argument > data_.size()-pos_)
+                return fail(JsonParserError::unexpected_end_of_json);
+              scratch_.append(data_.data()+pos_,(std::size_t)chunk_argument);
+              pos_ += (std::size_t)chunk_argument;
+            }
+            view = scratch_;
+          }
+          return call(is_key ? handler.key(view) : handler.string(view));
+        }
+
+        std::string_view data_;  ///< The encoded item
+        std::size_t pos_;        ///< The number of consumed bytes
+        JsonParserError error_;  ///< The first error, stops decoding
+        std::size_t depth_;      ///< The number of open arrays, maps and tags
+        std::size_t max_depth_;  ///< The maximum of depth_
+        std::string scratch_;    ///< Joins the chunks of indefinite strings
+    };
+
+    /**
+     * @brief Decodes CBOR into a JSON DOM object.
+     *
+     * @param data The encoded json.
+     * @param on_error The callback to call when there is an error.
+     * @param options With borrow_strings set strings and keys reference data,
+     * which must then outlive the returned json.
+     *
+     * @return Returns the decoded json in dom format.
+     */
+    template<typename OnError>
+    static JsonBase parse_cbor(std::string_view data,OnError &&on_error,JsonParseOptions options=JsonParseOptions()) {
+      json_allocator allocator;
+      JsonCborParser parser(data,options.max_depth);
+      JsonDomBuilder builder(allocator,options);
+      parser.parse_events(builder);
+      JsonBase base(builder.take());
+      // The resulting json owns the memory of the whole document from now on.
+      base.allocator_.adopt(allocator);
+      if (parser.parse_error()) {
+        on_error(parser);
+        base.set_error(JsonError::parse_error);
+      }
+      return base;
+    }
+
+    /**
+     * @brief Decodes CBOR and reports every item to the handler like
+     * parse_events(...).
+     *
+     * @param data The encoded json.
+     * @param handler Receives the events.
+     *
+     * @return JsonParserError::ok or the error which stopped decoding.
+     */
+    template<typename Handler>
+    static typename JsonParser::JsonParserError parse_cbor_events(std::string_view data, Handler &handler) {
+      JsonCborParser parser(data);
+      parser.parse_events(handler);
+      return parser.error();
+    }
+
+      /**
+       * @brief Parses any json string into a JSON DOM object
+       *
+       * @param view The json string to parse
+       * @param on_error The callback to call when there is an error.
+       * @param options The options to parse the json with, with
+       * borrow_strings set the view must outlive the returned json.
+       *
+       * @return Returns the parsed json in dom format.
+       */
+    template<typename OnError>
+    static JsonBase parse(std::string_view view,OnError &&on_error,JsonParseOptions options=JsonParseOptions()) {
+      JsonParseStats stats;
+      return parse(view,std::forward<OnError>(on_error),options,stats);
+    }
+
+    /**
+     * @brief Parses any json string into a JSON DOM object and returns the
+     * statistics of the parse, which are only collected with a log level of
+     * JsonLogLevel::log_stats or higher.
+     *
+     * @param view The json string to parse
+     * @param on_error The callback to call when there is an error.
+     * @param options The options to parse the json with.
+     * @param stats Receives the statistics.
+     *
+     * @return Returns the parsed json in dom format.
+     */
+    template<typename OnError>
+    static JsonBase parse(std::string_view view,OnError &&on_error,JsonParseOptions options,JsonParseStats &stats) {
+      JsonParser parser(view,0,options);
+      JsonBase base(parser.parse());
+      // The resulting json owns the memory of the whole document from now on.
+      base.allocator_.adopt(parser.allocator_);
+      stats = parser.stats();
+
+      if (parser.parse_error()) {
+        if constexpr (log_level >= JsonLogLevel::log_error)
+          log_functor("Json parse error at position " + std::to_string(parser.abs_pos_) + ": " + parser.get_error_string());
+        on_error(parser);
+        base.set_error(JsonError::parse_error);
+      }
+      if constexpr (log_level >= JsonLogLevel::log_trace)
+        log_functor("Json parsed " + stats.to_string());
+
+      return std::move(base);
+    }
+
+    /**
+     * @brief A read only view of a parsed json. All functions are const,
+     * return their result by value and write nothing, neither the sticky
+     * error of the json nor packed arrays or shared copies, so any number of
+     * threads can read one document at the same time without locking. A
+     * lookup which fails returns a view with the error set. The json must
+     * outlive the view and must not be changed or accessed through its non
+     * const functions, e.g. get(...), while it is read.
+     */
+    class JsonReader {
+      public:
+        /**
+         * @brief Creates a view of the json, the view starts with the error
+         * of the json.
+         *
+         * @param json The json to read.
+         */
+        explicit JsonReader(const JsonBase &json) : JsonReader(&json,json.last_error_) {
+        }
+
+        /**
+         * @brief Returns the type of the value, for invalid values
+         * JsonType::null.
+         */
+        JsonType type() const {
+          if (error_ != JsonError::ok)
+            return JsonType::null;
+          if (!node_)
+            return scalar_;
+          switch (node_->storage_) {
+            case Storage::null:       return JsonType::null;
+            case Storage::boolean:    return JsonType::boolean;
+            case Storage::integer:    return JsonType::integer;
+            case Storage::floating:   return JsonType::floating_point;
+            case Storage::array:      return JsonType::array;
+            case Storage::object:     return JsonType::object;
+            default:                  return node_->interface_->type();
+          }
+        }
+
+        /**
+         * @brief Returns the error of the lookup which created this value.
+         */
+        JsonError error() const {
+          return error_;
+        }
+
+        /**
+         * @brief Returns true if the value is invalid.
+         */
+        bool has_error() const {
+          return error_ != JsonError::ok;
+        }
+
+        /**
+         * @brief Returns the number of items of an array or attributes of an
+         * object, 1 for all other values.
+         */
+        int size() const {
+          if (!node_)
+            return 1;
+          if (node_->storage_ == Storage::array)
+            return static_cast<JsonImplArray*>(node_->interface_)->size();
+          if (node_->storage_ == Storage::object)
+            return static_cast<JsonImplObject*>(node_->interface_)->size();
+          if (node_->storage_ == Storage::interface)
+            return node_->interface_->size();
+          return 1;
+        }
+
+        /**
+         * @brief Returns the attribute with the given key, if this is not an
+         * object or the key does not exist the returned value has an error set.
+         *
+         * @param key The key to search for.
+         */
+        JsonReader get(std::string_view key) const {
+          if (has_error())
+            return *this;
+          JsonInterface *iface = value_interface();
+          if (!iface)
+            return with_error(JsonError::not_implemented);
+          JsonError err = JsonError::ok;
+          JsonBase *ret = node_->storage_ == Storage::object ? static_cast<JsonImplObject*>(iface)->get(key,err) : iface->get(std::string(key),err);
+          if (err != JsonError::ok)
+            return with_error(err);
+          return JsonReader(ret,JsonError::ok);
+        }
+
+        /**
+         * @brief Returns the attribute with the already hashed key, see
+         * JsonBase::get(const JsonKey&).
+         *
+         * @param key The key, e.g. from JsonKeyInterner::intern(...).
+         */
+        JsonReader get(const JsonKey &key) const {
+          if (has_error())
+            return *this;
+          if (!node_ || node_->storage_ != Storage::object)
+            return with_error(JsonError::not_implemented);
+          JsonError err = JsonError::ok;
+          JsonBase *ret = static_cast<JsonImplObject*>(node_->interface_)->get(key,err);
+          if (err != JsonError::ok)
+            return with_error(err);
+          return JsonReader(ret,JsonError::ok);
+        }
+
+        /**
+         * @brief Returns the item at the given index, if this is not an array or
+         * the index is out of range the returned value has an error set. Packed
+         * numbers are read in place.
+         *
+         * @param index The index of the item.
+         */
+        JsonReader get(int index) const {
+          if (has_error())
+            return *this;
+          JsonInterface *iface = value_interface();
+          if (!iface)
+            return with_error(JsonError::not_implemented);
+          if (node_->storage_ != Storage::array) {
+            JsonError err = JsonError::ok;
+            JsonBase *ret = iface->get(index,err);
+            if (err != JsonError::ok)
+              return with_error(err);
+            return JsonReader(ret,JsonError::ok);
+          }
+          auto array = static_cast<JsonImplArray*>(iface);
+          if (index < 0 || index >= array->size())
+            return with_error(JsonError::does_not_exist);
+          auto integers = array->packed_integers();
+          if (!integers.empty())
+            return number(integers[index]);
+          auto floats = array->packed_floats();
+          if (!floats.empty())
+            return array->packed_is_integer(index) ? number((long long)floats[index]) : number(floats[index]);
+          return JsonReader(&array->item(index),JsonError::ok);
+        }
+
+        /**
+         * @brief Returns the value referenced by the json pointer.
+         *
+         * @param path The compiled json pointer.
+         */
+        JsonReader get(const JsonPath &path) const {
+          if (!path.valid())
+            return with_error(JsonError::does_not_exist);
+          JsonReader current(*this);
+          for (std::size_t i = 0; i < path.size() && !current.has_error(); i++)
+            current = current.type() == JsonType::array ? current.get(path[i].index) : current.get(std::string_view(path[i].key));
+          return current;
+        }
+
+        /**
+         * @brief Executes the given function if the value is a string.
+         *
+         * @param func The function to call with the string, with a
+         * std::string_view of the stored characters if it accepts one and
+         * there is nothing to unescape, otherwise with a copy.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        const JsonReader &map_string(Func &&func) const {
+          JsonInterface *iface = value_interface();
+          if (!iface)
+            return *this;
+          if constexpr (std::is_invocable<Func&,std::string_view>::value) {
+            std::string_view view;
+            if (iface->to_string_view(view)) {
+              func(view);
+              return *this;
+            }
+          }
+          JsonError err = JsonError::ok;
+          std::string tmp = iface->to_string(err);
+          if (err == JsonError::ok)
+            func(tmp);
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function if the value is an integer.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        const JsonReader &map_int(Func &&func) const {
+          if (has_error())
+            return *this;
+          if (!node_) {
+            if (scalar_ == JsonType::integer)
+              func((int)integer_);
+            return *this;
+          }
+          if (node_->storage_ == Storage::integer) {
+            func((int)node_->integer_);
+            return *this;
+          }
+          JsonInterface *iface = value_interface();
+          JsonError err = JsonError::ok;
+          int tmp = iface ? iface->to_int(err) : 0;
+          if (iface && err == JsonError::ok)
+            func(tmp);
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function if the value is a boolean.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        const JsonReader &map_bool(Func &&func) const {
+          if (has_error() || !node_)
+            return *this;
+          if (node_->storage_ == Storage::boolean) {
+            func(node_->boolean_);
+            return *this;
+          }
+          JsonInterface *iface = value_interface();
+          JsonError err = JsonError::ok;
+          bool tmp = iface ? iface->to_bool(err) : false;
+          if (iface && err == JsonError::ok)
+            func(tmp);
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function for every item if the value is an
+         * array.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        const JsonReader &map_array(Func &&func) const {
+          if (type() != JsonType::array)
+            return *this;
+          for (int i = 0; i < size(); i++) {
+            JsonReader item = get(i);
+            if (item.has_error())
+              break;
+            func(item);
+          }
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function for every attribute if the value
+         * is an object, the key is passed as std::string_view if the function
+         * accepts one and as const std::string& otherwise.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        const JsonReader &map_object(Func &&func) const {
+          if (has_error() || !node_ || node_->storage_ != Storage::object)
+            return *this;
+          std::string key;
+          static_cast<JsonImplObject*>(node_->interface_)->for_each_attribute([&func,&key](std::string_view view, JsonBase &value){
+            JsonReader item(&value,JsonError::ok);
+            if constexpr (std::is_invocable<Func&,std::string_view,JsonReader&>::value)
+              func(view,item);
+            else {
+              key.assign(view.data(),view.size());
+              func(static_cast<const std::string&>(key),item);
+            }
+          });
+          return *this;
+        }
+
+        /**
+         * @brief Writes the value as json text into the sink.
+         */
+        void dump(JsonSink &sink) const {
+          if (node_)
+            node_->write(sink);
+          else if (scalar_ == JsonType::integer)
+            sink.commit(json_format_integer(integer_,sink.reserve(20)));
+          else
+            sink.commit(json_format_double(floating_,sink.reserve(32)));
+        }
+
+        /**
+         * @brief Returns the value as json text.
+         */
+        std::string dump() const {
+          std::string ret;
+          ret.reserve(node_ ? node_->size_estimate() : 24);
+          {
+            JsonStringSink sink(ret);
+            dump(sink);
+          }
+          return ret;
+        }
+
+      private:
+        JsonReader(const JsonBase *node, JsonError error) : node_(node), scalar_(JsonType::null), integer_(0), error_(error) {
+        }
+
+        /**
+         * @brief Returns a view of a packed integer.
+         */
+        static JsonReader number(long long value) {
+          JsonReader ret(nullptr,JsonError::ok);
+          ret.scalar_ = JsonType::integer;
+          ret.integer_ = value;
+          return ret;
+        }
+
+        /**
+         * @brief Returns a view of a packed floating point number.
+         */
+        static JsonReader number(double value) {
+          JsonReader ret(nullptr,JsonError::ok);
+          ret.scalar_ = JsonType::floating_point;
+          ret.floating_ = value;
+          return ret;
+        }
+
+        /**
+         * @brief Returns the same value with the given error.
+         */
+        JsonReader with_error(JsonError error) const {
+          JsonReader ret(*this);
+          ret.error_ = error;
+          return ret;
+        }
+
+        /**
+         * @brief Returns the interface of the node or nullptr if the value is
+         * invalid or stored inline.
+         */
+        JsonInterface *value_interface() const {
+          if (has_error() || !node_ || node_->storage_ < Storage::interface)
+            return nullptr;
+          return node_->interface_;
+        }
+
+        const JsonBase *node_;  ///< The viewed json or nullptr for a packed number
+        JsonType scalar_;       ///< The type of the packed number
+        union {
+          long long integer_;   ///< The packed integer
+          double floating_;     ///< The packed floating point number
+        };
+        JsonError error_;       ///< The error of the lookup
+    };
+
+    /**
+     * @brief Returns a read only view of the json which several threads can
+     * use at the same time, see JsonReader.
+     *
+     * @return The view of this json.
+     */
+    JsonReader reader() const {
+      return JsonReader(*this);
+    }
+
+    /**
+     * @brief A value inside a json text that has not been parsed yet. get(...)
+     * skips over unrelated values by bracket matching, or with the positions
+     * of a JsonStructuralIndex, without creating any node. Only the accessed
+     * values are converted and materialize() parses one subtree into a json.
+     * The json text and the index must outlive every lazy value.
+     */
+    class JsonLazy {
+      public:
+        /**
+         * @brief Creates a lazy value for the root of the json.
+         *
+         * @param json The json text.
+         * @param index The structural positions of json or nullptr to scan
+         * the characters.
+         */
+        JsonLazy(std::string_view json, const JsonStructuralIndex *index) : json_(json), pos_(0), cursor_(0), index_(index && index->built() ? &index->positions() : nullptr), error_(JsonError::ok) {
+          pos_ = index_ ? position(0) : skip_whitespace(0);
+          if (pos_ >= json_.size())
+            error_ = JsonError::parse_error;
+        }
+
+        /**
+         * @brief Returns the type of the value, for invalid values
+         * JsonType::null.
+         */
+        JsonType type() {
+          if (error_ != JsonError::ok)
+            return JsonType::null;
+          switch (json_[pos_]) {
+            case '{': return JsonType::object;
+            case '[': return JsonType::array;
+            case '"': return JsonType::string;
+            case 't':
+            case 'f': return JsonType::boolean;
+            case 'n': return JsonType::null;
+            default: break;
+          }
+          JsonNumber number;
+          json_parse_number(json_.data()+pos_,json_.data()+json_.size(),number);
+          return number.is_float ? JsonType::floating_point : JsonType::integer;
+        }
+
+        /**
+         * @brief Returns the error if there is one.
+         */
+        JsonError error() {
+          return error_;
+        }
+
+        /**
+         * @brief Returns true if the value is invalid.
+         */
+        bool has_error() {
+          return error_ != JsonError::ok;
+        }
+
+        /**
+         * @brief Returns the json text of the value.
+         */
+        std::string_view raw() {
+          if (error_ != JsonError::ok)
+            return std::string_view();
+          std::size_t pos = pos_, cursor = cursor_, end;
+          if (!skip_value(pos,cursor,end))
+            return std::string_view();
+          return json_.substr(pos_,end-pos_);
+        }
+
+        /**
+         * @brief Returns the number of items of an array or attributes of an
+         * object by skipping over them, 1 for all other values.
+         */
+        int size() {
+          int count = 0;
+          auto counter = [&count](std::string_view, bool, JsonLazy&){ count++; return true; };
+          if (!for_each(counter,true) && !for_each(counter,false))
+            return 1;
+          return count;
+        }
+
+        /**
+         * @brief Returns the attribute with the given key, if this is not an
+         * object or the key does not exist the returned value has an error
+         * set.
+         *
+         * @param key The key to search for.
+         */
+        JsonLazy get(const std::string &key) {
+          JsonLazy ret = with_error(JsonError::does_not_exist);
+          std::string unescaped;
+          bool object = for_each([&](std::string_view raw_key, bool escaped, JsonLazy &value){
+            if (escaped) {
+              unescaped.clear();
+              json_unescape(raw_key,unescaped);
+              raw_key = unescaped;
+            }
+            if (raw_key != key)
+              return true;
+            ret = value;
+            return false;
+          }, true);
+          return object ? ret : with_error(JsonError::not_implemented);
+        }
+
+        /**
+         * @brief Returns the item at the given index, if this is not an array
+         * or the index is out of range the returned value has an error set.
+         *
+         * @param index The index of the item.
+         */
+        JsonLazy get(int index) {
+          JsonLazy ret = with_error(JsonError::does_not_exist);
+          int i = 0;
+          bool array = for_each([&](std::string_view, bool, JsonLazy &value){
+            if (i++ != index)
+              return true;
+            ret = value;
+            return false;
+          }, false);
+          return array ? ret : with_error(JsonError::not_implemented);
+        }
+
+        /**
+         * @brief Returns the value referenced by the json pointer, relative
+         * to this value.
+         *
+         * @param path The compiled json pointer.
+         */
+        JsonLazy get(const JsonPath &path) {
+          if (!path.valid())
+            return with_error(JsonError::does_not_exist);
+          JsonLazy current(*this);
+          for (std::size_t i = 0; i < path.size() && current.error_ == JsonError::ok; i++) {
+            if (current.json_[current.pos_] == '[')
+              current = current.get(path[i].index);
+            else
+              current = current.get(path[i].key);
+          }
+          return current;
+        }
+
+        /**
+         * @brief Evaluates all paths in one traversal, every container is
+         * walked at most once and only entered if a path continues below it.
+         *
+         * @param paths The compiled json pointers relative to this value.
+         * @param func Called as func(number of the path, value) for every
+         * path that exists.
+         */
+        template<typename Func>
+        void select(const std::vector<JsonPath> &paths, Func func) {
+          std::vector<std::size_t> candidates;
+          for (std::size_t i = 0; i < paths.size(); i++) {
+            if (!paths[i].valid())
+              continue;
+            if (paths[i].size() == 0)
+              func(i,*this);
+            else
+              candidates.push_back(i);
+          }
+          select_level(paths,candidates,0,func);
+        }
+
+        /**
+         * @brief Executes the given function if the value is a string.
+         *
+         * @param func The function to call with the unescaped string, with a
+         * std::string_view into the json text if it accepts one and the
+         * string has no escapes.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        JsonLazy &map_string(Func &&func) {
+          std::string_view text = raw();
+          if (text.size() >= 2 && text[0] == '"') {
+            text = text.substr(1,text.size()-2);
+            if constexpr (std::is_invocable<Func&,std::string_view>::value) {
+              if (text.find('\\') == std::string_view::npos) {
+                func(text);
+                return *this;
+              }
+            }
+            std::string tmp;
+            json_unescape(text,tmp);
+            func(tmp);
+          }
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function if the value is an integer.
+         *
+         * @param func The function to call with the integer.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        JsonLazy &map_int(Func &&func) {
+          if (type() == JsonType::integer) {
+            JsonNumber number;
+            json_parse_number(json_.data()+pos_,json_.data()+json_.size(),number);
+            func((int)number.integer);
+          }
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function if the value is a boolean.
+         *
+         * @param func The function to call with the boolean.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        JsonLazy &map_bool(Func &&func) {
+          if (type() == JsonType::boolean)
+            func(json_[pos_] == 't');
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function for every item if the value is
+         * an array.
+         *
+         * @param func The function to call with every item.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        JsonLazy &map_array(Func &&func) {
+          for_each([&func](std::string_view, bool, JsonLazy &value){ func(value); return true; }, false);
+          return *this;
+        }
+
+        /**
+         * @brief Executes the given function for every attribute if the value
+         * is an object.
+         *
+         * @param func The function to call with every key and value.
+         *
+         * @return Returns a reference to itself for function chaining
+         */
+        template<typename Func>
+        JsonLazy &map_object(Func &&func) {
+          std::string key;
+          for_each([&](std::string_view raw_key, bool escaped, JsonLazy &value){
+            key.clear();
+            if (escaped)
+              json_unescape(raw_key,key);
+            else
+              key.assign(raw_key.data(),raw_key.size());
+            func(static_cast<const std::string&>(key),value);
+            return true;
+          }, true);
+          return *this;
+        }
+
+        /**
+         * @brief Parses the value and everything below it into a json.
+         *
+         * @param options The options to parse the subtree with, with
+         * borrow_strings set the json text must outlive the returned json.
+         */
+        JsonBase materialize(JsonParseOptions options=JsonParseOptions()) {
+          if (error_ != JsonError::ok) {
+            JsonBase ret(nullptr);
+            ret.set_error(error_);
+            return ret;
+          }
+          return JsonBase::parse(raw(),[](JsonParser&){},options);
+        }
+
+      private:
+        /**
+         * @brief Returns the same value with the given error.
+         */
+        JsonLazy with_error(JsonError error) {
+          JsonLazy ret(*this);
+          ret.error_ = error;
+          return ret;
+        }
+
+        /**
+         * @brief Returns the position of the structural character with the
+         * given number or the end of the json.
+         */
+        std::size_t position(std::size_t cursor) {
+          return cursor < index_->size() ? (*index_)[cursor] : json_.size();
+        }
+
+        std::size_t skip_whitespace(std::size_t pos) {
+          while (pos < json_.size() && (json_[pos] == ' ' || json_[pos] == '\n' || json_[pos] == '\r' || json_[pos] == '\t'))
+            pos++;
+          return pos;
+        }
+
+        /**
+         * @brief Moves from the single structural character at pos to the
+         * next value or structural character.
+         */
+        void advance(std::size_t &pos, std::size_t &cursor) {
+          if (index_)
+            pos = position(++cursor);
+          else
+            pos = skip_whitespace(pos+1);
+        }
+
+        /**
+         * @brief Skips the string starting with the quote at pos.
+         *
+         * @return One past the closing quote or npos if it is missing.
+         */
+        std::size_t skip_string(std::size_t pos) {
+          const char *it = json_.data()+pos+1;
+          const char *end = json_.data()+json_.size();
+          for (;;) {
+            it = json_find_quote_or_backslash(it,end);
+            if (it == end)
+              return std::string_view::npos;
+            if (*it == '"')
+              return it - json_.data() + 1;
+            it += 2;
+            if (it >= end)
+              return std::string_view::npos;
+          }
+        }
+
+        /**
+         * @brief Skips over the value at pos, afterwards pos is the next
+         * structural character.
+         *
+         * @param pos The first character of the value.
+         * @param cursor The number of the structural character at pos.
+         * @param end Set to one past the last character of the value.
+         *
+         * @return Returns false if the value is not terminated.
+         */
+        bool skip_value(std::size_t &pos, std::size_t &cursor, std::size_t &end) {
+          char c = json_[pos];
+          if (index_) {
+            if (c == '{' || c == '[') {
+              // Strings are already removed from the index, counting the
+              // brackets is enough.
+              int depth = 0;
+              for (; cursor < index_->size(); cursor++) {
+                char s = json_[(*index_)[cursor]];
+                if (s == '{' || s == '[')
+                  depth++;
+                else if ((s == '}' || s == ']') && --depth == 0)
+                  break;
+              }
+              if (depth != 0)
+                return false;
+              end = position(cursor)+1;
+              pos = position(++cursor);
+              return true;
+            }
+            pos = position(++cursor);
+            end = pos;
+            while (end > 0 && (json_[end-1] == ' ' || json_[end-1] == '\n' || json_[end-1] == '\r' || json_[end-1] == '\t'))
+              end--;
+            return true;
+          }
+
+          if (c == '"') {
+            end = skip_string(pos);
+            if (end == std::string_view::npos)
+              return false;
+          }
+          else if (c == '{' || c == '[') {
+            int depth = 0;
+            end = pos;
+            while (end < json_.size()) {
+              char s = json_[end];
+              if (s == '"') {
+                end = skip_string(end);
+                if (end == std::string_view::npos)
+                  return false;
+                continue;
+              }
+              end++;
+              if (s == '{' || s == '[')
+                depth++;
+              else if ((s == '}' || s == ']') && --depth == 0)
+                break;
+            }
+            if (depth != 0)
+              return false;
+          }
+          else {
+            end = pos;
+            while (end < json_.size() && !std::strchr(",}] \n\r\t",json_[end]))
+              end++;
+          }
+          pos = skip_whitespace(end);
+          return true;
+        }
+
+        /**
+         * @brief Matches the children of this value against the tokens at the
+         * given depth of all candidate paths.
+         */
+        template<typename Func>
+        void select_level(const std::vector<JsonPath> &paths, const std::vector<std::size_t> &candidates, std::size_t depth, Func &func) {
+          if (candidates.empty() || error_ != JsonError::ok)
+            return;
+          bool is_object = json_[pos_] == '{';
+          std::size_t remaining = candidates.size();
+          std::vector<std::size_t> next;
+          std::string unescaped;
+          int index = 0;
+          for_each([&](std::string_view key, bool escaped, JsonLazy &value){
+            if (escaped) {
+              unescaped.clear();
+              json_unescape(key,unescaped);
+              key = unescaped;
+            }
+            next.clear();
+            for (std::size_t candidate : candidates) {
+              const JsonPath::Token &token = paths[candidate][depth];
+              if (is_object ? token.key != key : token.index != index)
+                continue;
+              if (remaining)
+                remaining--;
+              if (depth+1 == paths[candidate].size())
+                func(candidate,value);
+              else
+                next.push_back(candidate);
+            }
+            index++;
+            value.select_level(paths,next,depth+1,func);
+            return remaining != 0;
+          }, is_object);
+        }
+
+        /**
+         * @brief Calls func(key,escaped,value) for every attribute of an
+         * object or with an empty key for every item of an array until it
+         * returns false. The key is not unescaped, escaped tells if it has to.
+         *
+         * @return Returns false if the value is not of the requested type.
+         */
+        template<typename Func>
+        bool for_each(Func func, bool is_object) {
+          if (error_ != JsonError::ok || json_[pos_] != (is_object ? '{' : '['))
+            return false;
+          char close = is_object ? '}' : ']';
+          std::size_t pos = pos_, cursor = cursor_, end;
+          advance(pos,cursor);
+          while (pos < json_.size() && json_[pos] != close) {
+            std::string_view key;
+            bool escaped = false;
+            if (is_object) {
+              std::size_t begin = pos;
+              if (json_[pos] != '"' || !skip_value(pos,cursor,end) || pos >= json_.size() || json_[pos] != ':')
+                return true;
+              key = json_.substr(begin+1,end-begin-2);
+              escaped = key.find('\\') != std::string_view::npos;
+              advance(pos,cursor);
+            }
+            if (pos >= json_.size())
+              return true;
+            JsonLazy value(*this);
+            value.pos_ = pos;
+            value.cursor_ = cursor;
+            if (!func(key,escaped,value) || !skip_value(pos,cursor,end))
+              return true;
+            if (pos < json_.size() && json_[pos] == ',')
+              advance(pos,cursor);
+            else if (pos >= json_.size() || json_[pos] != close)
+              return true;
+          }
+          return true;
+        }
+
+        std::string_view json_;                     ///< The whole json text
+        std::size_t pos_;                           ///< The first character of this value
+        std::size_t cursor_;                        ///< The number of the structural character at pos_ if index_ is set
+        const std::vector<std::uint32_t> *index_;   ///< The structural positions of the json or nullptr
+        JsonError error_;                           ///< The error of the lookup which created this value
+    };
+
+    /**
+     * @brief Creates a lazy view of the json, nothing is parsed until a value
+     * is accessed.
+     *
+     * @param view The json text, must outlive all lazy values.
+     * @param index The structural index built from view, or nullptr to skip
+     * values by scanning the characters.
+     *
+     * @return Returns the lazy root value.
+     */
+    static JsonLazy parse_lazy(std::string_view view, const JsonStructuralIndex *index=nullptr) {
+      return JsonLazy(view,index);
+    }
+
+    /**
+     * @brief Parses a json file. The file is memory mapped where possible and
+     * kept alive by the returned document, strings always reference the
+     * mapping instead of being copied.
+     *
+     * @param path The path of the json file.
+     * @param on_error The callback to call when there is a parse error, the
+     * root has JsonError::does_not_exist set if the file can not be read.
+     * @param options The options to parse the json with, borrow_strings is
+     * always set.
+     *
+     * @return Returns the document holding the parsed json.
+     */
+    template<typename OnError>
+    static JsonDocument<JsonBase> parse_file(const std::string &path,OnError &&on_error,JsonParseOptions options=JsonParseOptions()) {
+      JsonMappedFile file(path);
+      if (!file.is_open()) {
+        JsonBase base(nullptr);
+        base.set_error(JsonError::does_not_exist);
+        return JsonDocument<JsonBase>(std::move(file),std::move(base));
+      }
+      options.borrow_strings = true;
+      JsonBase base = parse(file.view(),std::forward<OnError>(on_error),options);
+      return JsonDocument<JsonBase>(std::move(file),std::move(base));
+    }
+
+    /**
+     * @brief The results of parse_many(...) in input order. With an arena
+     * allocator the records share one arena per worker thread which lives as
+     * long as this object, the records must therefore not outlive it.
+     */
+    class JsonRecords {
+      public:
+        using JsonParserError = typename JsonParser::JsonParserError;
 
-          // Check if there was an error if so no need to go on.
-          if(error_ != JsonParserError::ok)
-            break;
+        /**
+         * @brief Returns the number of parsed records.
+         */
+        std::size_t size() {
+          return records_.size();
         }
-        return object;
-      }
 
-      /**
-       * @brief Skips all filling characters in the underlying json must not be
-       * called from inside json string!
-       */
-      void skip_whitespace_tab_newline() {
-        while(underlying_json_[abs_pos_]==' ' || underlying_json_[abs_pos_] == '\t' || underlying_json_[abs_pos_] == '\n')
-          ++abs_pos_;
-      }
+        /**
+         * @brief Returns the record at the given index, records with a parse
+         * error have JsonError::parse_error set.
+         *
+         * @param index The index of the record, empty lines are skipped.
+         */
+        JsonBase &operator[](std::size_t index) {
+          return records_[index];
+        }
 
-      /**
-       * @brief Parses an json array and returns them. Always returns a value !=
-       * nullptr
-       *
-       * @return Returns the parsed json array.
-       */
-      JsonBase *parse_array() {
-        //Skip the first character which we know is [
-        ++abs_pos_;
+        /**
+         * @brief Returns the parse error of the record at the given index.
+         *
+         * @param index The index of the record.
+         */
+        JsonParserError parse_error(std::size_t index) {
+          return errors_[index];
+        }
 
-        //Always return a value != nullptr.
-        JsonBase *array = new JsonBase(new JsonImplArray());
+      private:
+        friend class JsonBase;
 
-        // No comma is expected yet.
-        bool expect_comma = false;
+        std::vector<json_allocator> allocators_;  ///< One allocator per worker, owns the memory of the records
+        std::vector<JsonBase> records_;           ///< The parsed records in input order
+        std::vector<JsonParserError> errors_;     ///< The parse error of every record
+    };
 
-        for (;abs_pos_< underlying_json_.length(); abs_pos_++) {
-          // Skip all filling characters.
-          skip_whitespace_tab_newline();
-          // We are finished on the closing character.
-          if (underlying_json_[abs_pos_] == ']')
+    /**
+     * @brief Parses newline delimited json, every non empty line is one
+     * record. The records are parsed in batches by a pool of worker threads,
+     * each worker creates all its records with one allocator. Define
+     * GC_JSON_NO_THREADS to parse on the calling thread only.
+     *
+     * @param view The records separated by newlines, must outlive the result
+     * with borrow_strings set.
+     * @param options The options to parse every record with.
+     * @param threads The number of worker threads, 0 uses one per hardware
+     * thread.
+     *
+     * @return The parsed records in input order.
+     */
+    static JsonRecords parse_many(std::string_view view, JsonParseOptions options=JsonParseOptions(), unsigned threads=0) {
+      // Find the records, a newline can never appear inside a json string.
+      std::vector<std::string_view> lines;
+      const char *it = view.data();
+      const char *end = it + view.size();
+      while (it < end) {
+        const char *newline = static_cast<const char*>(std::memchr(it,'\n',end-it));
+        if (!newline)
+          newline = end;
+        std::string_view line(it,newline-it);
+        for (char c : line) {
+          if (!JsonParser::is_whitespace(c)) {
+            lines.push_back(line);
             break;
-          // If there is an comma set the expected comma or error depending on
-          // the expected value.
-          else if (underlying_json_[abs_pos_] == ',') {
-            if (!expect_comma) {
-              set_error(JsonParserError::expected_comma_before_next_array_item);
-              break;
-            }
-            expect_comma = false;
-          }
-          else {
-            // Parse the item and add it to the array.
-            JsonBase *json_item = parse();
-            array->push_back(json_item);
-            expect_comma = true;
           }
-
-          if (error_ != JsonParserError::ok)
-            break;
         }
-        return array;
+        it = newline+1;
       }
 
-      /**
-       * @brief Parses the next json string
-       *
-       * @return The parsed json string.
-       */
-      JsonBase *parse_string() {
-        //Skip the first character which we know is "
-        ++abs_pos_;
-        std::string the_content;
-
-        for (;abs_pos_< underlying_json_.length(); abs_pos_++) {
-          // Add everything into the JsonBase as long as there are characters
-          // and no closing characters skip all \" and \\" characters.
-          if (underlying_json_[abs_pos_] == '"' && underlying_json_[abs_pos_-1] != '\\') {
-            return new JsonBase(std::move(the_content));
+      JsonRecords result;
+      result.records_.reserve(lines.size());
+      for (std::size_t i = 0; i < lines.size(); i++)
+        result.records_.emplace_back(nullptr);
+      result.errors_.resize(lines.size(),JsonParser::JsonParserError::ok);
+
+#if defined(GC_JSON_NO_THREADS)
+      threads = 1;
+#else
+      if (threads == 0)
+        threads = std::max(1u,std::thread::hardware_concurrency());
+#endif
+      const std::size_t batch = 64;
+      threads = (unsigned)std::min<std::size_t>(threads,(lines.size()+batch-1)/batch);
+      result.allocators_.resize(std::max(1u,threads));
+
+      std::atomic<std::size_t> next_batch(0);
+      auto worker = [&](json_allocator &allocator) {
+        for (;;) {
+          std::size_t first = next_batch.fetch_add(batch,std::memory_order_relaxed);
+          if (first >= lines.size())
+            return;
+          std::size_t last = std::min(first+batch,lines.size());
+          for (std::size_t i = first; i < last; i++) {
+            JsonParser parser(lines[i],0,options,allocator.child());
+            JsonBase record(parser.parse());
+            if (parser.parse_error())
+              record.set_error(JsonError::parse_error);
+            result.records_[i] = std::move(record);
+            result.errors_[i] = parser.error_;
           }
-          the_content+=underlying_json_[abs_pos_];
         }
-        //Something went wrong no closing quote until json end.
-        set_error(JsonParserError::expected_closing_quote_but_got_eos);
-        return new JsonBase(std::move(the_content));
-      }
+      };
 
+#if !defined(GC_JSON_NO_THREADS)
+      std::vector<std::thread> pool;
+      for (unsigned i = 1; i < threads; i++)
+        pool.emplace_back(worker,std::ref(result.allocators_[i]));
+#endif
+      worker(result.allocators_[0]);
+#if !defined(GC_JSON_NO_THREADS)
+      for (auto &thread : pool)
+        thread.join();
+#endif
+      return result;
+    }
 
-      /**
-       * @brief Parses either an json integer or an json double
-       *
-       * @return 
-       */
-      JsonBase *parse_integer_or_double() {
-        //Skip the first character which we know is "
-        int beginning = abs_pos_;
-        bool is_float = false;
-
-        for (;abs_pos_< underlying_json_.length(); abs_pos_++) {
-          //Check the sign flag, is not needed as strtod will check it as well
-          if (underlying_json_[abs_pos_] == '-') {
-          }
-          // Is floating point?
-          else if(underlying_json_[abs_pos_] == '.')
-            is_float = true;
-          // Check the end of the integer or double
-          else if (underlying_json_[abs_pos_] > '9' || underlying_json_[abs_pos_] < '0') {
+    /**
+     * @brief Parses a json whose root is a large array on several threads.
+     * A structural index splits the array into its items at depth 1, chunks
+     * of items are claimed by the worker threads from a shared counter and
+     * every worker creates its items with its own allocator, the items are
+     * finally moved into one array owning all allocators. Any other root,
+     * irregular separators and parse errors fall back to parse(...), so the
+     * result and the reported error are always the same. Define
+     * GC_JSON_NO_THREADS to parse on the calling thread only.
+     *
+     * @param view The json string to parse, must be smaller than 2GB.
+     * @param on_error The callback to call when there is an error.
+     * @param options The options to parse the json with, with
+     * borrow_strings set the view must outlive the returned json.
+     * @param threads The number of worker threads, 0 uses one per hardware
+     * thread.
+     *
+     * @return Returns the parsed json in dom format.
+     */
+    template<typename OnError>
+    static JsonBase parse_parallel(std::string_view view,OnError &&on_error,JsonParseOptions options=JsonParseOptions(),unsigned threads=0) {
+      // The items are positioned with int, larger json report
+      // exceeded_max_length through parse(...).
+      if (view.length() > (std::size_t)INT_MAX)
+        return parse(view,std::forward<OnError>(on_error),options);
+      JsonStructuralIndex index;
+      bool built = index.build(view);
+      const std::vector<std::uint32_t> &positions = index.positions();
+      if (!built || positions.empty() || view[positions[0]] != '[' || options.max_depth == 0)
+        return parse(view,std::forward<OnError>(on_error),options);
+
+      // Find the first structural position of every item and the separator
+      // behind it, which is the following ',' or the closing ']'.
+      std::vector<std::size_t> items;
+      std::vector<std::size_t> separators;
+      std::size_t depth = 0;
+      std::size_t close = 0;
+      for (std::size_t i = 0; i < positions.size() && close == 0; i++) {
+        switch (view[positions[i]]) {
+          case '[':
+          case '{':
+            if (depth++ == 0)
+              items.push_back(i+1);
+            break;
+          case ']':
+          case '}':
+            if (--depth == 0)
+              close = i;
+            break;
+          case ',':
+            if (depth == 1) {
+              separators.push_back(i);
+              items.push_back(i+1);
+            }
             break;
+        }
+      }
+      // Unclosed arrays, content behind the array and empty or trailing
+      // items are left to the sequential parser.
+      if (close == 0 || close+1 != positions.size() || view[positions[close]] != ']')
+        return parse(view,std::forward<OnError>(on_error),options);
+      separators.push_back(close);
+      if (items.size() == 1 && items[0] == close)
+        items.clear();
+      for (std::size_t i = 0; i < items.size(); i++)
+        if (items[i] == separators[i])
+          return parse(view,std::forward<OnError>(on_error),options);
+
+#if defined(GC_JSON_NO_THREADS)
+      threads = 1;
+#else
+      if (threads == 0)
+        threads = std::max(1u,std::thread::hardware_concurrency());
+#endif
+      // Several chunks per thread balance items of different size.
+      const std::size_t chunk = std::max<std::size_t>(1,items.size()/((std::size_t)threads*8));
+      threads = (unsigned)std::max<std::size_t>(1,std::min<std::size_t>(threads,(items.size()+chunk-1)/chunk));
+
+      std::vector<json_allocator> allocators(threads);
+      std::vector<JsonBase> values;
+      values.reserve(items.size());
+      for (std::size_t i = 0; i < items.size(); i++)
+        values.emplace_back(nullptr);
+
+      std::atomic<std::size_t> next_chunk(0);
+      std::atomic<bool> failed(false);
+      auto worker = [&](json_allocator &allocator) {
+        JsonParser parser(view,0,options,allocator.child());
+        parser.use_index(index);
+        // One builder for all items keeps the memory of its frames.
+        JsonDomBuilder builder(parser.allocator_,options);
+        for (;;) {
+          std::size_t first = next_chunk.fetch_add(chunk,std::memory_order_relaxed);
+          if (first >= items.size() || failed.load(std::memory_order_relaxed))
+            return;
+          std::size_t last = std::min(first+chunk,items.size());
+          for (std::size_t i = first; i < last; i++) {
+            parser.abs_pos_ = (int)positions[items[i]];
+            parser.index_pos_ = items[i];
+            // The item is nested in the root array, which counts for max_depth.
+            parser.depth_ = 1;
+            parser.containers_[0] = 0;
+            parser.parse_events(builder);
+            JsonBase value(builder.take());
+            // The item must end directly in front of its separator.
+            ++parser.abs_pos_;
+            parser.skip_whitespace_tab_newline();
+            if (parser.parse_error() || parser.abs_pos_ != (int)positions[separators[i]]) {
+              failed.store(true,std::memory_order_relaxed);
+              return;
+            }
+            values[i] = std::move(value);
           }
         }
-        // The end should be the last valid character
-        --abs_pos_;
-        
-        const char *start = &underlying_json_[beginning];
-        char *end;
-        JsonInterface *impl;
+      };
 
-        // Cast the given string to int or double
-        if (is_float) {
-          double val = strtod(start,&end);
-          impl = new JsonImplDouble(val);
-        }
-        else {
-          long val = strtol(start,&end,10);
-          impl = new JsonImplInteger(val);
+#if !defined(GC_JSON_NO_THREADS)
+      std::vector<std::thread> pool;
+      for (unsigned i = 1; i < threads; i++)
+        pool.emplace_back(worker,std::ref(allocators[i]));
+#endif
+      worker(allocators[0]);
+#if !defined(GC_JSON_NO_THREADS)
+      for (auto &thread : pool)
+        thread.join();
+#endif
+      if (failed)
+        return parse(view,std::forward<OnError>(on_error),options);
+
+      // Stitch the items together, the root owns the memory of all workers.
+      JsonImplArray *array = allocators[0].template create<JsonImplArray>(allocators[0]);
+      array->reserve(values.size());
+      JsonShapeSharing shapes;
+      for (auto &value : values) {
+        if constexpr (std::is_same<JsonImplObject, JsonImplShapedObject>::value) {
+          if (value.storage_ == Storage::object)
+            shapes.end(static_cast<JsonImplObject*>(value.interface_));
         }
-
-        //Cast error
-        if (start == end)
-          set_error(JsonParserError::expected_int_or_double);
-        return new JsonBase(impl);
+        array->push(std::move(value));
       }
+      JsonBase base(allocators[0].child(),Storage::array,array);
+      for (auto &allocator : allocators)
+        base.allocator_.adopt(allocator);
+      return base;
+    }
 
-      /**
-       * @brief Parse boolean value.
-       *
-       * @return Returns the created JsonBase bool object.
-       */
-      JsonBase *parse_boolean() {
-        bool value;
+    /**
+     * @brief Parses the json without building a DOM and reports every value
+     * to the handler. The handler provides the following functions, each
+     * returns false to stop parsing:
+     * ```
+     * bool null();
+     * bool boolean(bool value);
+     * bool integer(long long value);
+     * bool floating(double value);
+     * bool string(std::string_view value);
+     * bool key(std::string_view key);
+     * bool start_object();
+     * bool end_object();
+     * bool start_array();
+     * bool end_array();
+     * ```
+     * The views passed to string(...) and key(...) are unescaped and only
+     * valid during the call. Instead of both a handler may provide
+     * raw_string(std::string_view raw, bool has_escapes) and
+     * raw_key(std::string_view raw, bool has_escapes) which receive the
+     * still escaped slice of the parsed json. JsonDomBuilder is the handler
+     * used by parse(...).
+     *
+     * @param view The json to parse.
+     * @param handler Receives the events, all calls are resolved at compile
+     * time.
+     * @param options The options to parse the json with.
+     *
+     * @return JsonParserError::ok or the error which stopped parsing.
+     */
+    template<typename Handler>
+    static typename JsonParser::JsonParserError parse_events(std::string_view view, Handler &handler, JsonParseOptions options=JsonParseOptions()) {
+      JsonParser parser(view,0,options);
+      parser.parse_events(handler);
+      return parser.error_;
+    }
 
-        if (underlying_json_.substr(abs_pos_,4) == "true") {
-          abs_pos_ = abs_pos_+3;
-          value = true;
-        }
-        else {
-          abs_pos_ = abs_pos_+4;
-          value = false;
-        }
-        return new JsonBase(value);
+    /**
+     * @brief Parses the json directly into a variable, e.g. a struct bound
+     * with JsonFields, without creating any json nodes. Attributes are
+     * dispatched to the members with a perfect hash of the keys built at
+     * compile time, see JsonParser::read(...) for the supported types.
+     * ```
+     * User user;
+     * if (Json::parse_struct(buffer,user) != Json::JsonParser::JsonParserError::ok)
+     *   fail();
+     * ```
+     *
+     * @param view The json to parse.
+     * @param value The variable to parse into, members without attribute
+     * keep their value.
+     * @param options The options to parse the json with.
+     *
+     * @return JsonParserError::ok or the error which stopped parsing, e.g.
+     * JsonParserError::unexpected_type.
+     */
+    template<typename T>
+    static typename JsonParser::JsonParserError parse_struct(std::string_view view, T &value, JsonParseOptions options=JsonParseOptions()) {
+      JsonParser parser(view,0,options);
+      if (parser.read(value)) {
+        ++parser.abs_pos_;
+        parser.skip_whitespace_tab_newline();
+        if (parser.abs_pos_ < (int)view.length())
+          parser.set_error(JsonParser::JsonParserError::unexpected_character_after_json);
       }
+      return parser.error_;
+    }
 
-      /**
-       * @brief Check the json null value.
-       *
-       * @return Returns the created JsonBase null object.
-       */
-      JsonBase *parse_null() {
-        if(std::string_view(&underlying_json_[abs_pos_],4) != "null")
-          set_error(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
-        abs_pos_+=3;
-        return new JsonBase(new JsonImplNull());
+    /**
+     * @brief Writes a variable, e.g. a struct bound with JsonFields, as json
+     * without creating any json nodes. Empty optionals are written as null.
+     *
+     * @param value The variable to write.
+     *
+     * @return Returns the json.
+     */
+    template<typename T>
+    static std::string dump_struct(const T &value) {
+      std::string ret;
+      {
+        JsonStringSink sink(ret);
+        write_value(value,sink);
+      }
+      return ret;
+    }
+
+    /**
+     * @brief Writes a variable as json into the sink, see dump_struct(...).
+     *
+     * @param value The variable to write.
+     * @param sink The sink to write to, the caller decides when to flush it.
+     */
+    template<typename T>
+    static void dump_struct(const T &value, JsonSink &sink) {
+      write_value(value,sink);
+    }
+
+  private:
+    /**
+     * @brief Describes which member of the value union is valid. Scalars are
+     * stored inline, everything else lives behind interface_. Arrays and
+     * objects created by this library get their own tag so accessing them
+     * needs no virtual call.
+     */
+    enum class Storage : unsigned char {
+      null,       ///< No member of the union is used
+      boolean,    ///< boolean_ holds the value
+      integer,    ///< integer_ holds the value
+      floating,   ///< floating_ holds the value
+      interface,  ///< interface_ points to any JsonInterface or is nullptr
+      array,      ///< interface_ points to a JsonImplArray
+      object,     ///< interface_ points to a JsonImplObject
+    };
+
+    /**
+     * @brief Creates the json from an interface whose implementation is known.
+     *
+     * @param alloc The allocator the interface was created with.
+     * @param storage Either Storage::array or Storage::object.
+     * @param inter The JsonImplArray or JsonImplObject.
+     */
+    JsonBase(json_allocator alloc, Storage storage, JsonInterface *inter) : interface_(inter), storage_(storage), allocator_(std::move(alloc)), last_error_(JsonError::ok) {
+    }
+
+    /**
+     * @brief Unshares the node before references to its children are handed
+     * out and marks it as exposed. Copies of an exposed node copy it and its
+     * exposed children instead of sharing them, so changes through these
+     * references, also those taken before the copy, stay in this json.
+     */
+    void expose() {
+      unshare();
+      if (storage_ >= Storage::interface && interface_ && !interface_->exposed_.load(std::memory_order_relaxed))
+        interface_->exposed_.store(true,std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Replaces a node shared with other jsons by an own copy before it
+     * is changed or one of its children is handed out.
+     */
+    void unshare() {
+      if (storage_ < Storage::interface || !interface_ || interface_->references_.load(std::memory_order_acquire) == 1)
+        return;
+      JsonInterface *copy = interface_->clone(allocator_);
+      if (!copy)
+        return;
+      Storage storage = storage_;
+      release();
+      storage_ = storage;
+      interface_ = copy;
+    }
+
+    /**
+     * @brief Returns the interface to forward calls to which are not handled
+     * inline. Scalars forward to a shared JsonImplNull which reports
+     * JsonError::not_implemented for every container or conversion call.
+     *
+     * @return The interface to call.
+     */
+    JsonInterface *value_interface() {
+      if (storage_ >= Storage::interface)
+        return interface_;
+      static JsonImplNull scalar;
+      return &scalar;
+    }
+
+    /**
+     * @brief Moves the value of other into this json, storage_ must already
+     * be copied from other. Afterwards other is null.
+     *
+     * @param other The json to take the value from.
+     */
+    void take_value(JsonBase &other) {
+      switch (storage_) {
+        case Storage::boolean:    boolean_ = other.boolean_; break;
+        case Storage::integer:    integer_ = other.integer_; break;
+        case Storage::floating:   floating_ = other.floating_; break;
+        default:                  interface_ = other.interface_; break;
       }
+      other.interface_ = nullptr;
+      other.storage_ = Storage::null;
+    }
 
+    /**
+     * @brief Releases the interface if there is one.
+     */
+    void release() {
+      // The last reference destroys the node, a node with a single reference
+      // can not be shared by another thread meanwhile.
+      if (storage_ >= Storage::interface && interface_ && (interface_->references_.load(std::memory_order_acquire) == 1 || interface_->references_.fetch_sub(1,std::memory_order_acq_rel) == 1))
+        allocator_.destroy(interface_);
+      interface_ = nullptr;
+      storage_ = Storage::null;
+    }
 
-      /**
-       * @brief Parses a json.
-       *
-       * @return The parsed in DOM format.
-       */
-      JsonBase *parse() {
-        JsonBase *inter = nullptr;
+    /**
+     * @brief Inserts the node into the interface, releases the node if the
+     * interface did not take it.
+     *
+     * @param key The key of the node, empty for arrays.
+     * @param node The node to insert.
+     */
+    void insert_node(const std::string &key, JsonBase *node) {
+      unshare();
+      JsonError err = JsonError::ok;
+      value_interface()->insert(key,node,err);
+      if (err != JsonError::ok) {
+        allocator_.destroy(node);
+        last_error_ = err;
+      }
+    }
 
-        for (; abs_pos_ < underlying_json_.length(); abs_pos_++) {
-          if (underlying_json_[abs_pos_] == ' ' || underlying_json_[abs_pos_] == '\t' || underlying_json_[abs_pos_] == '\n')
-            continue;
+    /**
+     * @brief Writes the json into the sink, scalars are formatted inline.
+     *
+     * @param sink The sink to write to.
+     */
+    void write(JsonSink &sink) const {
+      switch (storage_) {
+        case Storage::null:
+          sink.append("null",4);
+          break;
+        case Storage::boolean:
+          if (boolean_)
+            sink.append("true",4);
           else
-            break;
-        }
+            sink.append("false",5);
+          break;
+        case Storage::integer:
+          sink.commit(json_format_integer(integer_,sink.reserve(20)));
+          break;
+        case Storage::floating:
+          sink.commit(json_format_double(floating_,sink.reserve(32)));
+          break;
+        case Storage::array:
+          static_cast<JsonImplArray*>(interface_)->dump_to(sink);
+          break;
+        case Storage::object:
+          static_cast<JsonImplObject*>(interface_)->dump_to(sink);
+          break;
+        default:
+          interface_->dump_to(sink);
+      }
+    }
 
-        // Check the type of the comming object.
-        switch (underlying_json_[abs_pos_]) {
-          case '{':
-            inter = parse_object();
-            break;
-          case '[':
-            inter = parse_array();
-            break;
-          case '"':
-            inter = parse_string();
-            break;
-          case 't':
-          case 'f':
-            inter = parse_boolean();
-            break;
-          case 'n':
-            inter = parse_null();
-            break;
-          default:
-            if ((underlying_json_[abs_pos_] <= '9' && underlying_json_[abs_pos_] >= '0') || underlying_json_[abs_pos_] == '-')
-              inter = parse_integer_or_double();
-            else {
-              set_error(JsonParserError::expected_beginning_of_string_int_object_or_array_null_float);
-              return new JsonBase();
+    /**
+     * @brief Reports the json to an event handler like parse_events(...) does,
+     * containers created by this library pass their size to start_array and
+     * start_object. Other interfaces are converted from their dump.
+     */
+    template<typename Handler>
+    void write_events(Handler &handler) {
+      switch (storage_) {
+        case Storage::null:
+          handler.null();
+          return;
+        case Storage::boolean:
+          handler.boolean(boolean_);
+          return;
+        case Storage::integer:
+          handler.integer(integer_);
+          return;
+        case Storage::floating:
+          handler.floating(floating_);
+          return;
+        case Storage::array: {
+          auto array = static_cast<JsonImplArray*>(interface_);
+          handler.start_array(array->size());
+          // Packed numbers are written without creating the items.
+          if (array->packed_integers().size() || array->packed_floats().size()) {
+            JsonSpan<const double> floats = array->packed_floats();
+            for (long long value : array->packed_integers())
+              handler.integer(value);
+            for (std::size_t i = 0; i < floats.size(); i++) {
+              if (array->packed_is_integer(i))
+                handler.integer((long long)floats[i]);
+              else
+                handler.floating(floats[i]);
             }
+          }
+          else {
+            for (int i = 0; i < array->size(); i++)
+              array->at(i).write_events(handler);
+          }
+          handler.end_array();
+          return;
         }
-        return inter;
+        case Storage::object: {
+          auto object = static_cast<JsonImplObject*>(interface_);
+          handler.start_object(object->size());
+          object->for_each_attribute([&handler](std::string_view key, JsonBase &value){
+            handler.key(key);
+            value.write_events(handler);
+          });
+          handler.end_object();
+          return;
+        }
+        default:
+          break;
       }
-    };
+      if (!interface_) {
+        handler.null();
+        return;
+      }
+      JsonError err = JsonError::ok;
+      if (interface_->type() == JsonType::string)
+        handler.string(interface_->to_string(err));
+      else
+        parse_events(interface_->dump_string(),handler);
+    }
 
+    /**
+     * @brief Writes the variable into the sink, bound structs are written
+     * member by member.
+     */
+    template<typename T>
+    static void write_value(const T &value, JsonSink &sink) {
+      if constexpr (json_is_optional<T>::value) {
+        if (value)
+          write_value(*value,sink);
+        else
+          sink.append("null",4);
+      }
+      else if constexpr (json_is_bound<T>::value) {
+        sink.put('{');
+        write_members(value,sink,std::make_index_sequence<JsonBinding<T>::size>());
+        sink.put('}');
+      }
+      else if constexpr (json_is_vector<T>::value) {
+        sink.put('[');
+        bool first = true;
+        for (const auto &item : value) {
+          if (!first)
+            sink.put(',');
+          first = false;
+          write_value(item,sink);
+        }
+        sink.put(']');
+      }
+      else if constexpr (std::is_same<T,std::string>::value) {
+        sink.put('"');
+        json_escape(std::string_view(value),sink);
+        sink.put('"');
+      }
+      else if constexpr (std::is_same<T,bool>::value) {
+        if (value)
+          sink.append("true",4);
+        else
+          sink.append("false",5);
+      }
+      else if constexpr (std::is_floating_point<T>::value)
+        sink.commit(json_format_double((double)value,sink.reserve(32)));
+      else if constexpr (std::is_integral<T>::value) {
+        if (std::is_unsigned<T>::value && (unsigned long long)value > (unsigned long long)LLONG_MAX)
+          sink.append(std::to_string((unsigned long long)value));
+        else
+          sink.commit(json_format_integer((long long)value,sink.reserve(20)));
+      }
+      else
+        static_assert(json_is_bound<T>::value, "The type can not be written, bind it with JsonFields");
+    }
 
-      /**
-       * @brief Parses any json string into a JSON DOM object
-       *
-       * @param view The json string to parse
-       * @param on_error The callback to call when there is an error.
-       *
-       * @return Returns the parsed json in dom format.
-       */
-    static JsonBase parse(std::string_view view,std::function<void(JsonParser&)> on_error) {
-      JsonParser parser(view);
-      auto result = parser.parse();
-      
-      JsonBase base(std::move(*result));
-      delete result;
-      
-      if (parser.parse_error()) {
-        on_error(parser);
-        base.set_error(JsonError::parse_error);
+    /**
+     * @brief Writes the members of a bound struct as attributes.
+     */
+    template<typename T, std::size_t... Is>
+    static void write_members(const T &value, JsonSink &sink, std::index_sequence<Is...>) {
+      bool first = true;
+      auto write_member = [&value,&sink,&first](const auto &field) {
+        if (!first)
+          sink.put(',');
+        first = false;
+        sink.put('"');
+        json_escape(field.key,sink);
+        sink.append("\":",2);
+        write_value(value.*(field.member),sink);
+      };
+      (write_member(std::get<Is>(JsonFields<T>::fields)),...);
+    }
+
+    /**
+     * @brief Returns the estimated length of the dump.
+     */
+    std::size_t size_estimate() const {
+      switch (storage_) {
+        case Storage::null:       return 4;
+        case Storage::boolean:    return boolean_ ? 4 : 5;
+        case Storage::integer:    return json_integer_length(integer_);
+        case Storage::floating:   return 24;
+        case Storage::array:      return static_cast<JsonImplArray*>(interface_)->dump_size_estimate();
+        case Storage::object:     return static_cast<JsonImplObject*>(interface_)->dump_size_estimate();
+        default:                  return interface_->dump_size_estimate();
       }
+    }
 
-      return std::move(base);
+    /**
+     * @brief Takes the ownership of a node created with new. With the heap
+     * allocator the node is used as is, other allocators move the node into
+     * their own memory and release the given one.
+     *
+     * @param js The node created with new.
+     *
+     * @return The node to insert into one of the containers.
+     */
+    JsonBase *take_node(JsonBase *js) {
+      if constexpr (std::is_same<json_allocator, JsonHeapAllocator>::value) {
+        return js;
+      }
+      else {
+        JsonBase *node = allocator_.template create<JsonBase>(allocator_.child(),static_cast<JsonInterface*>(nullptr));
+        *node = std::move(*js);
+        delete js;
+        return node;
+      }
     }
 
-  private:
-    JsonInterface *interface_;  ///< The underlying interface, this class is polymorphic to enable custom types and advancements.
+    union {
+      JsonInterface *interface_;  ///< The underlying interface, this class is polymorphic to enable custom types and advancements.
+      long long integer_;         ///< The value of Storage::integer
+      double floating_;           ///< The value of Storage::floating
+      bool boolean_;              ///< The value of Storage::boolean
+    };
+    Storage storage_;           ///< The valid member of the union
+    json_allocator allocator_;  ///< The allocator of the interface and all nodes inserted into it.
     JsonError last_error_;      ///< This variable stores the last error that happended to enable error callbacks and function style assignments
 };
 
 ///< Setting the type to the json can be used like this Json b;
 using Json = JsonBase<JsonLogLevel::none,JsonStdoutColoredFunctor>;
 
+///< A json which keeps all nodes of a document inside one arena.
+using ArenaJson = JsonBase<JsonLogLevel::none,JsonStdoutColoredFunctor,JsonArenaAllocator>;
+
+///< A json whose objects keep their attributes in insertion order.
+using FlatJson = JsonBase<JsonLogLevel::none,JsonStdoutColoredFunctor,JsonHeapAllocator,JsonFlatObjectStorage>;
+
+///< A json whose objects share their keys with all objects of the same key sequence.
+using ShapedJson = JsonBase<JsonLogLevel::none,JsonStdoutColoredFunctor,JsonHeapAllocator,JsonShapedObjectStorage>;
+
 
 #endif
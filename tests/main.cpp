@@ -1,6 +1,11 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
 #include "../json_parser.hpp"
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 TEST_CASE("Checking basic json parsing","[json_parse]")
 {
@@ -229,3 +234,1430 @@ TEST_CASE("Stringify jsons and serialize","[json_parse]")
   REQUIRE(js.size() == js2.size());
   REQUIRE(js.type() == js2.type());
 }
+
+TEST_CASE("Arena json parsing","[json_arena]")
+{
+  bool set_err = false;
+  auto js = ArenaJson::parse("{\"key\": {\"tor\":\"hallo\"}, \"list\": [1,2.5,true,null]}",[&set_err](ArenaJson::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == false);
+  REQUIRE(js.type() == JsonType::object);
+  REQUIRE(js.get("list").size() == 4);
+  REQUIRE(js.get("list").get(1).type() == JsonType::floating_point);
+
+  std::string val;
+  js.get("key").get("tor").map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "hallo");
+}
+
+TEST_CASE("Arena json modify parsed document","[json_arena]")
+{
+  bool set_err = false;
+  auto js = ArenaJson::parse("[10,[]]",[&set_err](ArenaJson::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == false);
+  js.push_back(true)
+    .push_back("fuchs")
+    .push_back(new ArenaJson());
+  js.get(1).push_back(20ll);
+  REQUIRE(js.has_error() == false);
+  REQUIRE(js.size() == 5);
+  REQUIRE(js.get(1).size() == 1);
+  REQUIRE(js.get(4).type() == JsonType::object);
+}
+
+TEST_CASE("Arena json move document into other document","[json_arena]")
+{
+  bool set_err = false;
+  auto js = ArenaJson::parse("{\"a\":[1]}",[&set_err](ArenaJson::JsonParser&){set_err = true;});
+  {
+    auto other = ArenaJson::parse("{\"b\":\"moved\"}",[&set_err](ArenaJson::JsonParser&){set_err = true;});
+    js.get("a").get(0) = std::move(other);
+  }
+
+  REQUIRE(set_err == false);
+  std::string val;
+  js.get("a").get(0).get("b").map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "moved");
+}
+
+TEST_CASE("Arena reuses blocks for many nodes","[json_arena]")
+{
+  JsonArena arena(64);
+  void *first = arena.allocate(16,8);
+  void *second = arena.allocate(16,8);
+
+  REQUIRE(static_cast<char*>(second) == static_cast<char*>(first) + 16);
+  REQUIRE(arena.bytes_reserved() == 64);
+  arena.allocate(1000,8);
+  REQUIRE(arena.bytes_reserved() > 1000);
+}
+
+TEST_CASE("Escaped strings are unescaped","[json_parse]")
+{
+  bool set_err = false;
+  auto js = Json::parse("{\"k\\\"ey\":\"a\\\"b\\\\\\n\\u00e4\"}",[&set_err](Json::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == false);
+  std::string val;
+  js.get("k\"ey").map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "a\"b\\\n\xc3\xa4");
+  REQUIRE(js.dump() == "{\"k\\\"ey\":\"a\\\"b\\\\\\n\xc3\xa4\"}");
+}
+
+TEST_CASE("Borrowed strings reference the parsed json","[json_borrow]")
+{
+  bool set_err = false;
+  JsonParseOptions options;
+  options.borrow_strings = true;
+  std::string js_str = "{\"key\":\"hallo\",\"esc\":\"a\\tb\",\"list\":[\"x\"]}";
+  auto js = Json::parse(js_str,[&set_err](Json::JsonParser&){set_err = true;},options);
+
+  REQUIRE(set_err == false);
+  REQUIRE(js.get("key").type() == JsonType::string);
+
+  std::string val;
+  js.get("key").map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "hallo");
+  js.get("esc").map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "a\tb");
+
+  js.set("added","value");
+  REQUIRE(js.size() == 4);
+
+  auto js2 = Json::parse(js.dump(),[&set_err](Json::JsonParser&){set_err = true;});
+  REQUIRE(set_err == false);
+  js2.get("esc").map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "a\tb");
+  js2.get("list").get(0).map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "x");
+}
+
+TEST_CASE("Structural index marks tokens outside of strings","[json_index]")
+{
+  JsonStructuralIndex index;
+  REQUIRE_FALSE(index.built());
+  REQUIRE(index.build("{\"a\\\"}\" : [ 10, true ]}"));
+  std::vector<std::uint32_t> expected = {0,1,8,10,12,14,16,21,22};
+
+  REQUIRE(index.built());
+  REQUIRE(index.positions() == expected);
+}
+
+TEST_CASE("Structural index parsing","[json_index]")
+{
+  bool set_err = false;
+  std::string js_str = "{\n  \"key\" : [ 10 ,\t2.5 ,\r\n \"a,b]\" , null ],\n  \"obj\" : { \"x\" : false }\n}";
+  for (int i = 0; i < 5; i++)
+    js_str = "[ " + js_str + " ,\n " + js_str + " ]";
+  JsonStructuralIndex index;
+  REQUIRE(index.build(js_str));
+  Json::JsonParser parser(js_str);
+  parser.use_index(index);
+  auto js = parser.parse();
+  set_err = parser.parse_error();
+  auto plain = Json::parse(js_str,[&set_err](Json::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == false);
+  REQUIRE(js.dump() == plain.dump());
+
+  std::string val;
+  js.get(1).get(0).get(0).get(1).get(0).get("key").get(2).map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "a,b]");
+}
+
+TEST_CASE("Escaped backslash before closing quote","[json_parse]")
+{
+  bool set_err = false;
+  auto js = Json::parse("[\"a\\\\\",\"this is a longer string with \\\"quotes\\\" inside of it\",1]",[&set_err](Json::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == false);
+  REQUIRE(js.size() == 3);
+
+  std::string val;
+  js.get(0).map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "a\\");
+  js.get(1).map_string([&val](std::string &v){val = v;});
+  REQUIRE(val == "this is a longer string with \"quotes\" inside of it");
+}
+
+TEST_CASE("Unterminated long string","[json_parse]")
+{
+  bool set_err = false;
+  auto js = Json::parse("[\"this string is longer than one block but never ends \\\"",[&set_err](Json::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == true);
+}
+
+TEST_CASE("Number parsing with exponents","[json_parse]")
+{
+  bool set_err = false;
+  auto js = Json::parse("[1e3,-2.5E-2,12,-9223372036854775808,1.5e+2]",[&set_err](Json::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == false);
+  REQUIRE(js.size() == 5);
+  REQUIRE(js.get(0).type() == JsonType::floating_point);
+  REQUIRE(js.get(1).type() == JsonType::floating_point);
+  REQUIRE(js.get(2).type() == JsonType::integer);
+  REQUIRE(js.get(3).dump() == "-9223372036854775808");
+  REQUIRE(js.get(4).type() == JsonType::floating_point);
+
+  JsonNumber number;
+  const char str[] = "-2.5E-2";
+  REQUIRE(json_parse_number(str,str+sizeof(str)-1,number) == str+sizeof(str)-1);
+  REQUIRE(number.is_float == true);
+  REQUIRE(number.floating == -0.025);
+}
+
+TEST_CASE("Number parsing stops at the end of the view","[json_parse]")
+{
+  bool set_err = false;
+  std::string js_str = "[123]456";
+  auto js = Json::parse(std::string_view(js_str).substr(1,3),[&set_err](Json::JsonParser&){set_err = true;});
+
+  REQUIRE(set_err == false);
+  REQUIRE(js.type() == JsonType::integer);
+  REQUIRE(js.dump() == "123");
+}
+
+TEST_CASE("Dumping into sinks","[json_dump]")
+{
+  bool set_err = false;
+  std::string js_str = "[{\"key\":\"va\\\"lue\"},[true,false,null],-42,[]]";
+  auto js = Json::parse(js_str,[&set_err](Json::JsonParser&){set_err = true;});
+  REQUIRE(set_err == false);
+  REQUIRE(js.dump() == js_str);
+
+  std::string prefixed = "x=";
+  {
+    JsonStringSink sink(prefixed);
+    js.dump(sink);
+  }
+  REQUIRE(prefixed == "x=" + js_str);
+
+  std::stringstream stream;
+  js.dump(stream);
+  REQUIRE(stream.str() == js_str);
+
+  std::vector<std::string> chunks;
+  {
+    JsonChunkedSink sink(64,[&chunks](std::string_view chunk){chunks.emplace_back(chunk);});
+    for (int i = 0; i < 10; i++)
+      js.dump(sink);
+  }
+  std::string joined;
+  for (const auto &chunk : chunks) {
+    REQUIRE(chunk.size() <= 64);
+    joined += chunk;
+  }
+  REQUIRE(chunks.size() > 1);
+  REQUIRE(joined.size() == 10*js_str.size());
+  REQUIRE(joined.substr(0,js_str.size()) == js_str);
+}
+
+TEST_CASE("Dumping deeply nested arrays","[json_dump]")
+{
+  bool set_err = false;
+  std::string js_str = std::string(500,'[') + "1" + std::string(500,']');
+  auto js = Json::parse(js_str,[&set_err](Json::JsonParser&){set_err = true;});
+  REQUIRE(set_err == false);
+  REQUIRE(js.dump() == js_str);
+}
+
+TEST_CASE("Dumping in parallel","[json_dump]")
+{
+  std::string array = "[";
+  std::string object = "{";
+  for (int i = 0; i < 20000; i++) {
+    if (i) {
+      array += ",";
+      object += ",";
+    }
+    array += "{\"id\":" + std::to_string(i) + ",\"v\":[1.5,\"a\\\"b\"]}";
+    object += "\"k\\n" + std::to_string(i) + "\":" + std::to_string(i);
+  }
+  array += "]";
+  object += "}";
+
+  auto js = FlatJson::parse(array,[](FlatJson::JsonParser&){REQUIRE(false);});
+  auto obj = FlatJson::parse(object,[](FlatJson::JsonParser&){REQUIRE(false);});
+  for (unsigned threads : {1u,4u}) {
+    REQUIRE(js.dump_parallel(threads) == array);
+    REQUIRE(obj.dump_parallel(threads) == object);
+
+    std::vector<std::string> parts;
+    js.dump_stream([&parts](std::string_view part){parts.emplace_back(part);},threads);
+    REQUIRE(parts.size() > 1);
+    std::string joined;
+    for (const auto &part : parts)
+      joined += part;
+    REQUIRE(joined == array);
+
+    std::string prefixed = "x=";
+    {
+      JsonStringSink sink(prefixed);
+      obj.dump_parallel(sink,threads);
+    }
+    REQUIRE(prefixed == "x=" + object);
+
+    // A throwing writer stops the workers, which are joined before the
+    // exception arrives here.
+    std::size_t calls = 0;
+    REQUIRE_THROWS_AS(js.dump_stream([&calls](std::string_view){if (++calls == 2) throw std::runtime_error("full");},threads),std::runtime_error);
+    REQUIRE(calls == 2);
+  }
+
+  for (std::string small : {"[]","{}","1.5","\"s\"","[1]","{\"a\":{}}"})
+    REQUIRE(Json::parse(small,[](Json::JsonParser&){}).dump_parallel(3) == small);
+}
+
+TEST_CASE("Doubles are dumped with the shortest round trip","[json_dump]")
+{
+  bool set_err = false;
+  auto js = Json::parse("[0.1,-2.5,1e300,3.0,123456.789,-0.0]",[&set_err](Json::JsonParser&){set_err = true;});
+  REQUIRE(set_err == false);
+
+  REQUIRE(js.get(0).dump() == "0.1");
+  REQUIRE(js.get(1).dump() == "-2.5");
+  REQUIRE(js.get(3).dump() == "3.0");
+  REQUIRE(js.get(4).dump() == "123456.789");
+  REQUIRE(js.get(5).dump() == "-0.0");
+
+  auto js2 = Json::parse(js.dump(),[&set_err](Json::JsonParser&){set_err = true;});
+  REQUIRE(set_err == false);
+  REQUIRE(js2.dump() == js.dump());
+  for (int i = 0; i < js.size(); i++)
+    REQUIRE(js2.get(i).type() == JsonType::floating_point);
+
+  char buffer[32];
+  REQUIRE(std::string(buffer,json_format_double(1.0/0.0,buffer)) == "null");
+  REQUIRE(std::string(buffer,json_format_integer(-9223372036854775807LL-1,buffer)) == "-9223372036854775808");
+  REQUIRE(std::string(buffer,json_format_integer(0,buffer)) == "0");
+}
+
+TEST_CASE("Scalars are stored inline","[json_value]")
+{
+  REQUIRE(sizeof(Json) <= 16);
+
+  bool set_err = false;
+  auto js = Json::parse("[null,true,-7,2.5,\"str\",{\"k\":[1]}]",[&set_err](Json::JsonParser&){set_err = true;});
+  REQUIRE(set_err == false);
+  REQUIRE(js.get(0).type() == JsonType::null);
+  REQUIRE(js.get(1).type() == JsonType::boolean);
+  REQUIRE(js.get(2).type() == JsonType::integer);
+  REQUIRE(js.get(3).type() == JsonType::floating_point);
+  REQUIRE(js.get(5).get("k").get(0).type() == JsonType::integer);
+
+  int value = 0;
+  js.get(2).map_int([&value](int x){value = x;});
+  REQUIRE(value == -7);
+
+  // Container calls on scalars report an error and release the value.
+  js.get(3).map_int([&value](int x){value = x;});
+  REQUIRE(js.get(3).has_error());
+  js.get(2).push_back(10ll);
+  REQUIRE(js.get(2).error() == JsonError::not_implemented);
+
+  js.push_back(nullptr).push_back(1.0);
+  REQUIRE(js.size() == 8);
+  REQUIRE(js.dump() == "[null,true,-7,2.5,\"str\",{\"k\":[1]},null,1.0]");
+
+  Json moved(std::move(js));
+  REQUIRE(js.type() == JsonType::null);
+  REQUIRE(moved.size() == 8);
+}
+
+TEST_CASE("References into containers","[json_value]")
+{
+  // The attributes of hashed objects keep their place.
+  auto hashed = Json::parse("{\"a\":\"x\"}",[](Json::JsonParser&){});
+  auto &a = hashed.get("a");
+  for (long long i = 0; i < 1000; i++)
+    hashed.set("k" + std::to_string(i),i);
+  REQUIRE(&a == &hashed.get("a"));
+  REQUIRE(a.dump() == "\"x\"");
+
+  // Items of arrays and flat objects move when the container grows, looked
+  // up again they keep their values and children.
+  auto array = FlatJson::parse("[\"a\",{\"k\":[1,2]}]",[](FlatJson::JsonParser&){});
+  auto flat = FlatJson::parse("{\"a\":{\"k\":[1,2]}}",[](FlatJson::JsonParser&){});
+  for (long long i = 0; i < 1000; i++) {
+    array.push_back(i);
+    flat.set("k" + std::to_string(i),i);
+  }
+  REQUIRE(array.get(0).dump() == "\"a\"");
+  REQUIRE(array.get(1).dump() == "{\"k\":[1,2]}");
+  REQUIRE(array.get(1001).dump() == "999");
+  REQUIRE(flat.get("a").get("k").dump() == "[1,2]");
+  REQUIRE(flat.size() == 1001);
+}
+
+TEST_CASE("Flat objects keep the insertion order","[json_flat]")
+{
+  bool set_err = false;
+  std::string js_str = "{\"zeta\":1,\"alpha\":{\"y\":true,\"x\":null},\"mid\":[1,2]}";
+  auto js = FlatJson::parse(js_str,[&set_err](FlatJson::JsonParser&){set_err = true;});
+  REQUIRE(set_err == false);
+  REQUIRE(js.dump() == js_str);
+
+  std::vector<std::string> keys;
+  js.map_object([&keys](const std::string &key, FlatJson&){keys.push_back(key);});
+  REQUIRE(keys == std::vector<std::string>{"zeta","alpha","mid"});
+
+  // Overwriting keeps the position
+  js.set("zeta",5ll).set("new","value");
+  REQUIRE(js.dump() == "{\"zeta\":5,\"alpha\":{\"y\":true,\"x\":null},\"mid\":[1,2],\"new\":\"value\"}");
+
+  auto dup = FlatJson::parse("{\"a\":1,\"b\":2,\"a\":3}",[&set_err](FlatJson::JsonParser&){set_err = true;});
+  REQUIRE(dup.size() == 2);
+  REQUIRE(dup.dump() == "{\"a\":3,\"b\":2}");
+}
+
+TEST_CASE("Flat objects index many attributes","[json_flat]")
+{
+  FlatJson js;
+  for (long long i = 0; i < 100; i++)
+    js.set("key" + std::to_string(i),i);
+  js.set("key42",-1ll);
+  REQUIRE(js.size() == 100);
+
+  for (int i = 0; i < 100; i++) {
+    int value = 0;
+    js.get("key" + std::to_string(i)).map_int([&value](int x){value = x;});
+    REQUIRE(value == (i == 42 ? -1 : i));
+  }
+  js.get("missing");
+  REQUIRE(js.error() == JsonError::does_not_exist);
+}
+
+TEST_CASE("Shaped objects share their keys","[json_shape]")
+{
+  std::string json = "[";
+  for (int i = 0; i < 50; i++)
+    json += std::string(i ? "," : "") + (i % 5 ? "{\"id\":" : "{\"other\":0,\"id\":") + std::to_string(i) + ",\"name\":\"n" + std::to_string(i) + "\",\"id\":" + std::to_string(i*2) + "}";
+  json += "]";
+  auto js = ShapedJson::parse(json,[](ShapedJson::JsonParser&){REQUIRE(false);});
+  REQUIRE(js.dump() == FlatJson::parse(json,[](FlatJson::JsonParser&){}).dump());
+  // Threads create and release the shapes concurrently.
+  REQUIRE(ShapedJson::parse_parallel(json,[](ShapedJson::JsonParser&){REQUIRE(false);},JsonParseOptions(),4).dump() == js.dump());
+
+  // The cached key is found again for every change of the shape.
+  JsonCachedKey id("id");
+  JsonCachedKey missing("missing");
+  for (int i = 0; i < 50; i++) {
+    int value = 0;
+    js.get(i).get(id).map_int([&value](int x){value = x;});
+    REQUIRE(value == i*2);
+    js.get(i).get(missing);
+    REQUIRE(js.get(i).error() == JsonError::does_not_exist);
+  }
+  REQUIRE(js.get(3).size() == 2);
+  js.get(3).set("extra",true).set("id",1ll);
+  REQUIRE(js.get(3).dump() == "{\"id\":1,\"name\":\"n3\",\"extra\":true}");
+
+  // Objects with too many keys keep working without a shape.
+  ShapedJson wide;
+  for (long long i = 0; i < 100; i++)
+    wide.set("key" + std::to_string(i),i);
+  wide.set("key42",-1ll);
+  REQUIRE(wide.size() == 100);
+  for (int i = 0; i < 100; i++) {
+    int value = 0;
+    wide.get("key" + std::to_string(i)).map_int([&value](int x){value = x;});
+    REQUIRE(value == (i == 42 ? -1 : i));
+  }
+  JsonCachedKey key("key7");
+  REQUIRE_FALSE(wide.get(key).has_error());
+  REQUIRE(wide.get(id).has_error());
+  REQUIRE_FALSE(Json::parse("{\"key7\":1}",[](Json::JsonParser&){}).get(key).has_error());
+
+  // Objects differing from the shared keys of their array store their keys.
+  std::string mixed = "[{\"a\":1,\"b\":2},{\"a\":3,\"b\":4},{\"a\":5},{\"a\":6,\"b\":7,\"c\":8},{\"b\":9,\"a\":0},"
+                      "{\"a\":1,\"b\":2,\"a\":3},[{\"x\":[{\"y\":1},{\"y\":2}]},{\"x\":[]}],{},{}]";
+  auto shaped = ShapedJson::parse(mixed,[](ShapedJson::JsonParser&){REQUIRE(false);});
+  REQUIRE(shaped.dump() == FlatJson::parse(mixed,[](FlatJson::JsonParser&){}).dump());
+  REQUIRE(ShapedJson::parse_parallel(mixed,[](ShapedJson::JsonParser&){REQUIRE(false);},JsonParseOptions(),2).dump() == shaped.dump());
+  shaped.get(2).get("b");
+  REQUIRE(shaped.get(2).error() == JsonError::does_not_exist);
+  JsonCachedKey c("c");
+  REQUIRE(shaped.get(3).get(c).dump() == "8");
+  REQUIRE(shaped.get(1).get(c).has_error());
+  shaped.get(1).set("c",true);
+  REQUIRE(shaped.get(1).dump() == "{\"a\":3,\"b\":4,\"c\":true}");
+  REQUIRE(shaped.get(0).dump() == "{\"a\":1,\"b\":2}");
+  REQUIRE(shaped.get(5).dump() == "{\"a\":3,\"b\":2}");
+
+  // Objects with unique keys never create shapes.
+  std::string unique = "[";
+  for (int i = 0; i < 200; i++)
+    unique += std::string(i ? "," : "") + "{\"k" + std::to_string(i) + "\":" + std::to_string(i) + "}";
+  unique += "]";
+  auto distinct = ShapedJson::parse(unique,[](ShapedJson::JsonParser&){REQUIRE(false);});
+  REQUIRE(distinct.dump() == unique);
+  REQUIRE(distinct.get(150).get("k150").dump() == "150");
+
+  std::vector<std::string> keys;
+  ShapedJson::parse("{\"b\":1,\"a\":{\"c\":2}}",[](ShapedJson::JsonParser&){}).map_object([&keys](const std::string &key, ShapedJson&){keys.push_back(key);});
+  REQUIRE(keys == std::vector<std::string>{"b","a"});
+}
+
+TEST_CASE("Stream parser accepts arbitrary chunks","[json_stream]")
+{
+  std::string js_str = "{\"key\":[1,-2.5e1,true,false,null,\"str\\\"ing\\u00e4\"],\"nested\":{\"a\":{}},\"empty\":[]}";
+  auto expected = Json::parse(js_str,[](Json::JsonParser&){});
+
+  for (std::size_t chunk : {std::size_t(1),std::size_t(3),std::size_t(7),js_str.size()}) {
+    Json::JsonStreamParser parser;
+    for (std::size_t i = 0; i < js_str.size(); i += chunk)
+      REQUIRE(parser.feed(std::string_view(js_str).substr(i,chunk)));
+    REQUIRE(parser.done());
+    REQUIRE(parser.finish());
+    auto js = parser.result();
+    REQUIRE(js.has_error() == false);
+    REQUIRE(js.dump() == expected.dump());
+  }
+
+  // Numbers and literals at the very end are completed by finish
+  ArenaJson::JsonStreamParser number;
+  number.feed("12");
+  number.feed("34");
+  REQUIRE(number.done() == false);
+  REQUIRE(number.finish());
+  REQUIRE(number.result().dump() == "1234");
+}
+
+TEST_CASE("Stream parser errors","[json_stream]")
+{
+  Json::JsonStreamParser unclosed;
+  REQUIRE(unclosed.feed("[1,{\"a\":"));
+  REQUIRE(unclosed.finish() == false);
+  REQUIRE(unclosed.error() == Json::JsonParser::JsonParserError::unexpected_end_of_json);
+  REQUIRE(unclosed.result().has_error());
+
+  Json::JsonStreamParser missing_comma;
+  REQUIRE(missing_comma.feed("[1 2]") == false);
+  REQUIRE(missing_comma.error() == Json::JsonParser::JsonParserError::expected_comma_before_next_array_item);
+  REQUIRE(missing_comma.position() == 3);
+
+  Json::JsonStreamParser literal;
+  literal.feed("[tru");
+  REQUIRE(literal.feed("x]") == false);
+
+  Json::JsonStreamParser trailing;
+  REQUIRE(trailing.feed("{} ") == true);
+  REQUIRE(trailing.feed("{}") == false);
+  REQUIRE(trailing.error() == Json::JsonParser::JsonParserError::unexpected_character_after_json);
+
+  Json::JsonStreamParser string;
+  string.feed("\"abc\\");
+  REQUIRE(string.finish() == false);
+  REQUIRE(string.error() == Json::JsonParser::JsonParserError::expected_closing_quote_but_got_eos);
+}
+
+namespace {
+  /**
+   * @brief Counts the events and remembers the value of the key "id".
+   */
+  struct CountingHandler {
+    int values = 0;
+    int containers = 0;
+    long long id = -1;
+    bool next_is_id = false;
+    std::string last_string;
+    bool stop_after_id = false;
+
+    bool null() { values++; return true; }
+    bool boolean(bool) { values++; return true; }
+    bool integer(long long x) {
+      values++;
+      if (next_is_id)
+        id = x;
+      next_is_id = false;
+      return !(stop_after_id && id != -1);
+    }
+    bool floating(double) { values++; return true; }
+    bool string(std::string_view x) { values++; last_string = std::string(x); return true; }
+    bool key(std::string_view x) { next_is_id = x == "id"; return true; }
+    bool start_object() { containers++; return true; }
+    bool end_object() { return true; }
+    bool start_array() { containers++; return true; }
+    bool end_array() { return true; }
+  };
+}
+
+TEST_CASE("Event parsing without a DOM","[json_sax]")
+{
+  std::string js_str = "{\"list\":[1,2.5,null,true,\"a\\nb\"],\"id\":42,\"tail\":{\"x\":[]}}";
+  CountingHandler handler;
+  REQUIRE(Json::parse_events(js_str,handler) == Json::JsonParser::JsonParserError::ok);
+  REQUIRE(handler.values == 6);
+  REQUIRE(handler.containers == 4);
+  REQUIRE(handler.id == 42);
+  REQUIRE(handler.last_string == "a\nb");
+
+  CountingHandler stopping;
+  stopping.stop_after_id = true;
+  REQUIRE(Json::parse_events(js_str,stopping) == Json::JsonParser::JsonParserError::aborted_by_handler);
+  REQUIRE(stopping.containers == 2);
+
+  CountingHandler invalid;
+  REQUIRE(Json::parse_events("[1,,2]",invalid) == Json::JsonParser::JsonParserError::expected_comma_before_next_array_item);
+}
+
+TEST_CASE("Nesting deeper than the maximum depth","[json_parse]")
+{
+  std::string hostile(1000000,'[');
+  bool set_err = false;
+  auto js = Json::parse(hostile,[&set_err](Json::JsonParser &parser){
+    set_err = parser.error_ == Json::JsonParser::JsonParserError::exceeded_max_depth;
+  });
+  REQUIRE(set_err == true);
+  REQUIRE(js.has_error());
+
+  // The parser itself does not recurse, only the DOM limits the depth.
+  JsonParseOptions options;
+  options.max_depth = hostile.size();
+  CountingHandler handler;
+  REQUIRE(Json::parse_events(hostile + std::string(hostile.size(),']'),handler,options) == Json::JsonParser::JsonParserError::ok);
+  REQUIRE(handler.containers == (int)hostile.size());
+
+  // Mixed nesting beyond the containers kept inside the parser.
+  std::string mixed;
+  for (int i = 0; i < 300; i++)
+    mixed += i % 2 ? "{\"k\":" : "[1,";
+  mixed += "0";
+  for (int i = 299; i >= 0; i--)
+    mixed += i % 2 ? ",\"x\":null}" : "]";
+  auto deep = Json::parse(mixed,[](Json::JsonParser&){REQUIRE(false);});
+  REQUIRE(deep.dump().size() == mixed.size());
+  options.max_depth = 300;
+  REQUIRE(Json::parse_events(mixed,handler,options) == Json::JsonParser::JsonParserError::ok);
+  options.max_depth = 299;
+  REQUIRE(Json::parse_events(mixed,handler,options) == Json::JsonParser::JsonParserError::exceeded_max_depth);
+
+  Json::JsonStreamParser stream(3);
+  REQUIRE(stream.feed("[{\"a\":[]}]"));
+  Json::JsonStreamParser too_deep(3);
+  REQUIRE(too_deep.feed("[{\"a\":[[]]}]") == false);
+  REQUIRE(too_deep.error() == Json::JsonParser::JsonParserError::exceeded_max_depth);
+
+  std::string nested_tags = std::string(5000,(char)0xc1) + "\x01";
+  Json::JsonCborParser tags(nested_tags);
+  REQUIRE(tags.parse_events(handler) == false);
+  REQUIRE(tags.error() == Json::JsonParser::JsonParserError::exceeded_max_depth);
+}
+
+TEST_CASE("Parsing newline delimited json","[json_many]")
+{
+  std::string ndjson;
+  for (int i = 0; i < 1000; i++)
+    ndjson += "{\"id\":" + std::to_string(i) + ",\"v\":[" + std::to_string(i) + ".5]}\r\n" + ((i % 100 == 0) ? "\n  \n" : "");
+  ndjson += "[1,,2]";
+
+  for (unsigned threads : {1u,4u}) {
+    auto records = ArenaJson::parse_many(ndjson,JsonParseOptions(),threads);
+    REQUIRE(records.size() == 1001);
+    for (int i = 0; i < 1000; i++) {
+      int id = -1;
+      records[i].get("id").map_int([&id](int x){id = x;});
+      REQUIRE(id == i);
+      REQUIRE(records.parse_error(i) == ArenaJson::JsonParser::JsonParserError::ok);
+    }
+    REQUIRE(records[1000].has_error());
+    REQUIRE(records.parse_error(1000) == ArenaJson::JsonParser::JsonParserError::expected_comma_before_next_array_item);
+  }
+
+  auto heap = Json::parse_many("[1]\n\"a\"\n",JsonParseOptions(),0);
+  REQUIRE(heap.size() == 2);
+  REQUIRE(heap[1].dump() == "\"a\"");
+}
+
+TEST_CASE("Parsing large arrays in parallel","[json_parallel]")
+{
+  std::string json = " [";
+  for (int i = 0; i < 3000; i++) {
+    if (i)
+      json += i % 7 ? "," : " ,\n ";
+    switch (i % 4) {
+      case 0: json += "{\"id\":" + std::to_string(i) + ",\"tags\":[\"a,]\",\"b\\\"}\"],\"o\":{\"x\":[[]]}}"; break;
+      case 1: json += std::to_string(i) + ".25"; break;
+      case 2: json += "[null,true,\"[\"]"; break;
+      default: json += "\"s" + std::to_string(i) + "\"";
+    }
+  }
+  json += "] ";
+
+  std::string expected = FlatJson::parse(json,[](FlatJson::JsonParser&){REQUIRE(false);}).dump();
+  for (unsigned threads : {1u,4u}) {
+    auto flat = FlatJson::parse_parallel(json,[](FlatJson::JsonParser&){REQUIRE(false);},JsonParseOptions(),threads);
+    REQUIRE(flat.dump() == expected);
+    REQUIRE(Json::parse_parallel(json,[](Json::JsonParser&){REQUIRE(false);},JsonParseOptions(),threads).size() == 3000);
+
+    auto arena = ArenaJson::parse_parallel(json,[](ArenaJson::JsonParser&){REQUIRE(false);},JsonParseOptions(),threads);
+    REQUIRE(arena.size() == 3000);
+    // Items keep allocating from the arena of the worker which parsed them.
+    arena.get(2996).get("tags").push_back("c");
+    REQUIRE(arena.get(2996).get("tags").size() == 3);
+  }
+
+  for (std::string same : {"[]"," [ ] ","{\"a\":[1,2]}","[1 2]","[1,]","[1,2","7"}) {
+    auto js = Json::parse_parallel(same,[](Json::JsonParser&){REQUIRE(false);},JsonParseOptions(),2);
+    REQUIRE(js.dump() == Json::parse(same,[](Json::JsonParser&){}).dump());
+  }
+
+  for (std::string broken : {"[1,,2]","[1,{\"a\" 2}]","[1,\"x]"}) {
+    int calls = 0;
+    auto js = ArenaJson::parse_parallel(broken,[&calls](ArenaJson::JsonParser&){calls++;},JsonParseOptions(),2);
+    REQUIRE(calls == 1);
+    REQUIRE(js.has_error());
+  }
+
+  // The root array counts for max_depth like in parse(...).
+  std::string nested = "[";
+  for (int i = 0; i < 1000; i++)
+    nested += std::string(i ? "," : "") + (i == 500 ? "[[1]]" : "[1]");
+  nested += "]";
+  for (std::string deep : {std::string("[[[1]]]"),nested}) {
+    for (std::size_t max_depth : {0,1,2,3}) {
+      JsonParseOptions limited;
+      limited.max_depth = max_depth;
+      auto error = Json::JsonParser::JsonParserError::ok;
+      auto expected_error = Json::JsonParser::JsonParserError::ok;
+      auto js = Json::parse_parallel(deep,[&error](Json::JsonParser &p){error = p.error_;},limited,4);
+      auto expected = Json::parse(deep,[&expected_error](Json::JsonParser &p){expected_error = p.error_;},limited);
+      REQUIRE(error == expected_error);
+      REQUIRE(js.has_error() == expected.has_error());
+      REQUIRE(js.dump() == expected.dump());
+    }
+  }
+  JsonParseOptions two;
+  two.max_depth = 2;
+  auto error = Json::JsonParser::JsonParserError::ok;
+  Json::parse_parallel("[[[1]]]",[&error](Json::JsonParser &p){error = p.error_;},two,4);
+  REQUIRE(error == Json::JsonParser::JsonParserError::exceeded_max_depth);
+
+#if defined(GC_JSON_MMAP) && defined(MAP_NORESERVE)
+  // Positions are int, larger json are rejected before the first character
+  // is read, so the untouched pages are never backed by memory.
+  const std::size_t huge = (std::size_t)INT_MAX + 1;
+  void *pages = mmap(nullptr,huge,PROT_READ,MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,-1,0);
+  if (pages != MAP_FAILED) {
+    std::string_view view(static_cast<const char*>(pages),huge);
+    Json::JsonParser::JsonParserError error = Json::JsonParser::JsonParserError::ok;
+    auto js = Json::parse_parallel(view,[&error](Json::JsonParser &p){error = p.error_;},JsonParseOptions(),2);
+    REQUIRE(js.has_error());
+    REQUIRE(error == Json::JsonParser::JsonParserError::exceeded_max_length);
+    munmap(pages,huge);
+  }
+#endif
+}
+
+TEST_CASE("Parsing json files","[json_file]")
+{
+  const char *path = "json_file_test.json";
+  {
+    std::FILE *file = std::fopen(path,"wb");
+    REQUIRE(file != nullptr);
+    std::fputs("{\"name\":\"mapped \\\"file\\\"\",\"list\":[1,2.5,true,null]}",file);
+    std::fclose(file);
+  }
+
+  auto doc = Json::parse_file(path,[](Json::JsonParser&){REQUIRE(false);});
+  REQUIRE_FALSE(doc->has_error());
+  REQUIRE(doc.file().is_open());
+#if defined(GC_JSON_MMAP)
+  REQUIRE(doc.file().is_mapped());
+#endif
+  auto moved = std::move(doc);
+  std::string name;
+  moved->get("name").map_string([&name](const std::string &x){name = x;});
+  REQUIRE(name == "mapped \"file\"");
+  // The order of the keys in the dump depends on the hash map.
+  REQUIRE(moved.root().size() == 2);
+  REQUIRE(moved->get("list").dump() == "[1,2.5,true,null]");
+
+  auto arena = ArenaJson::parse_file(path,[](ArenaJson::JsonParser&){REQUIRE(false);});
+  REQUIRE(arena->get("list").size() == 4);
+  std::remove(path);
+
+  auto missing = Json::parse_file("does_not_exist.json",[](Json::JsonParser&){});
+  REQUIRE(missing->has_error());
+  REQUIRE_FALSE(missing.file().is_open());
+}
+
+TEST_CASE("Lazy values parse only the accessed path","[json_lazy]")
+{
+  std::string json = " {\"skip\":{\"deep\":[1,{\"x\":\"}]\"},[[]]],\"s\":\"a\\\"]\"},\"a\":{\"b\":[10,true,\"t\\u0041b\"],\"k\\\\ey\":1.5},\"last\":null} ";
+  JsonStructuralIndex index;
+  index.build(json);
+
+  for (const JsonStructuralIndex *idx : {(const JsonStructuralIndex*)nullptr,(const JsonStructuralIndex*)&index}) {
+    auto root = Json::parse_lazy(json,idx);
+    REQUIRE(root.type() == JsonType::object);
+    REQUIRE(root.size() == 3);
+
+    int value = 0;
+    root.get("a").get("b").get(0).map_int([&value](int x){value = x;});
+    REQUIRE(value == 10);
+    bool flag = false;
+    root.get("a").get("b").get(1).map_bool([&flag](bool x){flag = x;});
+    REQUIRE(flag);
+    std::string str;
+    root.get("a").get("b").get(2).map_string([&str](std::string &x){str = x;});
+    REQUIRE(str == "tAb");
+    REQUIRE(root.get("a").get("k\\ey").type() == JsonType::floating_point);
+    REQUIRE(root.get("a").get("k\\ey").raw() == "1.5");
+    REQUIRE(root.get("last").type() == JsonType::null);
+    REQUIRE(root.get("skip").raw() == "{\"deep\":[1,{\"x\":\"}]\"},[[]]],\"s\":\"a\\\"]\"}");
+    REQUIRE(root.get("skip").get("deep").size() == 3);
+
+    REQUIRE(root.get("missing").error() == JsonError::does_not_exist);
+    REQUIRE(root.get("a").get("b").get(3).error() == JsonError::does_not_exist);
+    REQUIRE(root.get("last").get("x").error() == JsonError::not_implemented);
+
+    std::vector<std::string> keys;
+    root.map_object([&keys](const std::string &key, Json::JsonLazy&){keys.push_back(key);});
+    REQUIRE(keys == std::vector<std::string>({"skip","a","last"}));
+
+    auto js = root.get("a").materialize();
+    REQUIRE_FALSE(js.has_error());
+    REQUIRE(js.get("b").size() == 3);
+  }
+
+  REQUIRE(Json::parse_lazy("   ").has_error());
+  REQUIRE(Json::parse_lazy("{\"a\":[1,2").get("a").has_error() == false);
+  REQUIRE(Json::parse_lazy("{\"a\":[1,2").get("a").raw().empty());
+}
+
+TEST_CASE("Json pointer queries","[json_path]")
+{
+  JsonPath escaped("/a~1b/m~0n/3");
+  REQUIRE(escaped.valid());
+  REQUIRE(escaped.size() == 3);
+  REQUIRE(escaped[0].key == "a/b");
+  REQUIRE(escaped[1].key == "m~n");
+  REQUIRE(escaped[1].index == -1);
+  REQUIRE(escaped[2].index == 3);
+  REQUIRE(JsonPath("").size() == 0);
+  REQUIRE(JsonPath("/").size() == 1);
+  REQUIRE_FALSE(JsonPath("a/b").valid());
+  REQUIRE_FALSE(JsonPath("/a~2").valid());
+  REQUIRE(JsonPath("/01")[0].index == -1);
+  REQUIRE(JsonPath("/-")[0].index == -1);
+
+  std::string text = "{\"a\":{\"b\":[10,20,{\"c\":\"x\"}]},\"k/\":true,\"n\":[[1],[2,3]]}";
+  auto js = Json::parse(text,[](Json::JsonParser&){});
+
+  int value = 0;
+  js.get(JsonPath("/a/b/1")).map_int([&value](int x){value = x;});
+  REQUIRE(value == 20);
+  REQUIRE(js.get(JsonPath("/a/b/2/c")).dump() == "\"x\"");
+  REQUIRE(js.get(JsonPath("/k~1")).dump() == "true");
+  REQUIRE(js.get(JsonPath("/n/1/0")).dump() == "2");
+  REQUIRE(&js.get(JsonPath("")) == &js);
+  REQUIRE_FALSE(js.has_error());
+  REQUIRE(&js.get(JsonPath("/a/b/3")) == &js);
+  REQUIRE(js.error() == JsonError::does_not_exist);
+
+  auto lazy = Json::parse_lazy(text);
+  REQUIRE(lazy.get(JsonPath("/a/b/2/c")).raw() == "\"x\"");
+  REQUIRE(lazy.get(JsonPath("/n/1/1")).raw() == "3");
+  REQUIRE(lazy.get(JsonPath("/a/x")).error() == JsonError::does_not_exist);
+
+  std::vector<JsonPath> paths = {JsonPath("/n/1/1"),JsonPath("/a/b/0"),JsonPath("/missing"),JsonPath("/a/b/2/c"),JsonPath(""),JsonPath("/a/b/0")};
+  std::vector<std::string> found(paths.size());
+  lazy.select(paths,[&found](std::size_t i, Json::JsonLazy &value){found[i] = std::string(value.raw());});
+  REQUIRE(found == std::vector<std::string>({"3","10","","\"x\"",text,"10"}));
+}
+
+namespace {
+std::string hex(const std::string &bytes) {
+  static const char digits[] = "0123456789abcdef";
+  std::string ret;
+  for (unsigned char c : bytes) {
+    ret += digits[c >> 4];
+    ret += digits[c & 15];
+  }
+  return ret;
+}
+
+std::string unhex(const std::string &text) {
+  std::string ret;
+  for (std::size_t i = 0; i+1 < text.size(); i += 2)
+    ret += (char)std::stoi(text.substr(i,2),nullptr,16);
+  return ret;
+}
+}
+
+TEST_CASE("Encoding cbor","[json_cbor]")
+{
+  REQUIRE(hex(Json::parse("0",[](Json::JsonParser&){}).dump_cbor()) == "00");
+  REQUIRE(hex(Json::parse("23",[](Json::JsonParser&){}).dump_cbor()) == "17");
+  REQUIRE(hex(Json::parse("24",[](Json::JsonParser&){}).dump_cbor()) == "1818");
+  REQUIRE(hex(Json::parse("1000",[](Json::JsonParser&){}).dump_cbor()) == "1903e8");
+  REQUIRE(hex(Json::parse("-1000",[](Json::JsonParser&){}).dump_cbor()) == "3903e7");
+  REQUIRE(hex(Json::parse("1.5",[](Json::JsonParser&){}).dump_cbor()) == "fa3fc00000");
+  REQUIRE(hex(Json::parse("1.1",[](Json::JsonParser&){}).dump_cbor()) == "fb3ff199999999999a");
+  REQUIRE(hex(Json::parse("[true,false,null]",[](Json::JsonParser&){}).dump_cbor()) == "83f5f4f6");
+  REQUIRE(hex(FlatJson::parse("{\"a\":\"b\",\"c\":[]}",[](FlatJson::JsonParser&){}).dump_cbor()) == "a2616161626163" "80");
+
+  std::string out;
+  JsonStringSink sink(out);
+  JsonCborWriter writer(sink);
+  REQUIRE(Json::parse_events("{\"a\":[1,\"x\\ny\"]}",writer) == Json::JsonParser::JsonParserError::ok);
+  sink.flush();
+  REQUIRE(hex(out) == "bf6161" "9f0163780a79ff" "ff");
+
+  // Doubles out of the float range are never converted to float.
+  REQUIRE(hex(Json::parse("1e300",[](Json::JsonParser&){}).dump_cbor()) == "fb7e37e43c8800759c");
+  REQUIRE(hex(Json::parse("-3.5e38",[](Json::JsonParser&){}).dump_cbor()) == "fbc7f074f8c4d3cd7b");
+  std::string special;
+  JsonStringSink special_sink(special);
+  JsonCborWriter special_writer(special_sink);
+  special_writer.floating(-std::numeric_limits<double>::infinity());
+  special_writer.floating(std::numeric_limits<double>::quiet_NaN());
+  special_sink.flush();
+  REQUIRE(hex(special) == "faff800000" "fa7fc00000");
+}
+
+TEST_CASE("Decoding cbor","[json_cbor]")
+{
+  std::string text = "{\"list\":[1,-2,2.5,1e300,true,false,null,\"q\\\"uote\"],\"nested\":{\"k\":[[],{}]},\"s\":\"plain\"}";
+  auto js = FlatJson::parse(text,[](FlatJson::JsonParser&){});
+  std::string cbor = js.dump_cbor();
+  REQUIRE(cbor.size() < text.size());
+
+  for (bool borrow : {false,true}) {
+    JsonParseOptions options;
+    options.borrow_strings = borrow;
+    auto decoded = FlatJson::parse_cbor(cbor,[](FlatJson::JsonCborParser&){REQUIRE(false);},options);
+    REQUIRE_FALSE(decoded.has_error());
+    REQUIRE(decoded.dump() == js.dump());
+    auto arena = ArenaJson::parse_cbor(cbor,[](ArenaJson::JsonCborParser&){REQUIRE(false);},options);
+    REQUIRE(FlatJson::parse(arena.dump(),[](FlatJson::JsonParser&){}).size() == 3);
+    REQUIRE(arena.get("list").dump() == "[1,-2,2.5,1e+300,true,false,null,\"q\\\"uote\"]");
+  }
+
+  // Indefinite containers and strings, tags, half floats and undefined.
+  auto js2 = Json::parse_cbor(unhex("bf" "63616263" "9f" "7f626869626a6bff" "f93e00" "c11a514b67b0" "f7" "ff" "ff"),[](Json::JsonCborParser&){REQUIRE(false);});
+  REQUIRE(js2.dump() == "{\"abc\":[\"hijk\",1.5,1363896240,null]}");
+
+  // Large values.
+  REQUIRE(Json::parse_cbor(unhex("1bffffffffffffffff"),[](Json::JsonCborParser&){}).type() == JsonType::floating_point);
+  REQUIRE(Json::parse_cbor(unhex("3b7fffffffffffffff"),[](Json::JsonCborParser&){}).dump() == "-9223372036854775808");
+
+  Json::JsonCborParser::JsonParserError error = Json::JsonCborParser::JsonParserError::ok;
+  auto truncated = Json::parse_cbor(cbor.substr(0,cbor.size()-3),[&error](Json::JsonCborParser &parser){error = parser.error();});
+  REQUIRE(truncated.has_error());
+  REQUIRE(error == Json::JsonCborParser::JsonParserError::unexpected_end_of_json);
+  REQUIRE(Json::parse_cbor(unhex("a10102"),[&error](Json::JsonCborParser &parser){error = parser.error();}).has_error());
+  REQUIRE(error == Json::JsonCborParser::JsonParserError::expected_string_attribute_key);
+  REQUIRE(Json::parse_cbor(unhex("0101"),[&error](Json::JsonCborParser &parser){error = parser.error();}).has_error());
+  REQUIRE(error == Json::JsonCborParser::JsonParserError::unexpected_character_after_json);
+  REQUIRE(Json::parse_cbor(unhex("ff"),[](Json::JsonCborParser&){}).has_error());
+
+  CountingHandler counter;
+  REQUIRE(Json::parse_cbor_events(cbor,counter) == Json::JsonParser::JsonParserError::ok);
+  REQUIRE(counter.values == 9);
+  REQUIRE(counter.containers == 6);
+  REQUIRE(counter.last_string == "plain");
+}
+
+TEST_CASE("Tape snapshots","[json_tape]")
+{
+  std::string text = "{\"name\":\"cat\\\"alog\",\"count\":3,\"ratio\":0.25,\"items\":[{\"id\":1,\"ok\":true},{\"id\":2,\"ok\":false},{\"id\":3,\"ok\":null}],\"empty\":{}}";
+  auto js = FlatJson::parse(text,[](FlatJson::JsonParser&){});
+  std::string tape_bytes = js.dump_tape();
+
+  std::string streamed;
+  {
+    JsonTapeWriter writer;
+    REQUIRE(FlatJson::parse_events(text,writer) == FlatJson::JsonParser::JsonParserError::ok);
+    streamed = writer.finish();
+  }
+  REQUIRE(streamed == tape_bytes);
+
+  JsonTape tape(tape_bytes);
+  REQUIRE(tape.valid());
+  auto root = tape.root();
+  REQUIRE(root.type() == JsonType::object);
+  REQUIRE(root.size() == 5);
+  REQUIRE(root.dump() == js.dump());
+
+  std::string name;
+  root.get("name").map_string([&name](std::string &x){name = x;});
+  REQUIRE(name == "cat\"alog");
+  int id = 0;
+  root.get(JsonPath("/items/2/id")).map_int([&id](int x){id = x;});
+  REQUIRE(id == 3);
+  bool ok = true;
+  root.get("items").get(1).get("ok").map_bool([&ok](bool x){ok = x;});
+  REQUIRE_FALSE(ok);
+  REQUIRE(root.get("items").get(2).get("ok").type() == JsonType::null);
+  REQUIRE(root.get("ratio").type() == JsonType::floating_point);
+  REQUIRE(root.get("empty").size() == 0);
+  REQUIRE(root.get("missing").error() == JsonError::does_not_exist);
+  REQUIRE(root.get("items").get(3).error() == JsonError::does_not_exist);
+  REQUIRE(root.get("count").get(0).error() == JsonError::not_implemented);
+
+  int sum = 0;
+  root.get("items").map_array([&sum](JsonTapeValue &item){item.get("id").map_int([&sum](int x){sum += x;});});
+  REQUIRE(sum == 6);
+  std::vector<std::string> keys;
+  root.map_object([&keys](const std::string &key, JsonTapeValue&){keys.push_back(key);});
+  REQUIRE(keys == std::vector<std::string>({"name","count","ratio","items","empty"}));
+
+  const char *path = "json_tape_test.tape";
+  {
+    std::FILE *file = std::fopen(path,"wb");
+    REQUIRE(file != nullptr);
+    std::fwrite(tape_bytes.data(),1,tape_bytes.size(),file);
+    std::fclose(file);
+  }
+  JsonTape mapped(JsonMappedFile{path});
+  JsonTape moved(std::move(mapped));
+  REQUIRE(moved.valid());
+  REQUIRE(moved.root().dump() == js.dump());
+  std::remove(path);
+
+  REQUIRE_FALSE(JsonTape(std::string_view("not a tape, not a tape, not a tape")).valid());
+  REQUIRE(JsonTape(std::string_view(tape_bytes).substr(0,tape_bytes.size()-1)).root().has_error());
+  REQUIRE(Json::parse("[1,2]",[](Json::JsonParser&){}).dump_tape().size() == JsonTapeFormat::header_size + 6*8);
+
+  // Containers deeper than max_depth are dumped as null instead of
+  // overflowing the stack.
+  const std::size_t levels = 1000000;
+  std::string deep = std::string(levels,'[') + std::string(levels,']');
+  JsonParseOptions unlimited;
+  unlimited.max_depth = levels;
+  JsonTapeWriter deep_writer;
+  REQUIRE(Json::parse_events(deep,deep_writer,unlimited) == Json::JsonParser::JsonParserError::ok);
+  std::string deep_bytes = deep_writer.finish();
+  JsonTape deep_tape(deep_bytes);
+  const std::size_t max_depth = JsonParseOptions().max_depth;
+  REQUIRE(deep_tape.root().dump() == std::string(max_depth,'[') + "null" + std::string(max_depth,']'));
+}
+
+TEST_CASE("Callables passed to map functions","[json_value]")
+{
+  std::string text = "{\"plain\":\"abc\",\"escaped\":\"a\\nb\",\"list\":[1,2,3]}";
+  JsonParseOptions options;
+  options.borrow_strings = true;
+  auto js = FlatJson::parse(text,[](FlatJson::JsonParser&){},options);
+
+  // Views reference the parsed buffer unless the string has to be unescaped.
+  std::string_view view;
+  js.get("plain").map_string([&view](std::string_view x){view = x;});
+  REQUIRE(view == "abc");
+  REQUIRE(view.data() >= text.data());
+  REQUIRE(view.data() < text.data() + text.size());
+  std::string unescaped;
+  js.get("escaped").map_string([&unescaped](std::string_view x){unescaped = std::string(x);});
+  REQUIRE(unescaped == "a\nb");
+  std::string copy;
+  js.get("plain").map_string([&copy](std::string &x){copy = std::move(x);});
+  REQUIRE(copy == "abc");
+
+  // Move only callables and string_view keys.
+  auto sum = std::make_unique<int>(0);
+  js.get("list").map_array([sum = std::move(sum)](FlatJson &item) mutable {
+    item.map_int([&sum](int x){*sum += x;});
+    REQUIRE(*sum > 0);
+  });
+  std::vector<std::string> keys;
+  js.map_object([&keys](std::string_view key, FlatJson&){keys.emplace_back(key);});
+  REQUIRE(keys == std::vector<std::string>({"plain","escaped","list"}));
+  keys.clear();
+  js.map_object([&keys](const std::string &key, FlatJson&){keys.push_back(key);});
+  REQUIRE(keys.size() == 3);
+
+  bool called = false;
+  js.map([&called](){called = true;}).get("missing").error([](JsonError err){REQUIRE(err == JsonError::does_not_exist);});
+  REQUIRE(called);
+}
+
+namespace {
+  std::vector<std::string> logged;
+
+  struct RecordingFunctor {
+    RecordingFunctor(std::string x) {
+      logged.push_back(std::move(x));
+    }
+  };
+}
+
+TEST_CASE("Parse statistics","[json_stats]")
+{
+  using StatsJson = JsonBase<JsonLogLevel::log_stats,RecordingFunctor>;
+  using TraceJson = JsonBase<JsonLogLevel::log_trace,RecordingFunctor>;
+  std::string text = "{\"a\":[1,2.5,\"x\",true,null,[[]]],\"b\":{\"c\":false}}";
+
+  JsonParseStats stats;
+  auto js = StatsJson::parse(text,[](StatsJson::JsonParser&){},JsonParseOptions(),stats);
+  REQUIRE_FALSE(js.has_error());
+  REQUIRE(stats.bytes_scanned == text.size());
+  REQUIRE(stats.objects == 2);
+  REQUIRE(stats.arrays == 3);
+  REQUIRE(stats.keys == 3);
+  REQUIRE(stats.strings == 1);
+  REQUIRE(stats.integers == 1);
+  REQUIRE(stats.floats == 1);
+  REQUIRE(stats.booleans == 2);
+  REQUIRE(stats.nulls == 1);
+  REQUIRE(stats.max_depth == 4);
+  REQUIRE(stats.allocations == 7);
+  REQUIRE(stats.total_ns >= stats.string_ns + stats.number_ns);
+  REQUIRE(logged.empty());
+
+  JsonParseStats none;
+  Json::parse(text,[](Json::JsonParser&){},JsonParseOptions(),none);
+  REQUIRE(none.objects == 0);
+  REQUIRE(none.total_ns == 0);
+
+  StatsJson::parse("[1,,2]",[](StatsJson::JsonParser&){});
+  REQUIRE(logged.size() == 1);
+  REQUIRE(logged[0].find("Json parse error") == 0);
+  logged.clear();
+  TraceJson::parse(text,[](TraceJson::JsonParser&){});
+  REQUIRE(logged.size() == 1);
+  REQUIRE(logged[0].find("objects=2 arrays=3") != std::string::npos);
+  logged.clear();
+}
+
+struct BindAddress {
+  std::string city;
+  int zip = 0;
+};
+
+struct BindUser {
+  long long id = 0;
+  std::string name;
+  bool admin = false;
+  double score = 0;
+  std::vector<std::string> tags;
+  std::optional<int> age;
+  BindAddress address;
+  std::vector<BindAddress> previous;
+};
+
+struct BindRenamed {
+  unsigned value = 0;
+  std::vector<bool> flags;
+};
+
+GC_JSON_FIELDS(BindAddress,city,zip);
+GC_JSON_FIELDS(BindUser,id,name,admin,score,tags,age,address,previous);
+
+template<>
+struct JsonFields<BindRenamed> {
+  static constexpr auto fields = std::make_tuple(json_field("the value",&BindRenamed::value),json_field("flags",&BindRenamed::flags));
+};
+
+TEST_CASE("Parsing into bound structs","[json_struct]")
+{
+  using JsonParserError = Json::JsonParser::JsonParserError;
+  std::string text = " { \"id\" : 7, \"unknown\":{\"a\":[1,{\"id\":9}]}, \"na\\u006de\":\"Ada \\\"L\\\"\", \"admin\":true,"
+                     "\"score\":2,\"tags\":[\"x\",\"y\"],\"age\":null,\"address\":{\"zip\":12345,\"city\":\"London\"},"
+                     "\"previous\":[{\"city\":\"Paris\"},{}] } ";
+  BindUser user;
+  user.age = 3;
+  REQUIRE(Json::parse_struct(text,user) == JsonParserError::ok);
+  REQUIRE(user.id == 7);
+  REQUIRE(user.name == "Ada \"L\"");
+  REQUIRE(user.admin);
+  REQUIRE(user.score == 2.0);
+  REQUIRE(user.tags == std::vector<std::string>{"x","y"});
+  REQUIRE_FALSE(user.age.has_value());
+  REQUIRE(user.address.city == "London");
+  REQUIRE(user.address.zip == 12345);
+  REQUIRE(user.previous.size() == 2);
+  REQUIRE(user.previous[0].city == "Paris");
+
+  // The dump is the same json the DOM would write for it.
+  user.age = 36;
+  std::string dumped = Json::dump_struct(user);
+  REQUIRE(dumped == "{\"id\":7,\"name\":\"Ada \\\"L\\\"\",\"admin\":true,\"score\":2.0,\"tags\":[\"x\",\"y\"],\"age\":36,"
+                    "\"address\":{\"city\":\"London\",\"zip\":12345},\"previous\":[{\"city\":\"Paris\",\"zip\":0},{\"city\":\"\",\"zip\":0}]}");
+  BindUser copy;
+  REQUIRE(Json::parse_struct(dumped,copy) == JsonParserError::ok);
+  REQUIRE(Json::dump_struct(copy) == dumped);
+
+  BindRenamed renamed;
+  REQUIRE(Json::parse_struct("{\"the value\":4000000000,\"flags\":[true,false]}",renamed) == JsonParserError::ok);
+  REQUIRE(renamed.value == 4000000000u);
+  REQUIRE(renamed.flags == std::vector<bool>{true,false});
+  REQUIRE(Json::dump_struct(renamed) == "{\"the value\":4000000000,\"flags\":[true,false]}");
+
+  std::vector<int> numbers;
+  REQUIRE(Json::parse_struct("[1,2,3]",numbers) == JsonParserError::ok);
+  REQUIRE(numbers.size() == 3);
+  REQUIRE(Json::parse_struct("{\"id\":\"7\"}",user) == JsonParserError::unexpected_type);
+  REQUIRE(Json::parse_struct("{\"zip\":1.5}",user.address) == JsonParserError::unexpected_type);
+  // Integers are never wrapped into the range of the member.
+  REQUIRE(Json::parse_struct("{\"zip\":2147483648}",user.address) == JsonParserError::unexpected_type);
+  REQUIRE(Json::parse_struct("{\"zip\":-2147483649}",user.address) == JsonParserError::unexpected_type);
+  REQUIRE(Json::parse_struct("{\"zip\":-2147483648}",user.address) == JsonParserError::ok);
+  REQUIRE(user.address.zip == INT_MIN);
+  REQUIRE(Json::parse_struct("{\"the value\":4294967296}",renamed) == JsonParserError::unexpected_type);
+  REQUIRE(Json::parse_struct("{\"the value\":-1}",renamed) == JsonParserError::unexpected_type);
+  REQUIRE(Json::parse_struct("{\"the value\":2.0}",renamed) == JsonParserError::unexpected_type);
+  REQUIRE(renamed.value == 4000000000u);
+  REQUIRE(Json::parse_struct("{\"id\":9223372036854775808}",user) == JsonParserError::unexpected_type);
+  std::uint8_t byte = 0;
+  REQUIRE(Json::parse_struct("256",byte) == JsonParserError::unexpected_type);
+  std::int8_t tiny = 0;
+  REQUIRE(Json::parse_struct("-128",tiny) == JsonParserError::ok);
+  REQUIRE(tiny == -128);
+  unsigned long long big = 0;
+  REQUIRE(Json::parse_struct("9223372036854775807",big) == JsonParserError::ok);
+  REQUIRE(Json::parse_struct("-5",big) == JsonParserError::unexpected_type);
+  REQUIRE(Json::parse_struct("{\"id\":1} x",user) == JsonParserError::unexpected_character_after_json);
+  REQUIRE(Json::parse_struct("{\"id\":1",user) == JsonParserError::unexpected_end_of_json);
+  REQUIRE(Json::parse_struct("{\"id\" 1}",user) == JsonParserError::expected_colon_but_got_different_character_instead);
+  REQUIRE(Json::parse_struct("[1 2]",numbers) == JsonParserError::expected_comma_before_next_array_item);
+
+  constexpr JsonKeyTable<3> table(std::array<std::string_view,3>{{"a","bb","ccc"}});
+  REQUIRE(table.find("bb") == 1);
+  REQUIRE(table.find("d") == 3);
+}
+
+TEST_CASE("Interning attribute keys","[json_intern]")
+{
+  std::string json = "[";
+  for (int i = 0; i < 100; i++)
+    json += std::string(i ? "," : "") + "{\"id\":" + std::to_string(i) + ",\"name\":\"n\",\"k\\u0031\":1,\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"id\":" + std::to_string(i*2) + "}";
+  json += "]";
+
+  JsonKeyInterner interner;
+  REQUIRE(interner.intern("id").view.data() == interner.intern(std::string("id")).view.data());
+  REQUIRE(interner.intern("") == interner.intern(""));
+  REQUIRE(interner.size() == 2);
+
+  JsonParseOptions options;
+  options.key_interner = &interner;
+  auto shared = Json::parse(json,[](Json::JsonParser&){REQUIRE(false);},options);
+  auto flat = FlatJson::parse(json,[](FlatJson::JsonParser&){REQUIRE(false);},options);
+  // Every key is stored once for both documents.
+  REQUIRE(interner.size() == 11);
+
+  JsonKey id = interner.intern("id");
+  REQUIRE_FALSE(shared.get(5).get(id).map_int([](int value){REQUIRE(value == 10);}).has_error());
+  REQUIRE_FALSE(flat.get(5).get(id).map_int([](int value){REQUIRE(value == 10);}).has_error());
+  REQUIRE_FALSE(flat.get(5).get(JsonKey("k1")).has_error());
+  REQUIRE(flat.get(5).get(JsonKey("x")).has_error());
+  REQUIRE(flat.get(5).size() == 10);
+
+  options.key_interner = nullptr;
+  options.intern_keys = true;
+  std::string expected = FlatJson::parse(json,[](FlatJson::JsonParser&){}).dump();
+  REQUIRE(flat.dump() == expected);
+  REQUIRE(FlatJson::parse(json,[](FlatJson::JsonParser&){REQUIRE(false);},options).dump() == expected);
+  auto arena = ArenaJson::parse(json,[](ArenaJson::JsonParser&){REQUIRE(false);},options);
+  REQUIRE_FALSE(arena.get(99).get("id").map_int([](int value){REQUIRE(value == 198);}).has_error());
+  REQUIRE_FALSE(arena.get(99).get("name").map_string([](std::string_view value){REQUIRE(value == "n");}).has_error());
+  // The same document parsed with a borrowed buffer still interns the keys.
+  options.borrow_strings = true;
+  REQUIRE(FlatJson::parse(json,[](FlatJson::JsonParser&){},options).dump() == expected);
+}
+
+TEST_CASE("Packed numeric arrays","[json_packed]")
+{
+  auto ints = Json::parse("[1,-2,3000000000000]",[](Json::JsonParser&){REQUIRE(false);});
+  REQUIRE(ints.packed_integers().size() == 3);
+  REQUIRE(ints.packed_integers()[2] == 3000000000000ll);
+  REQUIRE(ints.packed_floats().empty());
+  REQUIRE(ints.dump() == "[1,-2,3000000000000]");
+  auto generic = Json::parse("[1,-2,3000000000000]",[](Json::JsonParser&){});
+  generic.get(0);
+  REQUIRE(generic.packed_integers().empty());
+  REQUIRE(ints.dump_cbor() == generic.dump_cbor());
+
+  // Integers are kept exactly once the array also holds floating point numbers.
+  auto mixed = ArenaJson::parse("[1,2.5,-3,1e300]",[](ArenaJson::JsonParser&){REQUIRE(false);});
+  REQUIRE(mixed.packed_integers().empty());
+  REQUIRE(mixed.packed_floats().size() == 4);
+  REQUIRE(mixed.packed_floats()[2] == -3.0);
+  std::string dumped = mixed.dump();
+  REQUIRE(Json::parse(dumped,[](Json::JsonParser&){}).dump() == dumped);
+  REQUIRE(dumped.substr(0,8) == "[1,2.5,-");
+  mixed.push_back(4ll);
+  REQUIRE(mixed.packed_floats().size() == 5);
+
+  // Reads through a const json materialize the numbers from the buffer.
+  const auto &readonly = mixed;
+  int value = 0;
+  readonly.get(2).map_int([&value](int x){value = x;});
+  REQUIRE(value == -3);
+  REQUIRE(readonly.get(1).type() == JsonType::floating_point);
+  REQUIRE(readonly.get(5).error() == JsonError::does_not_exist);
+  REQUIRE(readonly.get(0).dump() == "1");
+  REQUIRE(mixed.packed_floats().size() == 5);
+  REQUIRE(std::as_const(ints).get(1).dump() == "-2");
+  REQUIRE(ints.packed_integers().size() == 3);
+
+  // Anything else or an access by reference switches to generic items.
+  value = 0;
+  mixed.get(2).map_int([&value](int x){value = x;});
+  REQUIRE(value == -3);
+  REQUIRE(mixed.packed_floats().empty());
+  REQUIRE(std::as_const(mixed).get(2).dump() == "-3");
+  REQUIRE(mixed.size() == 5);
+  REQUIRE(mixed.dump() == dumped.substr(0,dumped.size()-1) + ",4]");
+
+  ints.push_back("x");
+  REQUIRE(ints.packed_integers().empty());
+  REQUIRE(ints.dump() == "[1,-2,3000000000000,\"x\"]");
+  auto large = Json::parse("[9007199254740993,0.5]",[](Json::JsonParser&){REQUIRE(false);});
+  REQUIRE(large.packed_floats().empty());
+  REQUIRE(large.dump() == "[9007199254740993,0.5]");
+  auto nested = Json::parse("{\"a\":[[1,2],[],[true]]}",[](Json::JsonParser&){REQUIRE(false);});
+  REQUIRE(nested.dump() == "{\"a\":[[1,2],[],[true]]}");
+}
+
+TEST_CASE("Copies share nodes until they are changed","[json_copy]")
+{
+  std::string text = "{\"user\":{\"name\":\"a\",\"tags\":[1,2]},\"items\":[{\"id\":1},{\"id\":2}],\"n\":5}";
+  auto base = FlatJson::parse(text,[](FlatJson::JsonParser&){REQUIRE(false);});
+  FlatJson copy = base;
+  copy.get("user").set("name","b");
+  copy.get("user").get("tags").push_back(3ll);
+  copy.get("items").get(1).set("id",7ll);
+  REQUIRE(base.dump() == FlatJson::parse(text,[](FlatJson::JsonParser&){}).dump());
+  REQUIRE(FlatJson::parse("{\"user\":{\"name\":\"b\",\"tags\":[1,2,3]},\"items\":[{\"id\":1},{\"id\":7}],\"n\":5}",[](FlatJson::JsonParser&){}).dump() == copy.dump());
+
+  // Assigning a copy and releasing the original keeps the copy intact.
+  FlatJson other;
+  other = copy;
+  copy = FlatJson(nullptr);
+  base.set("n",6ll);
+  REQUIRE(other.get("items").get(1).get("id").dump() == "7");
+  other.set("key",base);
+  REQUIRE(other.get("key").get("n").dump() == "6");
+
+  for (std::string same : {"{\"b\":[1,2.5],\"a\":{\"c\":\"x\"}}"}) {
+    auto flat = FlatJson::parse(same,[](FlatJson::JsonParser&){});
+    FlatJson flat_copy(flat);
+    flat_copy.get("a").set("c","y");
+    REQUIRE(flat.dump() == same);
+    REQUIRE(flat_copy.dump() == "{\"b\":[1,2.5],\"a\":{\"c\":\"y\"}}");
+
+    auto shaped = ShapedJson::parse(same,[](ShapedJson::JsonParser&){});
+    ShapedJson shaped_copy(shaped);
+    shaped_copy.get("b").push_back(true);
+    REQUIRE(shaped.dump() == same);
+    REQUIRE(shaped_copy.dump() == "{\"b\":[1,2.5,true],\"a\":{\"c\":\"x\"}}");
+
+    // Arena documents are copied into an own arena.
+    ArenaJson arena_copy;
+    {
+      auto arena = ArenaJson::parse(same,[](ArenaJson::JsonParser&){});
+      arena_copy = arena;
+    }
+    arena_copy.get("a").set("d",1ll);
+    REQUIRE(arena_copy.get("a").size() == 2);
+  }
+
+  Json hashed = Json::parse(text,[](Json::JsonParser&){});
+  Json hashed_copy(hashed);
+  hashed_copy.get("user").set("name","c");
+  hashed.get("user").get("name").map_string([](std::string_view name){REQUIRE(name == "a");});
+  hashed_copy.get("user").get("name").map_string([](std::string_view name){REQUIRE(name == "c");});
+
+  // References taken before the copy change only the original.
+  auto original = FlatJson::parse(text,[](FlatJson::JsonParser&){});
+  auto &user = original.get("user");
+  auto &tags = user.get("tags");
+  FlatJson snapshot = original;
+  user.set("name","z");
+  tags.push_back(3ll);
+  original.get("items").get(0).set("id",9ll);
+  REQUIRE(snapshot.dump() == FlatJson::parse(text,[](FlatJson::JsonParser&){}).dump());
+  REQUIRE(original.get("user").dump() == "{\"name\":\"z\",\"tags\":[1,2,3]}");
+  REQUIRE(std::as_const(snapshot).get("user").get("name").dump() == "\"a\"");
+  REQUIRE(std::as_const(snapshot).get("missing").error() == JsonError::does_not_exist);
+  REQUIRE(std::as_const(snapshot).get("n").get("x").error() == JsonError::not_implemented);
+
+  // Every thread copies the shared template and changes its own copy.
+  const Json shared = Json::parse(text,[](Json::JsonParser&){});
+  std::vector<std::string> dumps(4);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&shared,&dumps,i](){
+      for (int j = 0; j < 100; j++) {
+        Json response = shared;
+        response.get("items").get(0).set("id",(long long)i);
+        dumps[i] = response.get("items").dump();
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  for (int i = 0; i < 4; i++)
+    REQUIRE(dumps[i] == "[{\"id\":" + std::to_string(i) + "},{\"id\":2}]");
+}
+
+TEST_CASE("Reading a json from several threads","[json_reader]")
+{
+  std::string text = "{\"name\":\"a\\nb\",\"ok\":true,\"ids\":[1,2,3],\"mixed\":[1,2.5],\"items\":[{\"id\":7},null],\"n\":-4}";
+  const auto js = FlatJson::parse(text,[](FlatJson::JsonParser&){REQUIRE(false);});
+  auto root = js.reader();
+  REQUIRE(root.type() == JsonType::object);
+  REQUIRE(root.size() == 6);
+  std::string name;
+  root.get("name").map_string([&name](std::string &value){name = value;});
+  REQUIRE(name == "a\nb");
+  bool ok = false;
+  int n = 0;
+  root.get("ok").map_bool([&ok](bool value){ok = value;});
+  root.get(JsonKey("n")).map_int([&n](int value){n = value;});
+  REQUIRE(ok);
+  REQUIRE(n == -4);
+  REQUIRE(root.get(JsonPath("/items/0/id")).dump() == "7");
+  REQUIRE(root.get("items").get(1).type() == JsonType::null);
+  REQUIRE(root.dump() == js.reader().dump());
+
+  // Packed numbers are read in place and stay packed.
+  int sum = 0;
+  root.get("ids").map_array([&sum](const FlatJson::JsonReader &item){item.map_int([&sum](int value){sum += value;});});
+  REQUIRE(sum == 6);
+  REQUIRE(root.get("mixed").get(0).type() == JsonType::integer);
+  REQUIRE(root.get("mixed").get(1).type() == JsonType::floating_point);
+  REQUIRE(root.get("mixed").get(1).dump() == "2.5");
+  REQUIRE(js.reader().get("ids").size() == 3);
+  REQUIRE(const_cast<FlatJson&>(js).get("ids").packed_integers().size() == 3);
+
+  // Failed lookups only set the error of the returned view.
+  REQUIRE(root.get("missing").error() == JsonError::does_not_exist);
+  REQUIRE(root.get("missing").get(0).error() == JsonError::does_not_exist);
+  REQUIRE(root.get("ids").get(3).error() == JsonError::does_not_exist);
+  REQUIRE(root.get("ids").get("x").error() == JsonError::not_implemented);
+  REQUIRE(root.get("n").get(0).error() == JsonError::not_implemented);
+  REQUIRE(root.get("missing").type() == JsonType::null);
+  REQUIRE_FALSE(root.has_error());
+  REQUIRE_FALSE(js.reader().has_error());
+  std::vector<std::string> keys;
+  root.map_object([&keys](std::string_view key, FlatJson::JsonReader&){keys.emplace_back(key);});
+  REQUIRE(keys == std::vector<std::string>{"name","ok","ids","mixed","items","n"});
+
+  // Copies which share the nodes are read alongside the template.
+  const Json shared = Json::parse(text,[](Json::JsonParser&){});
+  const Json copy = shared;
+  const ShapedJson shaped = ShapedJson::parse(text,[](ShapedJson::JsonParser&){});
+  std::vector<int> found(4,0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&,i](){
+      for (int j = 0; j < 200; j++) {
+        auto reader = (i % 2 ? copy : shared).reader();
+        reader.get(JsonPath("/items/0/id")).map_int([&found,i](int value){found[i] += value;});
+        reader.get("ids").get(2).map_int([&found,i](int value){found[i] += value;});
+        shaped.reader().get("name").map_string([&found,i](std::string_view){found[i]++;});
+        shaped.reader().get("ids").get(j % 4).map_int([&found,i](int value){found[i] += value;});
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  for (int i = 0; i < 4; i++)
+    REQUIRE(found[i] == 200*11 + 50*6);
+}